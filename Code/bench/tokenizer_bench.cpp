@@ -0,0 +1,89 @@
+// Tokenizer throughput benchmark: make bench && Code/bin/tokenizer_bench [file...]
+#include "tokenizer.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+constexpr std::size_t kCorpusBytes = 32 * 1024 * 1024;
+constexpr int kRounds = 5;
+
+std::string makeCorpus(const std::vector<std::string>& words) {
+    std::mt19937 rng(42);
+    const char* separators[] = {" ", " ", " ", " ", ", ", ". ", "\n", "-", "_", " (", ") "};
+    std::string text;
+    text.reserve(kCorpusBytes + 64);
+    while (text.size() < kCorpusBytes) {
+        text += words[rng() % words.size()];
+        text += separators[rng() % (sizeof(separators) / sizeof(*separators))];
+    }
+    return text;
+}
+
+// Whitespace split plus lowercase/strip-punctuation per word, as terms were
+// produced before the tokenizer
+std::size_t baselineTokenize(const std::string& text) {
+    std::istringstream iss(text);
+    std::string word;
+    std::size_t count = 0;
+    while (iss >> word) {
+        std::transform(word.begin(), word.end(), word.begin(),
+                       [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+        word.erase(std::remove_if(word.begin(), word.end(),
+                                  [](unsigned char c) { return std::ispunct(c) != 0; }), word.end());
+        if (!word.empty()) ++count;
+    }
+    return count;
+}
+
+template <typename F>
+void measure(const std::string& label, const std::string& text, F&& run) {
+    std::size_t tokens = 0;
+    double best = 1e30;
+    for (int round = 0; round < kRounds; ++round) {
+        auto start = std::chrono::steady_clock::now();
+        tokens = run(text);
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    double megabytes = static_cast<double>(text.size()) / (1024.0 * 1024.0);
+    std::cout << std::left << std::setw(28) << label << std::right << std::fixed << std::setprecision(1)
+              << std::setw(9) << megabytes / best << " MB/s  " << std::setw(10) << tokens << " tokens\n";
+}
+
+void benchCorpus(const std::string& name, const std::string& text) {
+    std::cout << name << " (" << text.size() / 1024 << " KiB)\n";
+    uni::Tokenizer tokenizer;
+    measure("  tokenizer", text, [&](const std::string& t) { return tokenizer.tokenize(t).size(); });
+    measure("  whitespace + normalize", text, baselineTokenize);
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    benchCorpus("ASCII prose", makeCorpus({"Data", "structures", "and", "algorithms", "B.Tech", "CSE",
+                                           "semester", "2024", "Lecture", "notes", "on", "graphs",
+                                           "Dijkstra's", "shortest", "path", "O(n log n)", "the", "of"}));
+    benchCorpus("Mixed UTF-8", makeCorpus({"Data", "structures", "डेटा", "संरचना", "தரவு", "கட்டமைப்பு",
+                                           "Αλγόριθμοι", "Структуры", "данных", "Ünïcödé", "notes", "2024"}));
+
+    for (int i = 1; i < argc; ++i) {
+        std::ifstream in(argv[i], std::ios::binary);
+        if (!in) {
+            std::cerr << "Cannot read " << argv[i] << "\n";
+            return 1;
+        }
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        benchCorpus(argv[i], contents.str());
+    }
+    return 0;
+}
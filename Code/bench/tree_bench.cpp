@@ -0,0 +1,156 @@
+// Ordered tree benchmark: make bench && Code/bin/tree_bench [keys]
+#include "data_structures.h"
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdlib>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <random>
+#include <string>
+#include <vector>
+
+// Bytes currently allocated, to measure what a tree holds. Each block is
+// prefixed with its size so deletes can subtract it.
+static std::size_t liveBytes = 0;
+
+void* operator new(std::size_t size) {
+    auto* block = static_cast<std::max_align_t*>(std::malloc(size + sizeof(std::max_align_t)));
+    if (!block) throw std::bad_alloc();
+    *reinterpret_cast<std::size_t*>(block) = size;
+    liveBytes += size;
+    return block + 1;
+}
+
+void operator delete(void* p) noexcept {
+    if (!p) return;
+    auto* block = static_cast<std::max_align_t*>(p) - 1;
+    liveBytes -= *reinterpret_cast<std::size_t*>(block);
+    std::free(block);
+}
+
+void operator delete(void* p, std::size_t) noexcept { operator delete(p); }
+
+namespace {
+
+constexpr int kRounds = 3;
+
+// The AVL tree as it was before the pool: one shared_ptr node per value,
+// recursive insert and traversal, comparisons through std::function
+template<typename T>
+class SharedPtrAVLTree {
+    struct Node {
+        T data;
+        int height = 1;
+        std::shared_ptr<Node> left, right;
+        explicit Node(const T& val) : data(val) {}
+    };
+    using NodePtr = std::shared_ptr<Node>;
+    NodePtr root;
+    std::function<bool(const T&, const T&)> compare = std::less<T>();
+
+    int height(NodePtr node) { return node ? node->height : 0; }
+    void update(NodePtr node) { node->height = 1 + std::max(height(node->left), height(node->right)); }
+    NodePtr rotateRight(NodePtr y) {
+        NodePtr x = y->left;
+        y->left = x->right;
+        x->right = y;
+        update(y);
+        update(x);
+        return x;
+    }
+    NodePtr rotateLeft(NodePtr x) {
+        NodePtr y = x->right;
+        x->right = y->left;
+        y->left = x;
+        update(x);
+        update(y);
+        return y;
+    }
+    NodePtr insert(NodePtr node, const T& data) {
+        if (!node) return std::make_shared<Node>(data);
+        if (compare(data, node->data)) {
+            node->left = insert(node->left, data);
+        } else if (compare(node->data, data)) {
+            node->right = insert(node->right, data);
+        } else {
+            return node;
+        }
+        update(node);
+        int balance = height(node->left) - height(node->right);
+        if (balance > 1 && compare(data, node->left->data)) return rotateRight(node);
+        if (balance < -1 && compare(node->right->data, data)) return rotateLeft(node);
+        if (balance > 1 && compare(node->left->data, data)) {
+            node->left = rotateLeft(node->left);
+            return rotateRight(node);
+        }
+        if (balance < -1 && compare(data, node->right->data)) {
+            node->right = rotateRight(node->right);
+            return rotateLeft(node);
+        }
+        return node;
+    }
+    void inorder(NodePtr node, std::vector<T>& result) {
+        if (!node) return;
+        inorder(node->left, result);
+        result.push_back(node->data);
+        inorder(node->right, result);
+    }
+
+public:
+    void insert(const T& data) { root = insert(root, data); }
+    std::vector<T> getSorted() {
+        std::vector<T> result;
+        inorder(root, result);
+        return result;
+    }
+};
+
+// Best of kRounds for inserting keys and reading them back in order
+template<typename Tree, typename T>
+void measure(const std::string& label, const std::vector<T>& keys) {
+    double bestInsert = 1e30, bestInorder = 1e30;
+    std::size_t count = 0, bytes = 0;
+    for (int round = 0; round < kRounds; ++round) {
+        Tree tree;
+        std::size_t before = liveBytes;
+        auto start = std::chrono::steady_clock::now();
+        for (const auto& key : keys) tree.insert(key);
+        auto inserted = std::chrono::steady_clock::now();
+        bytes = liveBytes - before;
+        count = tree.getSorted().size();
+        auto read = std::chrono::steady_clock::now();
+        bestInsert = std::min(bestInsert, std::chrono::duration<double>(inserted - start).count());
+        bestInorder = std::min(bestInorder, std::chrono::duration<double>(read - inserted).count());
+    }
+    std::cout << std::left << std::setw(34) << label << std::right << std::fixed << std::setprecision(1)
+              << std::setw(9) << bestInsert * 1000 << " ms insert " << std::setw(8) << bestInorder * 1000
+              << " ms inorder " << std::setw(6) << bytes / count << " B/key held\n";
+}
+
+}
+
+int main(int argc, char** argv) {
+    std::size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 1000000;
+    std::mt19937 rng(42);
+
+    std::vector<std::uint32_t> ids(count);
+    std::iota(ids.begin(), ids.end(), 0u);
+    std::vector<std::uint32_t> shuffled = ids;
+    std::shuffle(shuffled.begin(), shuffled.end(), rng);
+    std::vector<std::string> emails(count);
+    for (std::size_t i = 0; i < count; ++i) emails[i] = "student" + std::to_string(shuffled[i]) + "@nitt.edu";
+
+    std::cout << count << " keys (pooled sizes include the pool's spare capacity; string bytes count for both)\n";
+    measure<SharedPtrAVLTree<std::uint32_t>>("shared_ptr AVL, sorted ids", ids);
+    measure<uni::AVLTree<std::uint32_t>>("pooled AVL, sorted ids", ids);
+    measure<SharedPtrAVLTree<std::uint32_t>>("shared_ptr AVL, random ids", shuffled);
+    measure<uni::AVLTree<std::uint32_t>>("pooled AVL, random ids", shuffled);
+    measure<SharedPtrAVLTree<std::string>>("shared_ptr AVL, random emails", emails);
+    measure<uni::AVLTree<std::string>>("pooled AVL, random emails", emails);
+    return 0;
+}
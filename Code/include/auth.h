@@ -4,7 +4,7 @@
     This header file defines the authentication and user profile management interfaces
     for the UniHub-CLI application. It provides structures to represent user profiles
     and user records, and declares functions for registering users, logging in,
-    loading and saving profiles, and retrieving the users directory path.
+    loading and saving profiles, and retrieving the users database path.
 
     The functions and structures here are used to manage user authentication,
     profile storage, and access control throughout the application.
@@ -14,6 +14,8 @@
 
 #include <string>      // Provides the std::string type
 #include <optional>    // Provides std::optional for optional return values
+#include <vector>      // Provides std::vector for lists of users
+#include <utility>     // Provides std::pair for (profile, password) pairs
 
 using namespace std;   // Allows usage of standard library types without std:: prefix
 
@@ -41,6 +43,20 @@ struct UserRecord {
 // Returns an error message on failure, or std::nullopt on success
 optional<string> registerUser(const Profile& profile, const string& password);
 
+// Outcome of registering one user of a batch
+struct Registration {
+    optional<UserRecord> record;   // The stored record, on success
+    string error;                  // Why the user was not registered, otherwise
+};
+
+// Registers many users with one durable commit: salts and password hashes are computed on
+// threads workers (0 = one per hardware thread), then every record is written and flushed
+// together, so a crash keeps either all of them or none
+// Returns one Registration per (profile, password) pair, in the same order; workers, if given,
+// receives the number of threads that did the hashing (1 when a small batch is hashed inline)
+vector<Registration> registerUsers(const vector<pair<Profile, string>>& users, size_t threads = 0,
+                                   size_t* workers = nullptr);
+
 // Attempts to log in a user with the given email and password
 // On success, returns the loaded UserRecord; otherwise returns std::nullopt
 optional<UserRecord> login(const string& email, const string& password);
@@ -53,7 +69,19 @@ optional<Profile> loadProfile(const string& email);
 // Returns an error message on failure, or std::nullopt on success
 optional<string> saveProfile(const Profile& profile);
 
-// Returns the directory path where user data is stored
+// Loads every user in the users database
+vector<UserRecord> loadAllUsers();
+
+// Opens the users database, first importing the per-user files of an earlier version when there is
+// no database yet. Returns an error message if the database cannot be used (a failed import is retried
+// on the next use). Users the import had to leave out, whose files stay in place, are appended to
+// skipped as "email or file: reason", once.
+optional<string> openUsersDatabase(vector<string>* skipped = nullptr);
+
+// Returns the directory of per-user files from earlier versions (imported into the database once)
 string usersDir();
 
+// Returns the path of the users database file
+string usersDbPath();
+
 } // namespace uni
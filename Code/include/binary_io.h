@@ -0,0 +1,133 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace uni {
+
+// ============================================================================
+// Binary Writer / Reader for on-disk formats
+// ============================================================================
+// Fixed-width values are written in native byte order; strings and arrays are
+// length-prefixed. The reader never throws: a short or corrupt buffer clears
+// ok() and every further read returns a default value.
+
+class BinaryWriter {
+private:
+    std::string buffer;
+
+public:
+    template<typename T>
+    void put(const T& value) {
+        static_assert(std::is_trivially_copyable_v<T>, "put() needs a trivially copyable type");
+        buffer.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void putString(const std::string& value) {
+        put<std::uint32_t>(static_cast<std::uint32_t>(value.size()));
+        buffer.append(value);
+    }
+
+    template<typename T>
+    void putArray(const std::vector<T>& values) {
+        static_assert(std::is_trivially_copyable_v<T>, "putArray() needs a trivially copyable type");
+        put<std::uint64_t>(values.size());
+        buffer.append(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(T));
+    }
+
+    void putStrings(const std::vector<std::string>& values) {
+        put<std::uint64_t>(values.size());
+        for (const auto& value : values) putString(value);
+    }
+
+    void putBytes(const void* data, std::size_t size) {
+        buffer.append(static_cast<const char*>(data), size);
+    }
+
+    // Pads with zeros so the next value starts at a multiple of alignment
+    void align(std::size_t alignment) {
+        buffer.append((alignment - buffer.size() % alignment) % alignment, '\0');
+    }
+
+    std::size_t size() const { return buffer.size(); }
+    const std::string& data() const { return buffer; }
+    std::string& data() { return buffer; }
+};
+
+class BinaryReader {
+private:
+    const char* begin;
+    const char* cur;
+    const char* end;
+    bool good = true;
+
+    bool need(std::size_t n) {
+        if (!good || static_cast<std::size_t>(end - cur) < n) {
+            good = false;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    BinaryReader(const char* data, std::size_t size) : begin(data), cur(data), end(data + size) {}
+
+    template<typename T>
+    T get() {
+        static_assert(std::is_trivially_copyable_v<T>, "get() needs a trivially copyable type");
+        T value{};
+        if (!need(sizeof(T))) return value;
+        std::memcpy(&value, cur, sizeof(T));
+        cur += sizeof(T);
+        return value;
+    }
+
+    std::string getString() {
+        auto size = get<std::uint32_t>();
+        if (!need(size)) return {};
+        std::string value(cur, size);
+        cur += size;
+        return value;
+    }
+
+    template<typename T>
+    std::vector<T> getArray() {
+        auto count = get<std::uint64_t>();
+        if (!good || count > static_cast<std::size_t>(end - cur) / sizeof(T)) {
+            good = false;
+            return {};
+        }
+        std::vector<T> values(count);
+        if (count > 0) std::memcpy(values.data(), cur, count * sizeof(T));
+        cur += count * sizeof(T);
+        return values;
+    }
+
+    std::vector<std::string> getStrings() {
+        auto count = get<std::uint64_t>();
+        std::vector<std::string> values;
+        for (std::uint64_t i = 0; i < count && good; ++i) values.push_back(getString());
+        return values;
+    }
+
+    // Returns a pointer to the next size bytes without copying them
+    const char* take(std::size_t size) {
+        if (!need(size)) return nullptr;
+        const char* data = cur;
+        cur += size;
+        return data;
+    }
+
+    void align(std::size_t alignment) {
+        std::size_t offset = static_cast<std::size_t>(cur - begin);
+        take((alignment - offset % alignment) % alignment);
+    }
+
+    bool ok() const { return good; }
+    bool atEnd() const { return cur == end; }
+    std::size_t remaining() const { return static_cast<std::size_t>(end - cur); }
+};
+
+}
@@ -0,0 +1,219 @@
+#pragma once
+#include "posting_list.h"
+#include <array>
+#include <vector>
+#include <queue>
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <functional>
+
+namespace uni {
+
+// ============================================================================
+// BM25 Relevance Ranking with WAND Top-K Retrieval
+// ============================================================================
+
+// Indexed metadata fields, each with its own term frequencies and lengths
+enum class IndexField : std::size_t { DisplayName, Subject, ResourceType, Tags, Content };
+inline constexpr std::size_t kFieldCount = 5;
+
+using FieldFrequencies = std::array<std::uint8_t, kFieldCount>;
+using FieldLengths = std::array<std::uint16_t, kFieldCount>;
+
+// Per-field term frequencies packed 4 bits each (saturating at 15) into a
+// posting payload
+inline std::uint32_t packFrequencies(const FieldFrequencies& tf) {
+    std::uint32_t packed = 0;
+    for (std::size_t f = 0; f < kFieldCount; ++f) {
+        packed |= static_cast<std::uint32_t>(std::min<std::uint8_t>(tf[f], 15)) << (4 * f);
+    }
+    return packed;
+}
+
+inline FieldFrequencies unpackFrequencies(std::uint32_t packed) {
+    FieldFrequencies tf{};
+    for (std::size_t f = 0; f < kFieldCount; ++f) {
+        tf[f] = static_cast<std::uint8_t>((packed >> (4 * f)) & 0xF);
+    }
+    return tf;
+}
+
+// A term's postings plus the per-field maximum frequency, which bounds the
+// best score any document can get from this term
+struct TermPostings {
+    CompressedPostingList postings;
+    FieldFrequencies maxFrequencies{};
+
+    void add(DocId id, const FieldFrequencies& tf) {
+        postings.insert(id, packFrequencies(tf));
+        for (std::size_t f = 0; f < kFieldCount; ++f) {
+            maxFrequencies[f] = std::max(maxFrequencies[f], std::min<std::uint8_t>(tf[f], 15));
+        }
+    }
+};
+
+struct RankingParams {
+    double k1 = 1.2;
+    double b = 0.75;
+    // displayName, subject, resourceType, tags, content
+    std::array<double, kFieldCount> fieldWeights{3.0, 1.5, 1.0, 2.0, 1.0};
+};
+
+// Collection statistics, maintained incrementally as documents come and go
+struct CollectionStats {
+    std::uint64_t documents = 0;
+    std::array<std::uint64_t, kFieldCount> totalLengths{};
+
+    void add(const FieldLengths& lengths) {
+        ++documents;
+        for (std::size_t f = 0; f < kFieldCount; ++f) totalLengths[f] += lengths[f];
+    }
+
+    void remove(const FieldLengths& lengths) {
+        if (documents > 0) --documents;
+        for (std::size_t f = 0; f < kFieldCount; ++f) {
+            totalLengths[f] -= std::min<std::uint64_t>(totalLengths[f], lengths[f]);
+        }
+    }
+};
+
+// BM25F: each field's frequency is normalized by that field's length relative
+// to its collection average, then the weighted sum is saturated once. A long
+// document body therefore does not drown out matches in its short fields.
+class Bm25Scorer {
+private:
+    RankingParams params;
+    double docCount;
+    std::array<double, kFieldCount> avgLengths{};
+    std::array<double, kFieldCount> minNorms{};     // Norm of the shortest non-empty field
+    
+    double norm(std::size_t f, double length) const {
+        return 1.0 - params.b + params.b * length / avgLengths[f];
+    }
+    
+    double saturate(double wtf) const {
+        return wtf * (params.k1 + 1.0) / (wtf + params.k1);
+    }
+
+public:
+    Bm25Scorer(const RankingParams& p, const CollectionStats& stats) : params(p) {
+        docCount = static_cast<double>(stats.documents);
+        for (std::size_t f = 0; f < kFieldCount; ++f) {
+            avgLengths[f] = docCount > 0 && stats.totalLengths[f] > 0 ? stats.totalLengths[f] / docCount : 1.0;
+            // A field containing the term holds at least one term
+            minNorms[f] = norm(f, 1.0);
+        }
+    }
+    
+    // Posting lists keep removed documents until compaction while docCount
+    // only counts live ones, so df is capped at docCount: idf stays positive,
+    // as WAND's upper bounds require
+    double idf(std::size_t docFrequency) const {
+        double df = std::min(static_cast<double>(docFrequency), docCount);
+        return std::log(1.0 + (docCount - df + 0.5) / (df + 0.5));
+    }
+    
+    double score(double termIdf, const FieldFrequencies& tf, const FieldLengths& lengths) const {
+        double wtf = 0.0;
+        for (std::size_t f = 0; f < kFieldCount; ++f) {
+            if (tf[f]) wtf += params.fieldWeights[f] * tf[f] / norm(f, lengths[f]);
+        }
+        return termIdf * saturate(wtf);
+    }
+    
+    // Score with every field at its maximum frequency and shortest length,
+    // which no real document can beat
+    double upperBound(double termIdf, const FieldFrequencies& maxTf) const {
+        double wtf = 0.0;
+        for (std::size_t f = 0; f < kFieldCount; ++f) {
+            if (maxTf[f]) wtf += params.fieldWeights[f] * maxTf[f] / minNorms[f];
+        }
+        return termIdf * saturate(wtf);
+    }
+};
+
+struct ScoredDoc {
+    DocId id;
+    double score;
+};
+
+// Top-k disjunctive retrieval with WAND: documents whose summed term upper
+// bounds cannot beat the current k-th score are skipped without scoring.
+// accept(id) filters candidates; lengths(id) returns a document's field lengths.
+template<typename Accept, typename Lengths>
+std::vector<ScoredDoc> wandTopK(const std::vector<const TermPostings*>& terms, const Bm25Scorer& scorer,
+                                std::size_t k, Accept accept, Lengths lengths) {
+    struct TermCursor {
+        CompressedPostingList::Cursor cursor;
+        double idf;
+        double bound;
+    };
+
+    std::vector<TermCursor> cursors;
+    for (const auto* term : terms) {
+        if (!term || term->postings.empty()) continue;
+        double idf = scorer.idf(term->postings.size());
+        cursors.push_back(TermCursor{term->postings.cursor(), idf, scorer.upperBound(idf, term->maxFrequencies)});
+    }
+
+    auto worse = [](const ScoredDoc& a, const ScoredDoc& b) {
+        return a.score > b.score || (a.score == b.score && a.id < b.id);
+    };
+    std::priority_queue<ScoredDoc, std::vector<ScoredDoc>, decltype(worse)> heap(worse);
+    if (k == 0) return {};
+
+    while (true) {
+        cursors.erase(std::remove_if(cursors.begin(), cursors.end(),
+                                     [](const TermCursor& c) { return c.cursor.atEnd(); }), cursors.end());
+        if (cursors.empty()) break;
+        std::sort(cursors.begin(), cursors.end(),
+                  [](const TermCursor& a, const TermCursor& b) { return a.cursor.docId() < b.cursor.docId(); });
+
+        double threshold = heap.size() < k ? -1.0 : heap.top().score;
+
+        // Pivot: first cursor at which the accumulated bounds could beat the threshold
+        double accumulated = 0.0;
+        std::size_t pivot = cursors.size();
+        for (std::size_t i = 0; i < cursors.size(); ++i) {
+            accumulated += cursors[i].bound;
+            if (accumulated > threshold) {
+                pivot = i;
+                break;
+            }
+        }
+        if (pivot == cursors.size()) break;
+
+        DocId pivotDoc = cursors[pivot].cursor.docId();
+        if (cursors.front().cursor.docId() == pivotDoc) {
+            double score = 0.0;
+            bool wanted = accept(pivotDoc);
+            FieldLengths docLengths{};
+            if (wanted) docLengths = lengths(pivotDoc);
+
+            for (auto& c : cursors) {
+                if (c.cursor.docId() != pivotDoc) break;
+                if (wanted) score += scorer.score(c.idf, unpackFrequencies(c.cursor.payload()), docLengths);
+                c.cursor.next();
+            }
+
+            if (wanted && (heap.size() < k || score > heap.top().score)) {
+                heap.push(ScoredDoc{pivotDoc, score});
+                if (heap.size() > k) heap.pop();
+            }
+        } else {
+            // Every cursor before the pivot can skip straight to the pivot document
+            for (std::size_t i = 0; i < pivot; ++i) cursors[i].cursor.advance(pivotDoc);
+        }
+    }
+
+    std::vector<ScoredDoc> results;
+    while (!heap.empty()) {
+        results.push_back(heap.top());
+        heap.pop();
+    }
+    std::reverse(results.begin(), results.end());
+    return results;
+}
+
+}
@@ -0,0 +1,366 @@
+#pragma once
+#include "posting_list.h"
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+namespace uni {
+
+// ============================================================================
+// B+Tree over (key, id) pairs
+// ============================================================================
+// Ordered secondary index: each entry is a (key, id) pair, unique as a pair,
+// so any number of ids may share a key. Keys are unsigned 64-bit integers;
+// orderedKey() maps signed integers and doubles onto them without changing
+// their order, so one node layout serves every column.
+//
+// Nodes are 256 bytes (four cache lines), line-aligned and kept in two arrays
+// addressed by 32-bit indices. Keys and ids sit in separate arrays inside a
+// node, so a lookup scans contiguous keys. Leaves are linked both ways: a
+// range scan is one descent and then a walk along the leaves, O(log n + k) in
+// either direction.
+//
+// erase() does not merge underfull leaves, since the owner rebuilds the tree
+// with assign() when it compacts; a leaf may be left empty and scans step
+// over it.
+class BPlusTree {
+public:
+    using Key = std::uint64_t;
+
+    struct Entry {
+        Key key;
+        DocId id;
+    };
+
+    static constexpr DocId kMaxId = std::numeric_limits<DocId>::max();
+
+    static Key orderedKey(std::uint64_t value) { return value; }
+    static Key orderedKey(std::int64_t value) { return static_cast<Key>(value) ^ kSignBit; }
+    static Key orderedKey(double value) {
+        if (value == 0.0) value = 0.0;  // -0 and +0 are one key
+        Key bits;
+        std::memcpy(&bits, &value, sizeof(bits));
+        return (bits & kSignBit) ? ~bits : bits | kSignBit;
+    }
+
+private:
+    static constexpr Key kSignBit = Key(1) << 63;
+    static constexpr std::uint32_t kNone = std::numeric_limits<std::uint32_t>::max();
+    static constexpr std::size_t kNodeBytes = 256;
+    static constexpr std::size_t kLeafCapacity = (kNodeBytes - 16) / (sizeof(Key) + sizeof(DocId));
+    static constexpr std::size_t kInnerCapacity =
+        (kNodeBytes - 16) / (sizeof(Key) + sizeof(DocId) + sizeof(std::uint32_t));
+    static constexpr std::size_t kMaxHeight = 32;
+
+    struct alignas(64) Leaf {
+        Key keys[kLeafCapacity];
+        DocId ids[kLeafCapacity];
+        std::uint32_t prev = kNone;
+        std::uint32_t next = kNone;
+        std::uint16_t count = 0;
+    };
+
+    // Separator i is a lower bound of child i + 1 and above everything in child i
+    struct alignas(64) Inner {
+        Key keys[kInnerCapacity];
+        DocId ids[kInnerCapacity];
+        std::uint32_t children[kInnerCapacity + 1];
+        std::uint16_t count = 0;    // Separators; children are one more
+    };
+
+    static_assert(sizeof(Leaf) == kNodeBytes && sizeof(Inner) == kNodeBytes, "B+tree nodes are 256 bytes");
+
+    std::vector<Leaf> leaves;
+    std::vector<Inner> inners;
+    std::uint32_t root = kNone;
+    std::size_t height = 0;         // Inner levels above the leaves
+    std::size_t entries = 0;
+
+    static bool less(Key a, DocId aId, Key b, DocId bId) {
+        return a < b || (a == b && aId < bId);
+    }
+
+    // First position in leaf not below (key, id)
+    static std::size_t lowerIn(const Leaf& leaf, Key key, DocId id) {
+        std::size_t i = 0;
+        while (i < leaf.count && less(leaf.keys[i], leaf.ids[i], key, id)) ++i;
+        return i;
+    }
+
+    // First position in leaf above (key, id)
+    static std::size_t upperIn(const Leaf& leaf, Key key, DocId id) {
+        std::size_t i = 0;
+        while (i < leaf.count && !less(key, id, leaf.keys[i], leaf.ids[i])) ++i;
+        return i;
+    }
+
+    // Child of inner whose range holds (key, id)
+    static std::size_t childIn(const Inner& inner, Key key, DocId id) {
+        std::size_t i = 0;
+        while (i < inner.count && !less(key, id, inner.keys[i], inner.ids[i])) ++i;
+        return i;
+    }
+
+    std::uint32_t findLeaf(Key key, DocId id) const {
+        std::uint32_t node = root;
+        for (std::size_t level = 0; level < height; ++level) {
+            const Inner& inner = inners[node];
+            node = inner.children[childIn(inner, key, id)];
+        }
+        return node;
+    }
+
+    std::uint32_t newLeaf() {
+        leaves.emplace_back();
+        return static_cast<std::uint32_t>(leaves.size() - 1);
+    }
+
+    std::uint32_t newInner() {
+        inners.emplace_back();
+        return static_cast<std::uint32_t>(inners.size() - 1);
+    }
+
+    static void insertAt(Leaf& leaf, std::size_t pos, Key key, DocId id) {
+        std::copy_backward(leaf.keys + pos, leaf.keys + leaf.count, leaf.keys + leaf.count + 1);
+        std::copy_backward(leaf.ids + pos, leaf.ids + leaf.count, leaf.ids + leaf.count + 1);
+        leaf.keys[pos] = key;
+        leaf.ids[pos] = id;
+        ++leaf.count;
+    }
+
+    // Adds separator (key, id) at slot with child to its right. If inner is
+    // full it is split: the upper half moves to a new node and the middle
+    // separator is returned in key / id / child for the parent.
+    bool insertSeparator(std::uint32_t node, std::size_t slot, Key& key, DocId& id, std::uint32_t& child) {
+        Inner* inner = &inners[node];
+        std::size_t n = inner->count;
+        if (n < kInnerCapacity) {
+            std::copy_backward(inner->keys + slot, inner->keys + n, inner->keys + n + 1);
+            std::copy_backward(inner->ids + slot, inner->ids + n, inner->ids + n + 1);
+            std::copy_backward(inner->children + slot + 1, inner->children + n + 1, inner->children + n + 2);
+            inner->keys[slot] = key;
+            inner->ids[slot] = id;
+            inner->children[slot + 1] = child;
+            ++inner->count;
+            return false;
+        }
+
+        Key keys[kInnerCapacity + 1];
+        DocId ids[kInnerCapacity + 1];
+        std::uint32_t children[kInnerCapacity + 2];
+        for (std::size_t i = 0, j = 0; i <= n; ++i) {
+            if (i == slot) {
+                keys[i] = key;
+                ids[i] = id;
+            } else {
+                keys[i] = inner->keys[j];
+                ids[i] = inner->ids[j];
+                ++j;
+            }
+        }
+        for (std::size_t i = 0, j = 0; i <= n + 1; ++i) {
+            children[i] = i == slot + 1 ? child : inner->children[j++];
+        }
+
+        std::uint32_t right = newInner();
+        inner = &inners[node];
+        Inner& sibling = inners[right];
+        std::size_t total = n + 1;
+        std::size_t mid = total / 2;
+        inner->count = static_cast<std::uint16_t>(mid);
+        std::copy(keys, keys + mid, inner->keys);
+        std::copy(ids, ids + mid, inner->ids);
+        std::copy(children, children + mid + 1, inner->children);
+        sibling.count = static_cast<std::uint16_t>(total - mid - 1);
+        std::copy(keys + mid + 1, keys + total, sibling.keys);
+        std::copy(ids + mid + 1, ids + total, sibling.ids);
+        std::copy(children + mid + 1, children + total + 1, sibling.children);
+
+        key = keys[mid];
+        id = ids[mid];
+        child = right;
+        return true;
+    }
+
+public:
+    std::size_t size() const { return entries; }
+    bool empty() const { return entries == 0; }
+
+    void clear() {
+        leaves.clear();
+        inners.clear();
+        root = kNone;
+        height = 0;
+        entries = 0;
+    }
+
+    // Adds (key, id); false if it is already present
+    bool insert(Key key, DocId id) {
+        if (root == kNone) root = newLeaf();
+
+        std::uint32_t path[kMaxHeight];
+        std::size_t slots[kMaxHeight];
+        std::uint32_t node = root;
+        for (std::size_t level = 0; level < height; ++level) {
+            const Inner& inner = inners[node];
+            path[level] = node;
+            slots[level] = childIn(inner, key, id);
+            node = inner.children[slots[level]];
+        }
+
+        Leaf* leaf = &leaves[node];
+        std::size_t pos = lowerIn(*leaf, key, id);
+        if (pos < leaf->count && leaf->keys[pos] == key && leaf->ids[pos] == id) return false;
+        ++entries;
+        if (leaf->count < kLeafCapacity) {
+            insertAt(*leaf, pos, key, id);
+            return true;
+        }
+
+        // Split the leaf: its upper half moves to a new leaf linked after it
+        std::uint32_t right = newLeaf();
+        leaf = &leaves[node];
+        Leaf& fresh = leaves[right];
+        std::size_t half = kLeafCapacity / 2;
+        fresh.count = static_cast<std::uint16_t>(leaf->count - half);
+        std::copy(leaf->keys + half, leaf->keys + leaf->count, fresh.keys);
+        std::copy(leaf->ids + half, leaf->ids + leaf->count, fresh.ids);
+        leaf->count = static_cast<std::uint16_t>(half);
+        fresh.prev = node;
+        fresh.next = leaf->next;
+        if (leaf->next != kNone) leaves[leaf->next].prev = right;
+        leaf->next = right;
+        if (pos <= half) {
+            insertAt(*leaf, pos, key, id);
+        } else {
+            insertAt(fresh, pos - half, key, id);
+        }
+
+        // Pass the new leaf's first entry up, splitting full parents on the way
+        Key separator = fresh.keys[0];
+        DocId separatorId = fresh.ids[0];
+        std::uint32_t child = right;
+        for (std::size_t level = height; level-- > 0;) {
+            if (!insertSeparator(path[level], slots[level], separator, separatorId, child)) return true;
+        }
+        std::uint32_t top = newInner();
+        Inner& newRoot = inners[top];
+        newRoot.count = 1;
+        newRoot.keys[0] = separator;
+        newRoot.ids[0] = separatorId;
+        newRoot.children[0] = root;
+        newRoot.children[1] = child;
+        root = top;
+        ++height;
+        return true;
+    }
+
+    // Removes (key, id); false if it is not present
+    bool erase(Key key, DocId id) {
+        if (root == kNone) return false;
+        Leaf& leaf = leaves[findLeaf(key, id)];
+        std::size_t pos = lowerIn(leaf, key, id);
+        if (pos == leaf.count || leaf.keys[pos] != key || leaf.ids[pos] != id) return false;
+        std::copy(leaf.keys + pos + 1, leaf.keys + leaf.count, leaf.keys + pos);
+        std::copy(leaf.ids + pos + 1, leaf.ids + leaf.count, leaf.ids + pos);
+        --leaf.count;
+        --entries;
+        return true;
+    }
+
+    // Replaces the contents with entries, packing the leaves full: O(n) after
+    // sorting, and scans touch as few nodes as possible
+    void assign(std::vector<Entry> sorted) {
+        clear();
+        std::sort(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) {
+            return less(a.key, a.id, b.key, b.id);
+        });
+        sorted.erase(std::unique(sorted.begin(), sorted.end(), [](const Entry& a, const Entry& b) {
+            return a.key == b.key && a.id == b.id;
+        }), sorted.end());
+        if (sorted.empty()) return;
+        entries = sorted.size();
+
+        std::vector<std::uint32_t> level;
+        std::vector<Entry> lowest;      // First entry below each node of the level
+        leaves.reserve((sorted.size() + kLeafCapacity - 1) / kLeafCapacity);
+        for (std::size_t i = 0; i < sorted.size(); i += kLeafCapacity) {
+            std::uint32_t index = newLeaf();
+            Leaf& leaf = leaves[index];
+            std::size_t end = std::min(i + kLeafCapacity, sorted.size());
+            for (std::size_t j = i; j < end; ++j) {
+                leaf.keys[j - i] = sorted[j].key;
+                leaf.ids[j - i] = sorted[j].id;
+            }
+            leaf.count = static_cast<std::uint16_t>(end - i);
+            if (!level.empty()) {
+                leaf.prev = level.back();
+                leaves[level.back()].next = index;
+            }
+            level.push_back(index);
+            lowest.push_back(sorted[i]);
+        }
+
+        while (level.size() > 1) {
+            std::vector<std::uint32_t> parents;
+            std::vector<Entry> parentLowest;
+            for (std::size_t i = 0; i < level.size(); i += kInnerCapacity + 1) {
+                std::uint32_t index = newInner();
+                Inner& inner = inners[index];
+                std::size_t end = std::min(i + kInnerCapacity + 1, level.size());
+                for (std::size_t j = i; j < end; ++j) {
+                    inner.children[j - i] = level[j];
+                    if (j > i) {
+                        inner.keys[j - i - 1] = lowest[j].key;
+                        inner.ids[j - i - 1] = lowest[j].id;
+                    }
+                }
+                inner.count = static_cast<std::uint16_t>(end - i - 1);
+                parents.push_back(index);
+                parentLowest.push_back(lowest[i]);
+            }
+            level = std::move(parents);
+            lowest = std::move(parentLowest);
+            ++height;
+        }
+        root = level.front();
+    }
+
+    // Calls visit(entry) on the entries from (key, id) upwards, in order,
+    // until it returns false
+    template<typename Visit>
+    void scanUp(Key key, DocId id, Visit visit) const {
+        if (root == kNone) return;
+        std::uint32_t node = findLeaf(key, id);
+        std::size_t pos = lowerIn(leaves[node], key, id);
+        for (; node != kNone; node = leaves[node].next, pos = 0) {
+            const Leaf& leaf = leaves[node];
+            for (; pos < leaf.count; ++pos) {
+                if (!visit(Entry{leaf.keys[pos], leaf.ids[pos]})) return;
+            }
+        }
+    }
+
+    // Calls visit(entry) on the entries from (key, id) downwards, in reverse
+    // order, until it returns false
+    template<typename Visit>
+    void scanDown(Key key, DocId id, Visit visit) const {
+        if (root == kNone) return;
+        std::uint32_t node = findLeaf(key, id);
+        std::size_t pos = upperIn(leaves[node], key, id);
+        while (node != kNone) {
+            const Leaf& leaf = leaves[node];
+            while (pos > 0) {
+                --pos;
+                if (!visit(Entry{leaf.keys[pos], leaf.ids[pos]})) return;
+            }
+            node = leaf.prev;
+            if (node != kNone) pos = leaves[node].count;
+        }
+    }
+};
+
+}
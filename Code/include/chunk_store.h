@@ -0,0 +1,172 @@
+#pragma once
+#include "storage.h"
+#include "binary_io.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <optional>
+#include <fstream>
+#include <cstdint>
+#include <cstddef>
+
+namespace uni {
+
+// ============================================================================
+// SHA-256
+// ============================================================================
+
+using ContentHash = std::array<std::uint8_t, 32>;
+
+class Sha256 {
+private:
+    std::array<std::uint32_t, 8> state;
+    std::array<std::uint8_t, 64> block{};
+    std::size_t blockSize = 0;
+    std::uint64_t totalBytes = 0;
+
+    void compress(const std::uint8_t* data);
+
+public:
+    Sha256();
+
+    void update(const void* data, std::size_t size);
+    ContentHash finish();
+
+    // Running state, so a later process can continue the hash (resumed uploads)
+    void saveState(BinaryWriter& out) const;
+    bool loadState(BinaryReader& in);
+
+    static ContentHash of(const void* data, std::size_t size);
+    static std::string hex(const ContentHash& hash);
+};
+
+// ============================================================================
+// Content-Addressed Chunk Store (deduplicated resource storage)
+// ============================================================================
+// Stored files are cut into content-defined chunks: a Gear rolling hash picks
+// cut points from the bytes themselves (2 KiB min, ~8 KiB average, 64 KiB
+// max), so an insertion only moves the boundaries near it and the rest of a
+// near-identical file still yields the same chunks. Each chunk is written
+// once under <root>/<2 hex>/<SHA-256 hex>; the path the file was stored at
+// holds a small manifest listing its chunks, its logical size and the hash
+// of the whole file. Chunks are written without a flush each; one syncfs
+// makes them durable before the manifest, the commit point, is replaced. A
+// file hash index (<root>/files/<hex>) maps contents to a path holding them;
+// store() reports such a duplicate from the hash it takes while chunking.
+//
+// Files placed in the resource tree by other means stay plain files; every
+// reader below accepts both.
+//
+// Transfers of kResumableBytes or more are journaled (transfer_journal.h) in
+// steps of about kTransferBlock and spread over up to kMaxTransferThreads
+// workers. An upload records each step's chunks with the CRC32C of their
+// bytes and the whole-file hash state, under <root>/journals; a download
+// writes fixed-size blocks to <dst>.part and records each block's CRC32C in
+// <dst>.journal. Retrying an interrupted transfer checks the recorded steps
+// against the data on disk and carries on after the last one that matches.
+
+struct ChunkRef {
+    ContentHash hash;
+    std::uint32_t size;
+};
+
+struct ChunkManifest {
+    std::uint64_t size = 0;
+    ContentHash fileHash{};
+    std::vector<ChunkRef> chunks;
+};
+
+// Outcome of storing one file
+struct ChunkStoreStats {
+    std::size_t chunks = 0;
+    std::size_t newChunks = 0;
+    std::uint64_t bytes = 0;      // Logical size
+    std::uint64_t newBytes = 0;   // Bytes actually written to the chunk store
+    std::uint64_t resumedBytes = 0;  // Bytes an interrupted earlier upload had stored
+    std::string duplicateOf;      // A stored path that already had the same contents, if any
+};
+
+// Outcome of a sweep of unreferenced chunks
+struct ChunkSweepStats {
+    std::size_t manifests = 0;
+    std::size_t removedChunks = 0;
+    std::uint64_t removedBytes = 0;
+};
+
+class ChunkStore {
+private:
+    std::string root;
+
+    std::string fileIndexPath(const ContentHash& hash) const;
+    std::string sweepMarkerPath() const;
+    std::string journalPath(const std::string& dst) const;
+    std::optional<std::string> storedPathOf(const ContentHash& hash) const;
+    bool syncChunks() const;
+
+    std::optional<std::string> restoreBlocks(const std::string& path, const std::optional<ChunkManifest>& manifest,
+                                             std::uint64_t size, const std::string& dst,
+                                             const TransferCallback& progress) const;
+
+public:
+    static constexpr std::size_t kMinChunk = 2 * 1024;
+    static constexpr std::size_t kAverageChunk = 8 * 1024;
+    static constexpr std::size_t kMaxChunk = 64 * 1024;
+    static constexpr std::uint64_t kResumableBytes = 64ull << 20;
+    static constexpr std::size_t kTransferBlock = 8 << 20;
+    static constexpr std::size_t kMaxTransferThreads = 4;
+
+    explicit ChunkStore(std::string rootDir) : root(std::move(rootDir)) {}
+
+    std::string chunkPath(const ContentHash& hash) const;
+
+    // Lengths of the content-defined chunks of data, in order
+    static std::vector<std::size_t> cutPoints(const char* data, std::size_t size);
+
+    // Stores src's contents as a manifest at dst, writing only chunks the
+    // store lacks. Returns an error message on failure; a large upload then
+    // resumes where it stopped when stored again.
+    std::optional<std::string> store(const std::string& src, const std::string& dst,
+                                     ChunkStoreStats* stats = nullptr, const TransferCallback& progress = nullptr);
+
+    // Writes the contents of a stored path (manifest or plain file) to dst,
+    // checking every chunk against its hash. Returns an error message on
+    // failure; a large download then resumes from dst's .part file.
+    std::optional<std::string> restore(const std::string& path, const std::string& dst,
+                                       const TransferCallback& progress = nullptr) const;
+
+    // Flags that manifests were dropped or replaced, so sweepIfMarked() has work
+    void markForSweep() const;
+
+    // Deletes chunks no manifest under resourcesRoot (or upload journal) refers
+    // to, if a sweep was marked. Manifests are read in full, so this runs at
+    // startup rather than on every removal. Journals of uploads abandoned for
+    // a week go too.
+    ChunkSweepStats sweepIfMarked(const std::string& resourcesRoot) const;
+
+    // The manifest at path; nullopt for plain files and unreadable paths
+    static std::optional<ChunkManifest> readManifest(const std::string& path);
+
+    // Logical size of a stored path (a manifest's file size, not its own)
+    static std::optional<std::uint64_t> storedSize(const std::string& path);
+};
+
+// Sequential reader over a stored path's contents, manifest or plain file
+class StoredFileReader {
+private:
+    ChunkStore chunks;
+    std::ifstream file;
+    std::optional<ChunkManifest> manifest;
+    std::size_t nextChunk = 0;
+
+    bool openNextChunk();
+
+public:
+    explicit StoredFileReader(ChunkStore store) : chunks(std::move(store)) {}
+
+    bool open(const std::string& path);
+
+    // Fills up to size bytes; returns 0 at the end (or on a missing chunk)
+    std::size_t read(char* out, std::size_t size);
+};
+
+}
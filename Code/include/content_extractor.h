@@ -0,0 +1,52 @@
+#pragma once
+#include "tokenizer.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <functional>
+#include <cstdint>
+
+namespace uni {
+
+// ============================================================================
+// Streaming Content Extraction for Full-Text Indexing
+// ============================================================================
+// Files are read in fixed-size chunks and their text is handed to a sink as it
+// is decoded, so memory stays bounded by a few chunk buffers regardless of
+// file size. Plain text, Markdown and source files pass through as is; for
+// PDFs the page content streams are inflated on the fly and the strings shown
+// by text operators are emitted. Other binary files produce no text.
+
+inline constexpr std::size_t kContentChunkSize = 64 * 1024;
+
+using TextSink = std::function<void(std::string_view)>;
+
+// Streams the text of the file at path into sink. Returns false if the file
+// cannot be read or has no extractable text.
+bool extractText(const std::string& path, const TextSink& sink);
+
+// Counts index terms over streamed text. Words may span chunk boundaries.
+// Distinct terms are capped, so a huge document cannot grow the table without
+// bound: once full, only terms already seen keep counting.
+class StreamingTermCounter {
+private:
+    std::unordered_map<std::string, std::uint32_t> counts;
+    std::size_t maxTerms;
+    std::uint64_t total = 0;
+    Tokenizer tokenizer;
+    std::string carry;   // Trailing word of the last chunk, completed by the next
+    std::string key;     // Reused lookup key, so repeated terms cost no allocation
+
+    void count(std::string_view text);
+
+public:
+    explicit StreamingTermCounter(std::size_t maxDistinctTerms) : maxTerms(maxDistinctTerms) {}
+
+    void feed(std::string_view text);
+    void finish();
+
+    const std::unordered_map<std::string, std::uint32_t>& terms() const { return counts; }
+    std::uint64_t termCount() const { return total; }
+};
+
+}
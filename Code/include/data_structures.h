@@ -6,7 +6,11 @@
 #include <queue>
 #include <stack>
 #include <list>
+#include <map>
+#include <tuple>
 #include <functional>
+#include <algorithm>
+#include <cstdint>
 
 namespace uni {
 
@@ -18,201 +22,584 @@ struct Resource;
 // ============================================================================
 // AVL Tree Implementation
 // ============================================================================
-template<typename T>
+// Nodes live in one contiguous pool and link by 32-bit indices, so a node
+// costs its value plus 13 bytes and no allocation of its own. The comparator
+// is a template parameter (inlined, no std::function), and insert and
+// traversal are iterative: an insert records its path and rebalances on the
+// way back up, stopping once a subtree's height is unchanged.
+//
+// Every node also counts its subtree, which makes the tree order-statistic:
+// rank() and select() convert between values and positions, and
+// forEachFrom() streams values from any position, each in O(log n) plus the
+// values visited.
+template<typename T, typename Compare = std::less<T>>
 class AVLTree {
 private:
+    static constexpr std::uint32_t kNil = UINT32_MAX;
+    static constexpr std::size_t kMaxDepth = 64;    // An AVL tree of 2^32 nodes is under 47 deep
+    
     struct Node {
         T data;
-        int height;
-        std::shared_ptr<Node> left, right;
+        std::uint32_t left = kNil;
+        std::uint32_t right = kNil;
+        std::uint32_t count = 1;    // Nodes in this subtree
+        std::uint8_t height = 1;
         
-        Node(const T& val) : data(val), height(1), left(nullptr), right(nullptr) {}
+        explicit Node(const T& val) : data(val) {}
     };
     
-    using NodePtr = std::shared_ptr<Node>;
-    NodePtr root;
-    std::function<bool(const T&, const T&)> compare;
+    std::vector<Node> nodes;
+    std::uint32_t root = kNil;
+    Compare compare;
     
-    int getHeight(NodePtr node) { return node ? node->height : 0; }
-    int getBalance(NodePtr node) { return node ? getHeight(node->left) - getHeight(node->right) : 0; }
+    int getHeight(std::uint32_t node) const { return node == kNil ? 0 : nodes[node].height; }
+    int getBalance(std::uint32_t node) const { return getHeight(nodes[node].left) - getHeight(nodes[node].right); }
+    std::size_t getCount(std::uint32_t node) const { return node == kNil ? 0 : nodes[node].count; }
     
-    void updateHeight(NodePtr node) {
-        if (node) node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+    void updateHeight(std::uint32_t node) {
+        Node& current = nodes[node];
+        current.height = static_cast<std::uint8_t>(1 + std::max(getHeight(current.left), getHeight(current.right)));
+        current.count = static_cast<std::uint32_t>(1 + getCount(current.left) + getCount(current.right));
     }
     
-    NodePtr rotateRight(NodePtr y) {
-        NodePtr x = y->left;
-        NodePtr T2 = x->right;
-        x->right = y;
-        y->left = T2;
+    std::uint32_t rotateRight(std::uint32_t y) {
+        std::uint32_t x = nodes[y].left;
+        nodes[y].left = nodes[x].right;
+        nodes[x].right = y;
         updateHeight(y);
         updateHeight(x);
         return x;
     }
     
-    NodePtr rotateLeft(NodePtr x) {
-        NodePtr y = x->right;
-        NodePtr T2 = y->left;
-        y->left = x;
-        x->right = T2;
+    std::uint32_t rotateLeft(std::uint32_t x) {
+        std::uint32_t y = nodes[x].right;
+        nodes[x].right = nodes[y].left;
+        nodes[y].left = x;
         updateHeight(x);
         updateHeight(y);
         return y;
     }
     
-    NodePtr insert(NodePtr node, const T& data) {
-        if (!node) return std::make_shared<Node>(data);
-        
-        if (compare(data, node->data)) {
-            node->left = insert(node->left, data);
-        } else if (compare(node->data, data)) {
-            node->right = insert(node->right, data);
-        } else {
-            return node; // Duplicate
-        }
-        
+    // Restores the balance of node's subtree; returns its new root
+    std::uint32_t rebalance(std::uint32_t node) {
         updateHeight(node);
         int balance = getBalance(node);
-        
-        // Left Left Case
-        if (balance > 1 && compare(data, node->left->data)) {
+        if (balance > 1) {
+            if (getBalance(nodes[node].left) < 0) nodes[node].left = rotateLeft(nodes[node].left);
             return rotateRight(node);
         }
-        // Right Right Case
-        if (balance < -1 && compare(node->right->data, data)) {
+        if (balance < -1) {
+            if (getBalance(nodes[node].right) > 0) nodes[node].right = rotateRight(nodes[node].right);
             return rotateLeft(node);
         }
-        // Left Right Case
-        if (balance > 1 && compare(node->left->data, data)) {
-            node->left = rotateLeft(node->left);
-            return rotateRight(node);
-        }
-        // Right Left Case
-        if (balance < -1 && compare(data, node->right->data)) {
-            node->right = rotateRight(node->right);
-            return rotateLeft(node);
+        return node;
+    }
+
+public:
+    explicit AVLTree(Compare comp = Compare()) : compare(std::move(comp)) {}
+    
+    // Adds data unless an equal value is present; returns whether it was added
+    bool insert(const T& data) {
+        std::uint32_t path[kMaxDepth];
+        std::size_t depth = 0;
+        for (std::uint32_t node = root; node != kNil;) {
+            const Node& current = nodes[node];
+            path[depth++] = node;
+            if (compare(data, current.data)) {
+                node = current.left;
+            } else if (compare(current.data, data)) {
+                node = current.right;
+            } else {
+                return false; // Duplicate
+            }
         }
         
-        return node;
+        std::uint32_t child = static_cast<std::uint32_t>(nodes.size());
+        nodes.emplace_back(data);
+        
+        // Link the new leaf, then rebalance upwards until a height stays the same
+        while (depth > 0) {
+            std::uint32_t parent = path[--depth];
+            if (compare(nodes[child].data, nodes[parent].data)) {
+                nodes[parent].left = child;
+            } else {
+                nodes[parent].right = child;
+            }
+            int before = nodes[parent].height;
+            child = rebalance(parent);
+            if (child == parent && nodes[parent].height == before) {
+                // Nothing above changes shape; its subtrees just grew by one
+                while (depth > 0) ++nodes[path[--depth]].count;
+                return true;
+            }
+        }
+        root = child;
+        return true;
     }
     
-    void inorder(NodePtr node, std::vector<T>& result) {
-        if (node) {
-            inorder(node->left, result);
-            result.push_back(node->data);
-            inorder(node->right, result);
+    bool contains(const T& data) const {
+        for (std::uint32_t node = root; node != kNil;) {
+            const Node& current = nodes[node];
+            if (compare(data, current.data)) {
+                node = current.left;
+            } else if (compare(current.data, data)) {
+                node = current.right;
+            } else {
+                return true;
+            }
         }
+        return false;
     }
-
-public:
-    AVLTree(std::function<bool(const T&, const T&)> comp = std::less<T>()) : root(nullptr), compare(comp) {}
     
-    void insert(const T& data) { root = insert(root, data); }
+    // Visits the values in order
+    template<typename Visit>
+    void forEach(Visit visit) const {
+        std::uint32_t stack[kMaxDepth];
+        std::size_t depth = 0;
+        std::uint32_t node = root;
+        while (node != kNil || depth > 0) {
+            for (; node != kNil; node = nodes[node].left) stack[depth++] = node;
+            node = stack[--depth];
+            visit(nodes[node].data);
+            node = nodes[node].right;
+        }
+    }
     
-    std::vector<T> getSorted() {
+    // Number of values ordered before value: the position of its lower bound
+    std::size_t rank(const T& value) const {
+        std::size_t before = 0;
+        for (std::uint32_t node = root; node != kNil;) {
+            const Node& current = nodes[node];
+            if (compare(current.data, value)) {
+                before += getCount(current.left) + 1;
+                node = current.right;
+            } else {
+                node = current.left;
+            }
+        }
+        return before;
+    }
+    
+    // The value at position index in order, or nullptr past the end
+    const T* select(std::size_t index) const {
+        for (std::uint32_t node = root; node != kNil;) {
+            const Node& current = nodes[node];
+            std::size_t leftCount = getCount(current.left);
+            if (index < leftCount) {
+                node = current.left;
+            } else if (index == leftCount) {
+                return &current.data;
+            } else {
+                index -= leftCount + 1;
+                node = current.right;
+            }
+        }
+        return nullptr;
+    }
+    
+    // Visits the values in order starting at position index, until visit
+    // returns false
+    template<typename Visit>
+    void forEachFrom(std::size_t index, Visit visit) const {
+        // Descend to the start, stacking the ancestors still to be visited
+        std::uint32_t stack[kMaxDepth];
+        std::size_t depth = 0;
+        for (std::uint32_t node = root; node != kNil;) {
+            const Node& current = nodes[node];
+            std::size_t leftCount = getCount(current.left);
+            if (index <= leftCount) {
+                stack[depth++] = node;
+                if (index == leftCount) break;
+                node = current.left;
+            } else {
+                index -= leftCount + 1;
+                node = current.right;
+            }
+        }
+        while (depth > 0) {
+            std::uint32_t node = stack[--depth];
+            if (!visit(nodes[node].data)) return;
+            for (node = nodes[node].right; node != kNil; node = nodes[node].left) stack[depth++] = node;
+        }
+    }
+    
+    std::vector<T> getSorted() const {
         std::vector<T> result;
-        inorder(root, result);
+        result.reserve(nodes.size());
+        forEach([&result](const T& value) { result.push_back(value); });
         return result;
     }
+    
+    std::size_t size() const { return nodes.size(); }
+    bool empty() const { return nodes.empty(); }
+    void reserve(std::size_t count) { nodes.reserve(count); }
+    
+    // Releases the pool
+    void clear() {
+        nodes = std::vector<Node>();
+        root = kNil;
+    }
 };
 
 // ============================================================================
 // Binary Search Tree Implementation
 // ============================================================================
-template<typename T>
-class BST {
+// Kept balanced (an AVLTree underneath): sorted inserts, the common case for
+// ids and names, would otherwise degrade a plain BST into a list.
+template<typename T, typename Compare = std::less<T>>
+class BST : public AVLTree<T, Compare> {
+public:
+    using AVLTree<T, Compare>::AVLTree;
+    
+    std::vector<T> searchAll() const {
+        return this->getSorted(); // Return all elements for simple search
+    }
+};
+
+// ============================================================================
+// Radix Trie Autocomplete with Top-K Ranking
+// ============================================================================
+// Path-compressed trie over words. Every node caches the k best completions of
+// its subtree (highest score first, ties alphabetical), so a lookup costs
+// O(|prefix| + k) and an insert or score bump only touches one root-to-leaf path.
+class RadixTrie {
 private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+    
     struct Node {
-        T data;
-        std::shared_ptr<Node> left, right;
-        
-        Node(const T& val) : data(val), left(nullptr), right(nullptr) {}
+        std::string label;                              // Edge label leading into this node
+        std::vector<std::pair<char, uint32_t>> children; // Sorted by first label byte
+        std::vector<uint32_t> top;                      // Best terminal nodes of this subtree
+        std::string word;                               // Full word (terminal nodes only)
+        long long score = 0;
+        bool terminal = false;
     };
     
-    using NodePtr = std::shared_ptr<Node>;
-    NodePtr root;
-    std::function<bool(const T&, const T&)> compare;
+    std::vector<Node> nodes;
+    std::size_t k;
+    std::size_t wordCount = 0;
+    
+    static bool byFirstChar(const std::pair<char, uint32_t>& edge, char c) { return edge.first < c; }
+    
+    bool ranksBefore(uint32_t a, uint32_t b) const {
+        if (nodes[a].score != nodes[b].score) return nodes[a].score > nodes[b].score;
+        return nodes[a].word < nodes[b].word;
+    }
+    
+    uint32_t newNode(std::string label) {
+        nodes.emplace_back();
+        nodes.back().label = std::move(label);
+        return static_cast<uint32_t>(nodes.size() - 1);
+    }
     
-    NodePtr insert(NodePtr node, const T& data) {
-        if (!node) return std::make_shared<Node>(data);
+    // Walks (and optionally extends) the trie along word, recording visited nodes
+    uint32_t locate(const std::string& word, std::vector<uint32_t>& path, bool create) {
+        uint32_t cur = 0;
+        std::size_t pos = 0;
+        path.assign(1, 0);
         
-        if (compare(data, node->data)) {
-            node->left = insert(node->left, data);
-        } else if (compare(node->data, data)) {
-            node->right = insert(node->right, data);
+        while (pos < word.size()) {
+            auto& edges = nodes[cur].children;
+            auto it = std::lower_bound(edges.begin(), edges.end(), word[pos], byFirstChar);
+            if (it == edges.end() || it->first != word[pos]) {
+                if (!create) return kNone;
+                std::size_t slot = it - edges.begin();
+                uint32_t leaf = newNode(word.substr(pos));
+                nodes[cur].children.insert(nodes[cur].children.begin() + slot, {word[pos], leaf});
+                path.push_back(leaf);
+                return leaf;
+            }
+            
+            uint32_t child = it->second;
+            const std::string& label = nodes[child].label;
+            std::size_t common = 0;
+            while (common < label.size() && pos + common < word.size() && label[common] == word[pos + common]) {
+                ++common;
+            }
+            
+            if (common < label.size()) {
+                if (!create) return kNone;
+                // Split the edge: an intermediate node takes over the shared part of the label
+                std::size_t slot = it - edges.begin();
+                uint32_t mid = newNode(label.substr(0, common));
+                nodes[child].label.erase(0, common);
+                nodes[mid].children.push_back({nodes[child].label[0], child});
+                nodes[mid].top = nodes[child].top;
+                nodes[cur].children[slot].second = mid;
+                child = mid;
+            }
+            
+            cur = child;
+            pos += common;
+            path.push_back(cur);
         }
-        // Ignore duplicates
         
-        return node;
+        return cur;
     }
     
-    void inorder(NodePtr node, std::vector<T>& result) {
-        if (node) {
-            inorder(node->left, result);
-            result.push_back(node->data);
-            inorder(node->right, result);
+    // Moves target into (or up within) a node's cached top-k after its score grew
+    void promote(uint32_t node, uint32_t target) {
+        auto& top = nodes[node].top;
+        auto it = std::find(top.begin(), top.end(), target);
+        if (it == top.end()) {
+            if (top.size() < k) {
+                top.push_back(target);
+            } else if (ranksBefore(target, top.back())) {
+                top.back() = target;
+            } else {
+                return;
+            }
+            it = top.end() - 1;
+        }
+        while (it != top.begin() && ranksBefore(*it, *(it - 1))) {
+            std::iter_swap(it, it - 1);
+            --it;
         }
     }
     
-    void search(NodePtr node, const std::string& query, std::vector<T>& results) {
-        if (!node) return;
-        
-        // For string-based search, we need to convert T to string for comparison
-        // This is a simplified approach
-        search(node->left, query, results);
-        search(node->right, query, results);
+    // Recomputes a node's cached top-k from its own word and its children's
+    // caches (after a score in its subtree dropped or a word left it)
+    void refresh(uint32_t node) {
+        std::vector<uint32_t> candidates;
+        if (nodes[node].terminal) candidates.push_back(node);
+        for (const auto& edge : nodes[node].children) {
+            const auto& childTop = nodes[edge.second].top;
+            candidates.insert(candidates.end(), childTop.begin(), childTop.end());
+        }
+        std::size_t keep = std::min(k, candidates.size());
+        std::partial_sort(candidates.begin(), candidates.begin() + keep, candidates.end(),
+                          [this](uint32_t a, uint32_t b) { return ranksBefore(a, b); });
+        candidates.resize(keep);
+        nodes[node].top = std::move(candidates);
     }
 
 public:
-    BST(std::function<bool(const T&, const T&)> comp = std::less<T>()) : root(nullptr), compare(comp) {}
+    explicit RadixTrie(std::size_t topK = 10) : k(topK) { nodes.emplace_back(); }
     
-    void insert(const T& data) { root = insert(root, data); }
+    // Adds word if it is new and raises its score by weight (weight must be >= 0)
+    void insert(const std::string& word, long long weight = 0) {
+        if (word.empty()) return;
+        
+        std::vector<uint32_t> path;
+        uint32_t node = locate(word, path, true);
+        if (!nodes[node].terminal) {
+            nodes[node].terminal = true;
+            nodes[node].word = word;
+            ++wordCount;
+        }
+        nodes[node].score += weight;
+        
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            promote(*it, node);
+        }
+    }
     
-    std::vector<T> getSorted() {
-        std::vector<T> result;
-        inorder(root, result);
-        return result;
+    // Lowers word's score by weight (weight must be >= 0), dropping the word
+    // itself when remove is set. Only the caches on its path are recomputed;
+    // emptied nodes stay in place until the trie is rebuilt.
+    void lower(const std::string& word, long long weight, bool remove = false) {
+        if (word.empty()) return;
+        
+        std::vector<uint32_t> path;
+        uint32_t node = locate(word, path, false);
+        if (node == kNone || !nodes[node].terminal) return;
+        
+        nodes[node].score -= weight;
+        if (remove) {
+            nodes[node].terminal = false;
+            nodes[node].word.clear();
+            nodes[node].score = 0;
+            --wordCount;
+        }
+        for (auto it = path.rbegin(); it != path.rend(); ++it) {
+            refresh(*it);
+        }
     }
     
-    std::vector<T> searchAll() {
-        return getSorted(); // Return all elements for simple search
+    // Up to limit words starting with prefix, best ranked first (limit is capped at k)
+    std::vector<std::string> getWordsWithPrefix(const std::string& prefix, std::size_t limit = SIZE_MAX) const {
+        std::vector<std::string> results;
+        uint32_t cur = 0;
+        std::size_t pos = 0;
+        
+        while (pos < prefix.size()) {
+            const auto& edges = nodes[cur].children;
+            auto it = std::lower_bound(edges.begin(), edges.end(), prefix[pos], byFirstChar);
+            if (it == edges.end() || it->first != prefix[pos]) return results;
+            
+            const std::string& label = nodes[it->second].label;
+            std::size_t n = std::min(label.size(), prefix.size() - pos);
+            if (label.compare(0, n, prefix, pos, n) != 0) return results;
+            
+            cur = it->second;
+            pos += label.size();
+        }
+        
+        const auto& top = nodes[cur].top;
+        for (std::size_t i = 0; i < top.size() && i < limit; ++i) {
+            results.push_back(nodes[top[i]].word);
+        }
+        return results;
     }
+    
+    // Up to limit words starting with something within maxEdits edits of prefix.
+    // Walks the trie carrying one Levenshtein DP row per character. A word's
+    // distance is the smallest last entry of the rows along its path, so the
+    // walk goes on below a match while the row minimum could still beat it.
+    // Once it cannot (or exceeds maxEdits), every word below has the distance
+    // found so far and the node contributes its cached top-k. Closer matches
+    // rank first, then by score.
+    std::vector<std::string> getWordsWithFuzzyPrefix(const std::string& prefix, std::size_t maxEdits,
+                                                     std::size_t limit = SIZE_MAX) const {
+        const std::size_t m = prefix.size();
+        constexpr std::size_t kNoMatch = SIZE_MAX;
+        std::vector<std::pair<std::size_t, uint32_t>> hits;   // (distance, terminal node)
+        
+        // Whether a node with this row and best distance so far has words
+        // below it that match more closely
+        auto improvable = [maxEdits](std::size_t least, std::size_t matched) {
+            return least <= maxEdits && least < matched;
+        };
+        auto collect = [&](uint32_t node, std::size_t distance) {
+            if (distance == kNoMatch) return;
+            for (uint32_t word : nodes[node].top) hits.emplace_back(distance, word);
+        };
+        
+        std::vector<std::size_t> rootRow(m + 1);
+        for (std::size_t i = 0; i <= m; ++i) rootRow[i] = i;
+        std::size_t rootMatched = m <= maxEdits ? m : kNoMatch;
+        
+        // (node, DP row after its label, closest match on its path)
+        std::vector<std::tuple<uint32_t, std::vector<std::size_t>, std::size_t>> stack;
+        if (improvable(0, rootMatched)) stack.emplace_back(0, rootRow, rootMatched);
+        else collect(0, rootMatched);
+        
+        while (!stack.empty()) {
+            auto [cur, parentRow, parentMatched] = std::move(stack.back());
+            stack.pop_back();
+            // Descending: the node's own word ends here
+            if (nodes[cur].terminal && parentMatched != kNoMatch) hits.emplace_back(parentMatched, cur);
+            
+            for (const auto& edge : nodes[cur].children) {
+                uint32_t child = edge.second;
+                std::vector<std::size_t> row = parentRow;
+                std::size_t matched = parentMatched;
+                bool descend = true;
+                
+                for (char c : nodes[child].label) {
+                    std::size_t diagonal = row[0];
+                    ++row[0];
+                    std::size_t least = row[0];
+                    for (std::size_t i = 1; i <= m; ++i) {
+                        std::size_t up = row[i];
+                        row[i] = std::min({row[i] + 1, row[i - 1] + 1, diagonal + (prefix[i - 1] != c)});
+                        diagonal = up;
+                        least = std::min(least, row[i]);
+                    }
+                    if (row[m] <= maxEdits) matched = std::min(matched, row[m]);
+                    if (!improvable(least, matched)) {
+                        descend = false;
+                        break;
+                    }
+                }
+                
+                if (descend) stack.emplace_back(child, std::move(row), matched);
+                else collect(child, matched);
+            }
+        }
+        
+        std::sort(hits.begin(), hits.end(), [this](const auto& a, const auto& b) {
+            if (a.first != b.first) return a.first < b.first;
+            return ranksBefore(a.second, b.second);
+        });
+        
+        std::vector<std::string> results;
+        for (std::size_t i = 0; i < hits.size() && results.size() < limit && results.size() < k; ++i) {
+            results.push_back(nodes[hits[i].second].word);
+        }
+        return results;
+    }
+    
+    std::size_t size() const { return wordCount; }
 };
 
 // ============================================================================
-// Simple Array-based Autocomplete
+// Ranked Counter (updatable top-N by count)
 // ============================================================================
-class SimpleAutocomplete {
+// Keys are grouped into buckets of equal count, buckets ordered by descending
+// count. A count change splices the key into its new bucket in place, so there
+// is exactly one entry per key, and the top N keys are read off the front in O(N).
+template<typename K>
+class RankedCounter {
 private:
-    std::vector<std::string> words;
+    using Bucket = std::list<K>;
+    using BucketMap = std::map<long long, Bucket, std::greater<long long>>;
+    
+    struct Entry {
+        typename BucketMap::iterator bucket;
+        typename Bucket::iterator pos;
+    };
+    
+    BucketMap buckets;
+    std::unordered_map<K, Entry> entries;
+    
+    void moveTo(Entry& entry, typename BucketMap::iterator target) {
+        auto source = entry.bucket;
+        target->second.splice(target->second.begin(), source->second, entry.pos);
+        entry.bucket = target;
+        if (source->second.empty()) buckets.erase(source);
+    }
 
 public:
-    void insert(const std::string& word) {
-        // Check if word already exists to avoid duplicates
-        if (std::find(words.begin(), words.end(), word) == words.end()) {
-            words.push_back(word);
-            // Keep the array sorted for better search performance
-            std::sort(words.begin(), words.end());
+    void set(const K& key, long long count) {
+        auto target = buckets.try_emplace(count).first;
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            target->second.push_front(key);
+            entries[key] = Entry{target, target->second.begin()};
+        } else if (it->second.bucket != target) {
+            moveTo(it->second, target);
         }
     }
     
-    std::vector<std::string> getWordsWithPrefix(const std::string& prefix) {
-        std::vector<std::string> results;
-        
-        // Linear search through all words to find matches
-        for (const auto& word : words) {
-            if (word.length() >= prefix.length() && 
-                word.substr(0, prefix.length()) == prefix) {
-                results.push_back(word);
-            }
+    // Amortized O(1) for small deltas: the neighbouring bucket is used as hint
+    void increment(const K& key, long long delta = 1) {
+        auto it = entries.find(key);
+        if (it == entries.end()) {
+            set(key, delta);
+            return;
         }
-        
-        return results;
+        auto current = it->second.bucket;
+        if (delta == 0) return;
+        auto target = buckets.emplace_hint(current, current->first + delta, Bucket());
+        moveTo(it->second, target);
+    }
+    
+    void erase(const K& key) {
+        auto it = entries.find(key);
+        if (it == entries.end()) return;
+        auto bucket = it->second.bucket;
+        bucket->second.erase(it->second.pos);
+        if (bucket->second.empty()) buckets.erase(bucket);
+        entries.erase(it);
     }
     
-    std::vector<std::string> getAllWords() {
-        return words;
+    long long count(const K& key) const {
+        auto it = entries.find(key);
+        return it != entries.end() ? it->second.bucket->first : 0;
     }
+    
+    std::vector<K> top(std::size_t n) const {
+        std::vector<K> result;
+        for (auto b = buckets.begin(); b != buckets.end() && result.size() < n; ++b) {
+            for (auto k = b->second.begin(); k != b->second.end() && result.size() < n; ++k) {
+                result.push_back(*k);
+            }
+        }
+        return result;
+    }
+    
+    std::size_t size() const { return entries.size(); }
 };
 
 // ============================================================================
@@ -284,8 +671,15 @@ public:
 // ============================================================================
 template<typename T>
 class Graph {
+public:
+    struct Edge {
+        T from;
+        T to;
+        double weight;
+    };
+
 private:
-    std::unordered_map<T, std::vector<T>> adjList;
+    std::unordered_map<T, std::vector<std::pair<T, double>>> adjList;
 
 public:
     void addNode(const T& node) {
@@ -294,18 +688,33 @@ public:
         }
     }
     
-    void addEdge(const T& from, const T& to) {
+    void reserve(std::size_t nodes) { adjList.reserve(nodes); }
+    
+    void addEdge(const T& from, const T& to, double weight = 1.0) {
         addNode(from);
         addNode(to);
-        adjList[from].push_back(to);
-        adjList[to].push_back(from); // Undirected
+        adjList[from].emplace_back(to, weight);
+        adjList[to].emplace_back(from, weight); // Undirected
     }
     
     std::vector<T> getConnected(const T& node) {
-        if (adjList.find(node) != adjList.end()) {
-            return adjList[node];
+        std::vector<T> connected;
+        auto it = adjList.find(node);
+        if (it != adjList.end()) {
+            for (const auto& [other, weight] : it->second) connected.push_back(other);
         }
-        return {};
+        return connected;
+    }
+    
+    // Neighbours with their edge weights, heaviest first
+    std::vector<std::pair<T, double>> getWeighted(const T& node) const {
+        auto it = adjList.find(node);
+        if (it == adjList.end()) return {};
+        auto weighted = it->second;
+        std::stable_sort(weighted.begin(), weighted.end(), [](const auto& a, const auto& b) {
+            return a.second > b.second;
+        });
+        return weighted;
     }
     
     std::vector<T> getAllNodes() {
@@ -315,6 +724,17 @@ public:
         }
         return nodes;
     }
+    
+    // Every edge once, from its smaller endpoint
+    std::vector<Edge> getEdges() const {
+        std::vector<Edge> edges;
+        for (const auto& [node, neighbors] : adjList) {
+            for (const auto& [other, weight] : neighbors) {
+                if (node < other) edges.push_back(Edge{node, other, weight});
+            }
+        }
+        return edges;
+    }
 };
 
 }
\ No newline at end of file
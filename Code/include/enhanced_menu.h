@@ -2,10 +2,14 @@
 #include "unihub_core.h"
 #include "storage.h"
 #include "resources.h"
+#include "chunk_store.h"
 #include <iostream>
 #include <limits>
 #include <filesystem>
 #include <algorithm>
+#include <iomanip>
+#include <sstream>
+#include <ctime>
 
 namespace uni {
 
@@ -54,19 +58,9 @@ private:
         std::cout << "Branch (full name or code): "; std::getline(std::cin, p.branch);
         
         // Branch normalization
-        std::string b = p.branch;
-        std::transform(b.begin(), b.end(), b.begin(), ::toupper);
-        if (b == "COMPUTER SCIENCE AND ENGINEERING" || b == "CSE") p.branch = "CSE";
-        else if (b == "ELECTRONICS AND COMMUNICATION ENGINEERING" || b == "ECE") p.branch = "ECE";
-        else if (b == "ELECTRICAL AND ELECTRONICS ENGINEERING" || b == "EEE") p.branch = "EEE";
-        else if (b == "INSTRUMENTATION AND CONTROL ENGINEERING" || b == "ICE") p.branch = "ICE";
-        else if (b == "MECHANICAL ENGINEERING" || b == "ME") p.branch = "ME";
-        else if (b == "CHEMICAL ENGINEERING" || b == "CHE") p.branch = "CHE";
-        else if (b == "PRODUCTION ENGINEERING" || b == "PROD") p.branch = "PROD";
-        else if (b == "CIVIL ENGINEERING" || b == "CIVIL") p.branch = "CIVIL";
-        else if (b == "METALLURGICAL AND MATERIALS ENGINEERING" || b == "MME") p.branch = "MME";
-        else if (b == "ARCHITECTURE" || b == "ARCH") p.branch = "ARCH";
-        else {
+        if (auto code = normalizeBranch(p.branch)) {
+            p.branch = *code;
+        } else {
             std::cout << "Unknown branch, defaulting to CSE.\n";
             p.branch = "CSE";
         }
@@ -290,26 +284,80 @@ private:
         core.navigateTo("search", "Resource Search");
         
         std::cout << "\n===== Resource Search =====\n";
-        std::cout << "Enter search keyword: ";
+        std::cout << "Enter keywords (use OR / NOT to refine): ";
         std::string keyword;
         std::getline(std::cin, keyword);
         
-        auto results = core.searchResourcesByKeyword(keyword);
+        std::cout << "Filters, e.g. year=2 branch=CSE type=EndSemPapers (Enter for none): ";
+        std::string filterText;
+        std::getline(std::cin, filterText);
+        auto filter = parseFacetFilter(filterText);
         
-        std::cout << "\nSearch Results (" << results.size() << " found):\n";
+        core.syncResourceCatalog();
+        if (filter.empty()) {
+            auto results = core.searchResourcesRanked(keyword);
+            
+            std::cout << "\nTop Results (" << results.size() << " shown, best match first):\n";
+            printSearchResults(results);
+        } else {
+            auto search = core.searchResourcesFaceted(keyword, filter);
+            
+            std::cout << "\nTop Results (" << search.resources.size() << " of " << search.total << " matches):\n";
+            printSearchResults(search.resources);
+            printFacetCounts(search.counts);
+        }
+        
+        pause();
+    }
+    
+    void printSearchResults(const std::vector<ResourceMetadata>& results) {
         for (const auto& resource : results) {
             std::cout << "- " << resource.displayName;
             std::cout << " (" << resource.subject << " - " << resource.resourceType << ")\n";
             std::cout << "  Uploaded by: " << resource.uploader;
             std::cout << " | Downloads: " << resource.downloadCount << "\n\n";
         }
-        
-        pause();
+    }
+    
+    // "facet=value[,value...]" pairs separated by spaces; unknown facets are ignored
+    FacetFilter parseFacetFilter(const std::string& text) {
+        FacetFilter filter;
+        std::istringstream iss(text);
+        std::string pair;
+        while (iss >> pair) {
+            auto eq = pair.find('=');
+            if (eq == std::string::npos) continue;
+            std::string name = pair.substr(0, eq);
+            for (std::size_t f = 0; f < kFacetCount; ++f) {
+                if (name != kFacetNames[f]) continue;
+                std::istringstream values(pair.substr(eq + 1));
+                std::string value;
+                while (std::getline(values, value, ',')) {
+                    if (!value.empty()) filter.where(static_cast<Facet>(f), value);
+                }
+            }
+        }
+        return filter;
+    }
+    
+    void printFacetCounts(const FacetCounts& counts) {
+        const std::size_t shown = 5;
+        std::cout << "Refine by:\n";
+        for (std::size_t f = 0; f < kFacetCount; ++f) {
+            if (counts[f].size() < 2) continue;
+            std::cout << "  " << kFacetNames[f] << ":";
+            for (std::size_t i = 0; i < counts[f].size() && i < shown; ++i) {
+                std::cout << " " << counts[f][i].value << " (" << counts[f][i].count << ")";
+            }
+            if (counts[f].size() > shown) std::cout << " ...";
+            std::cout << "\n";
+        }
     }
     
     void showPopularResources() {
         core.navigateTo("popular", "Popular Resources");
         
+        core.syncResourceCatalog();
         auto popular = core.getPopularResources(10);
         
         std::cout << "\n===== Most Popular Resources =====\n";
@@ -325,6 +373,48 @@ private:
         pause();
     }
     
+    // Uploads of the last days, newest first, a page at a time
+    void showRecentResources() {
+        core.navigateTo("recent", "Recent Uploads");
+        
+        std::cout << "\n===== Recent Uploads =====\n";
+        std::cout << "Days to look back (Enter for 7): ";
+        std::string input;
+        std::getline(std::cin, input);
+        int days = 7;
+        try {
+            if (!input.empty()) days = std::max(1, std::stoi(input));
+        } catch (...) {
+            // Keep the default
+        }
+        
+        core.syncResourceCatalog();
+        auto now = std::chrono::system_clock::now();
+        auto from = now - std::chrono::hours(24) * days;
+        const std::size_t pageSize = 10;
+        std::optional<ResourceIndex::RangeCursor> cursor;
+        std::size_t shown = 0;
+        while (true) {
+            auto page = core.getResourcesUploadedBetween(from, now, pageSize, true, cursor ? &*cursor : nullptr);
+            if (page.resources.empty() && shown == 0) std::cout << "Nothing uploaded in the last " << days << " days.\n";
+            for (const auto& resource : page.resources) {
+                std::time_t uploaded = std::chrono::system_clock::to_time_t(resource.uploadTime);
+                char date[32];
+                std::strftime(date, sizeof(date), "%Y-%m-%d %H:%M", std::localtime(&uploaded));
+                std::cout << (++shown) << ") " << resource.displayName << "\n";
+                std::cout << "   " << resource.subject << " - " << resource.resourceType;
+                std::cout << " | " << date << " | " << resource.sizeBytes << " bytes\n";
+            }
+            if (!page.next) break;
+            std::cout << "\nEnter for more, 0 to stop: ";
+            std::getline(std::cin, input);
+            if (input == "0") break;
+            cursor = page.next;
+        }
+        
+        pause();
+    }
+    
     void showSubjectResources(const EnhancedSubject& subject) {
         core.navigateTo("subject_resources", subject.name);
         core.setNavigationContext("subject_code", subject.code);
@@ -363,8 +453,8 @@ private:
     void showResourceType(const EnhancedSubject& subject, const std::string& type) {
         core.navigateTo("resource_type", type);
         
-        // For now, use the original file-based system
-        // In a full implementation, we'd integrate with ResourceIndex
+        // Listings come from the resource catalog; files that appear in the
+        // folder meanwhile are indexed before the next redraw
         std::string folder = resourcesBase(subject.year, subject.semester, subject.branch, 
                                          subject.section, subject.name, type);
         
@@ -373,6 +463,7 @@ private:
             showBreadcrumbs();
             
             auto items = listResources(folder);
+            core.syncResourceCatalog();
             
             std::cout << "\n===== " << type << " for " << subject.name << " =====\n";
             
@@ -383,6 +474,7 @@ private:
             
             std::cout << "\na) Upload\n";
             std::cout << "d) Download\n";
+            std::cout << "r) Remove\n";
             std::cout << "s) Search in this type\n";
             std::cout << "0) Back\n";
             std::cout << "Choose: ";
@@ -395,6 +487,8 @@ private:
                 uploadResource(folder);
             } else if (option == "d") {
                 downloadResource(items);
+            } else if (option == "r") {
+                removeResource(items);
             } else if (option == "s") {
                 searchInResourceType(type);
             } else {
@@ -415,9 +509,15 @@ private:
         std::string localPath;
         std::getline(std::cin, localPath);
         
-        auto [success, message] = uni::uploadResource(localPath, folder);
+        std::string duplicate;
+        auto [success, message] = uni::uploadResource(localPath, folder, printTransferProgress, &duplicate);
         
         if (success) {
+            // Identical contents were already in the chunk store, so only a manifest was written
+            if (!duplicate.empty()) {
+                std::cout << "Same contents as " << duplicate << "; no extra space needed.\n";
+            }
+            
             // Create ResourceMetadata for the hybrid system
             ResourceMetadata metadata;
             metadata.filename = message; // uploadResource returns the destination path
@@ -437,8 +537,18 @@ private:
                 metadata.sizeBytes = 0;
             }
             
-            core.addResource(metadata);
-            std::cout << "Uploaded successfully: " << message << "\n";
+            // A re-upload replaces the file's index entries but keeps its history
+            auto previous = core.getResource(message);
+            if (previous) {
+                metadata.downloadCount = previous->downloadCount;
+                metadata.rating = previous->rating;
+                metadata.tags = previous->tags;
+                core.updateResource(metadata);
+                std::cout << "Replaced existing resource: " << message << "\n";
+            } else {
+                core.addResource(metadata);
+                std::cout << "Uploaded successfully: " << message << "\n";
+            }
         } else {
             std::cout << "Upload failed: " << message << "\n";
         }
@@ -468,7 +578,7 @@ private:
         std::string destPath;
         std::getline(std::cin, destPath);
         
-        auto [success, message] = uni::downloadResource(items[idx-1].filename, destPath);
+        auto [success, message] = uni::downloadResource(items[idx-1].filename, destPath, printTransferProgress);
         
         if (success) {
             // Update download count in hybrid system
@@ -481,11 +591,55 @@ private:
         pause();
     }
     
+    void removeResource(const std::vector<ResourceItem>& items) {
+        if (items.empty()) {
+            std::cout << "No files available to remove.\n";
+            pause();
+            return;
+        }
+        
+        std::cout << "Enter file number (1-" << items.size() << "): ";
+        int idx;
+        if (!(std::cin >> idx) || idx < 1 || idx > (int)items.size()) {
+            std::cin.clear();
+            std::cin.ignore(10000, '\n');
+            std::cout << "Invalid selection.\n";
+            pause();
+            return;
+        }
+        std::cin.ignore(1, '\n');
+        
+        const auto& item = items[idx-1];
+        auto stored = core.getResource(item.filename);
+        auto user = core.getCurrentUser();
+        if (stored && !stored->uploader.empty() && (!user || user->profile.email != stored->uploader)) {
+            std::cout << "Only the uploader can remove this resource.\n";
+            pause();
+            return;
+        }
+        
+        std::cout << "Remove " << item.displayName << "? (y/n): ";
+        std::string confirm;
+        std::getline(std::cin, confirm);
+        if (confirm != "y" && confirm != "Y") return;
+        
+        auto [success, message] = uni::deleteResource(item.filename);
+        if (success) {
+            core.removeResource(item.filename);
+            std::cout << "Removed: " << item.displayName << "\n";
+        } else {
+            std::cout << "Remove failed: " << message << "\n";
+        }
+        
+        pause();
+    }
+    
     void searchInResourceType(const std::string& type) {
         std::cout << "\nSearch " << type << ": ";
         std::string query;
         std::getline(std::cin, query);
         
+        core.syncResourceCatalog();
         auto suggestions = core.autocompleteResourceName(query);
         
         if (!suggestions.empty()) {
@@ -510,18 +664,140 @@ private:
         if (!related.empty()) {
             std::cout << "\nRelated Resources:\n";
             for (const auto& rel : related) {
-                std::cout << "- " << rel << "\n";
+                std::cout << "- " << rel.filename << " (" << static_cast<int>(rel.weight * 100 + 0.5) << "% similar)\n";
             }
         }
         
         pause();
     }
 
-public:
-    void run() {
+    // One status line, rewritten in place: "  42% 1.1/2.6 GiB at 380.2 MiB/s (copy_file_range)"
+    static void printTransferProgress(const TransferProgress& progress) {
+        auto scaled = [](double bytes, const char*& unit) {
+            static const char* const units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+            std::size_t i = 0;
+            for (; bytes >= 1024 && i + 1 < std::size(units); ++i) bytes /= 1024;
+            unit = units[i];
+            return bytes;
+        };
+        const char* totalUnit;
+        const char* rateUnit;
+        double total = scaled(static_cast<double>(progress.totalBytes), totalUnit);
+        double done = total * (progress.totalBytes ? static_cast<double>(progress.bytesDone) / progress.totalBytes : 1.0);
+        double rate = scaled(progress.bytesPerSecond(), rateUnit);
+        int percent = progress.totalBytes ? static_cast<int>(100 * progress.bytesDone / progress.totalBytes) : 100;
+        
+        std::cout << "\r" << std::setw(4) << percent << "% " << std::fixed << std::setprecision(1)
+                  << done << "/" << total << " " << totalUnit << " at " << rate << " " << rateUnit << "/s ("
+                  << progress.method << ")   ";
+        if (progress.bytesDone >= progress.totalBytes) std::cout << "\n";
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6) << std::flush;
+    }
+    
+    void printIndexStats(const BulkIndexStats& stats) {
+        std::cout << "Indexed " << stats.files << " resources in " << stats.directories
+                  << " directories on " << stats.threads << " threads\n";
+        std::cout << std::fixed << std::setprecision(2)
+                  << "Scan " << stats.scanSeconds << "s, merge " << stats.mergeSeconds << "s ("
+                  << std::setprecision(0) << stats.filesPerSecond() << " files/s)\n";
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    
+    void prepareDirectories() {
         ensureDir(dataDir());
-        ensureDir(usersDir());
         ensureDir(resourcesDir());
+        ensureDir(indexDir());
+        ensureDir(chunksDir());
+        // Chunks left unreferenced by removals in earlier sessions
+        ChunkStore(chunksDir()).sweepIfMarked(resourcesDir());
+        
+        // A first run imports the users of an earlier version; say who did not make it
+        std::vector<std::string> skipped;
+        if (auto error = openUsersDatabase(&skipped)) std::cout << "Error: " << *error << "\n";
+        if (!skipped.empty()) {
+            std::cout << "Could not import " << skipped.size() << " users (their files remain in "
+                      << usersDir() << "):\n";
+            for (const auto& user : skipped) std::cout << "  " << user << "\n";
+        }
+    }
+
+    // Pages through the sorted users at positions [first, last). Each page is
+    // fetched by position, so nothing outside it is copied.
+    void browseUsers(const std::string& title, std::size_t first, std::size_t last, bool allowJump) {
+        const std::size_t pageSize = 20;
+        std::size_t start = first;
+        while (true) {
+            auto page = core.getUsersPage(start, std::min(pageSize, last - start));
+            std::cout << "\n" << title << "\n";
+            for (std::size_t i = 0; i < page.size(); ++i) {
+                std::cout << (start + i + 1) << ") " << page[i] << "\n";
+            }
+            if (page.empty()) {
+                std::cout << "No users.\n";
+            } else {
+                std::cout << "\nShowing " << (start - first + 1) << "-" << (start - first + page.size())
+                          << " of " << (last - first) << "\n";
+            }
+            
+            std::cout << "n) Next  p) Previous";
+            if (allowJump) std::cout << "  /text) Jump to prefix";
+            std::cout << "  0) Back: ";
+            std::string input;
+            if (!std::getline(std::cin, input) || input == "0") return;
+            if (input.empty() || input == "n") {
+                if (start + pageSize < last) start += pageSize;
+            } else if (input == "p") {
+                start = start - first >= pageSize ? start - pageSize : first;
+            } else if (allowJump && input[0] == '/') {
+                start = std::min(core.userPrefixRange(input.substr(1)).first, last > first ? last - 1 : first);
+            }
+        }
+    }
+
+public:
+    // Bulk indexing mode: rebuilds the resource index snapshot and exits
+    void reindex(std::size_t threads = 0) {
+        prepareDirectories();
+        std::cout << "Rebuilding resource index from " << resourcesDir() << "...\n";
+        printIndexStats(core.reindexResources(threads));
+    }
+    
+    // Bulk import mode: registers the students of a CSV file and exits
+    void importStudents(const std::string& csvPath, std::size_t threads = 0) {
+        prepareDirectories();
+        core.openUsers();
+        std::cout << "Importing students from " << csvPath << "...\n";
+        auto stats = core.importUsers(csvPath, threads);
+        const std::size_t shownErrors = 20;
+        for (std::size_t i = 0; i < stats.errors.size() && i < shownErrors; ++i) {
+            std::cout << "  " << stats.errors[i] << "\n";
+        }
+        if (stats.errors.size() > shownErrors) {
+            std::cout << "  ... and " << (stats.errors.size() - shownErrors) << " more\n";
+        }
+        std::cout << "Imported " << stats.imported << " of " << stats.rows << " students on "
+                  << stats.threads << " threads\n";
+        std::cout << std::fixed << std::setprecision(2)
+                  << "Parse " << stats.parseSeconds << "s, hash and commit " << stats.registerSeconds << "s ("
+                  << std::setprecision(0) << stats.usersPerSecond() << " students/s)\n";
+        std::cout.unsetf(std::ios::floatfield);
+        std::cout << std::setprecision(6);
+    }
+    
+    void run() {
+        prepareDirectories();
+        core.openUsers();
+        // Watch the tree before the index is loaded, so files added in
+        // between are not missed
+        resourceCatalog();
+        BulkIndexStats rebuilt;
+        if (!core.openResourceIndex(&rebuilt) && rebuilt.files > 0) {
+            std::cout << "Resource tree changed since the last run.\n";
+            printIndexStats(rebuilt);
+            pause();
+        }
         
         while (true) {
             clearScreen();
@@ -542,6 +818,7 @@ public:
                 std::cout << "3) Search All Resources\n";
                 std::cout << "4) Popular Resources\n";
                 std::cout << "5) User Directory\n";
+                std::cout << "6) Recent Uploads\n";
                 std::cout << "0) Logout\n";
                 std::cout << "Choose: ";
                 
@@ -572,6 +849,9 @@ public:
                     case 5:
                         showUserDirectory();
                         break;
+                    case 6:
+                        showRecentResources();
+                        break;
                 }
             } else {
                 std::cout << "1) Login\n";
@@ -593,6 +873,9 @@ public:
             }
         }
         
+        if (!core.saveState()) {
+            std::cout << "Warning: could not save the user and resource snapshots.\n";
+        }
         std::cout << "\nGoodbye!\n";
     }
     
@@ -615,11 +898,8 @@ public:
         std::cin.ignore(1, '\n');
         
         if (choice == 1) {
-            auto users = core.getSortedUsers();
-            std::cout << "\nAll Users (Sorted by Email):\n";
-            for (const auto& email : users) {
-                std::cout << "- " << email << "\n";
-            }
+            browseUsers("All Users (Sorted by Email)", 0, core.countUsers(), true);
+            return;
         } else if (choice == 2) {
             auto users = core.getRecentUsers();
             std::cout << "\nRecent Users:\n";
@@ -630,10 +910,12 @@ public:
             std::cout << "Enter email prefix: ";
             std::string prefix;
             std::getline(std::cin, prefix);
-            auto users = core.searchUsersByPrefix(prefix);
-            std::cout << "\nMatching Users:\n";
-            for (const auto& email : users) {
-                std::cout << "- " << email << "\n";
+            auto range = core.userPrefixRange(prefix);
+            if (range.first == range.second) {
+                std::cout << "\nNo users match \"" << prefix << "\".\n";
+            } else {
+                browseUsers("Users Matching \"" + prefix + "\"", range.first, range.second, false);
+                return;
             }
         }
         
@@ -641,6 +923,7 @@ public:
             pause();
         }
     }
+
 };
 
 }
\ No newline at end of file
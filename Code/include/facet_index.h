@@ -0,0 +1,128 @@
+#pragma once
+#include "roaring_bitmap.h"
+#include <array>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+
+namespace uni {
+
+// ============================================================================
+// Facet Index (bitmap per academic dimension value)
+// ============================================================================
+
+// Dimensions of the storage layout <year>/<sem>/<branch>/<section>/<subject>/<type>/<name>
+enum class Facet : std::size_t { Year, Semester, Branch, Section, Subject, Type };
+inline constexpr std::size_t kFacetCount = 6;
+inline constexpr const char* kFacetNames[kFacetCount] = {"year", "semester", "branch", "section", "subject", "type"};
+
+using FacetValues = std::array<std::string, kFacetCount>;
+
+// Facets of a stored file, read off the six directories above it. Uploads and
+// bulk-indexed files share that layout, so no root needs to be known; paths
+// that are too short have no facets.
+inline FacetValues facetsFromPath(const std::string& path) {
+    FacetValues values;
+    std::size_t end = path.find_last_of('/');
+    for (std::size_t f = kFacetCount; f-- > 0;) {
+        if (end == std::string::npos || end == 0) return FacetValues{};
+        std::size_t start = path.find_last_of('/', end - 1);
+        std::size_t begin = start == std::string::npos ? 0 : start + 1;
+        values[f] = path.substr(begin, end - begin);
+        end = start;
+    }
+    return values;
+}
+
+// Accepted values per facet: values of one facet are ORed, facets are ANDed,
+// and a facet without values is unconstrained
+struct FacetFilter {
+    std::array<std::vector<std::string>, kFacetCount> allowed;
+
+    FacetFilter& where(Facet facet, std::string value) {
+        allowed[static_cast<std::size_t>(facet)].push_back(std::move(value));
+        return *this;
+    }
+
+    bool empty() const {
+        return std::all_of(allowed.begin(), allowed.end(), [](const auto& values) { return values.empty(); });
+    }
+};
+
+struct FacetCount {
+    std::string value;
+    std::size_t count;
+};
+
+// Per facet, the values present in a result set with their counts (largest first)
+using FacetCounts = std::array<std::vector<FacetCount>, kFacetCount>;
+
+class FacetIndex {
+private:
+    std::array<std::unordered_map<std::string, RoaringBitmap>, kFacetCount> bitmaps;
+    RoaringBitmap all;
+
+public:
+    void add(DocId id, const FacetValues& values) {
+        all.add(id);
+        for (std::size_t f = 0; f < kFacetCount; ++f) {
+            if (!values[f].empty()) bitmaps[f][values[f]].add(id);
+        }
+    }
+
+    void remove(DocId id, const FacetValues& values) {
+        all.remove(id);
+        for (std::size_t f = 0; f < kFacetCount; ++f) {
+            auto it = bitmaps[f].find(values[f]);
+            if (it == bitmaps[f].end()) continue;
+            it->second.remove(id);
+            if (it->second.empty()) bitmaps[f].erase(it);
+        }
+    }
+
+    // Ids matching the filter: an OR within each constrained facet, then an
+    // AND across facets, smallest operand first
+    RoaringBitmap select(const FacetFilter& filter) const {
+        std::vector<RoaringBitmap> operands;
+        for (std::size_t f = 0; f < kFacetCount; ++f) {
+            if (filter.allowed[f].empty()) continue;
+            RoaringBitmap either;
+            for (const auto& value : filter.allowed[f]) {
+                auto it = bitmaps[f].find(value);
+                if (it != bitmaps[f].end()) either = RoaringBitmap::unite(either, it->second);
+            }
+            operands.push_back(std::move(either));
+        }
+        if (operands.empty()) return all;
+
+        std::sort(operands.begin(), operands.end(), [](const RoaringBitmap& a, const RoaringBitmap& b) {
+            return a.cardinality() < b.cardinality();
+        });
+        RoaringBitmap result = std::move(operands.front());
+        for (std::size_t i = 1; i < operands.size() && !result.empty(); ++i) {
+            result = RoaringBitmap::intersect(result, operands[i]);
+        }
+        return result;
+    }
+
+    // Breakdown of matches by every facet value, counted with AND cardinalities
+    FacetCounts count(const RoaringBitmap& matches) const {
+        FacetCounts counts;
+        if (matches.empty()) return counts;
+        for (std::size_t f = 0; f < kFacetCount; ++f) {
+            for (const auto& [value, bitmap] : bitmaps[f]) {
+                std::size_t n = RoaringBitmap::andCardinality(matches, bitmap);
+                if (n > 0) counts[f].push_back(FacetCount{value, n});
+            }
+            std::sort(counts[f].begin(), counts[f].end(), [](const FacetCount& a, const FacetCount& b) {
+                return a.count != b.count ? a.count > b.count : a.value < b.value;
+            });
+        }
+        return counts;
+    }
+
+    const RoaringBitmap& everything() const { return all; }
+};
+
+}
@@ -0,0 +1,197 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <array>
+#include <unordered_map>
+#include <optional>
+#include <algorithm>
+#include <cstdint>
+
+namespace uni {
+
+// ============================================================================
+// Typo-Tolerant Term Lookup (trigram candidates + bounded edit distance)
+// ============================================================================
+
+// Edits tolerated for a query of the given length: none for very short words,
+// where a single edit already reaches unrelated terms
+inline std::size_t typoBudget(std::size_t length) {
+    if (length < 3) return 0;
+    if (length < 6) return 1;
+    return 2;
+}
+
+// Levenshtein distance from one pattern to many texts with Myers' bit-parallel
+// algorithm: one pass of a few word operations per text character for patterns
+// up to 64 bytes (longer patterns use the row-by-row DP)
+class EditDistanceMatcher {
+private:
+    std::string pattern;
+    std::array<std::uint64_t, 256> peq{};   // Bit i set where pattern[i] == c
+    std::uint64_t last = 0;                 // Bit of the pattern's last character
+
+    std::size_t dynamicDistance(const std::string& text, std::size_t maxDistance) const {
+        std::vector<std::size_t> row(pattern.size() + 1);
+        for (std::size_t i = 0; i <= pattern.size(); ++i) row[i] = i;
+        for (std::size_t j = 0; j < text.size(); ++j) {
+            std::size_t diagonal = row[0];
+            row[0] = j + 1;
+            std::size_t best = row[0];
+            for (std::size_t i = 1; i <= pattern.size(); ++i) {
+                std::size_t up = row[i];
+                row[i] = std::min({row[i] + 1, row[i - 1] + 1, diagonal + (pattern[i - 1] != text[j])});
+                diagonal = up;
+                best = std::min(best, row[i]);
+            }
+            if (best > maxDistance) return maxDistance + 1;
+        }
+        return std::min(row.back(), maxDistance + 1);
+    }
+
+public:
+    explicit EditDistanceMatcher(const std::string& p) : pattern(p) {
+        if (pattern.empty() || pattern.size() > 64) return;
+        for (std::size_t i = 0; i < pattern.size(); ++i) {
+            peq[static_cast<unsigned char>(pattern[i])] |= std::uint64_t(1) << i;
+        }
+        last = std::uint64_t(1) << (pattern.size() - 1);
+    }
+
+    // Distance to text, or maxDistance + 1 once it is certain to exceed maxDistance
+    std::size_t distance(const std::string& text, std::size_t maxDistance) const {
+        std::size_t m = pattern.size();
+        std::size_t gap = m > text.size() ? m - text.size() : text.size() - m;
+        if (gap > maxDistance) return maxDistance + 1;
+        if (m == 0) return text.size();
+        if (m > 64) return dynamicDistance(text, maxDistance);
+
+        // Vertical delta vectors of the current DP column (+1 / -1 bits)
+        std::uint64_t pv = ~std::uint64_t(0);
+        std::uint64_t mv = 0;
+        std::size_t score = m;
+        for (std::size_t j = 0; j < text.size(); ++j) {
+            std::uint64_t eq = peq[static_cast<unsigned char>(text[j])];
+            std::uint64_t xv = eq | mv;
+            std::uint64_t xh = (((eq & pv) + pv) ^ pv) | eq;
+            std::uint64_t ph = mv | ~(xh | pv);
+            std::uint64_t mh = pv & xh;
+            if (ph & last) ++score;
+            else if (mh & last) --score;
+            // Row 0 grows by one per text character (global, not substring, distance)
+            ph = (ph << 1) | 1;
+            mh <<= 1;
+            pv = mh | ~(xv | ph);
+            mv = ph & xv;
+
+            // The score drops by at most one per remaining character
+            std::size_t remaining = text.size() - j - 1;
+            if (score > maxDistance + remaining) return maxDistance + 1;
+        }
+        return std::min(score, maxDistance + 1);
+    }
+};
+
+// Vocabulary of index terms with a padded-trigram index. A lookup counts the
+// trigrams each term shares with the query; an edit changes at most three of
+// them, so only terms sharing enough trigrams are verified with the matcher.
+// Two pad characters per side leave a word of n letters n + 2 trigrams, which
+// keeps that threshold above zero for every typoBudget().
+class FuzzyVocabulary {
+public:
+    struct Match {
+        std::string term;
+        std::size_t distance;
+    };
+
+private:
+    std::vector<std::string> terms;
+    std::unordered_map<std::string, std::uint32_t> idByTerm;
+    std::unordered_map<std::uint32_t, std::vector<std::uint32_t>> termsByTrigram;
+
+    // Per-lookup trigram counts, indexed by term id (reset after every lookup)
+    mutable std::vector<std::uint16_t> sharedCounts;
+
+    static std::vector<std::uint32_t> trigrams(const std::string& term) {
+        std::string padded = "$$" + term + "$$";
+        std::vector<std::uint32_t> grams;
+        for (std::size_t i = 0; i + 3 <= padded.size(); ++i) {
+            grams.push_back(static_cast<std::uint32_t>(static_cast<unsigned char>(padded[i])) << 16 |
+                            static_cast<std::uint32_t>(static_cast<unsigned char>(padded[i + 1])) << 8 |
+                            static_cast<std::uint32_t>(static_cast<unsigned char>(padded[i + 2])));
+        }
+        std::sort(grams.begin(), grams.end());
+        grams.erase(std::unique(grams.begin(), grams.end()), grams.end());
+        return grams;
+    }
+
+public:
+    // Returns false if the term was already known
+    bool add(const std::string& term) {
+        if (term.empty() || idByTerm.count(term)) return false;
+
+        auto id = static_cast<std::uint32_t>(terms.size());
+        terms.push_back(term);
+        idByTerm.emplace(term, id);
+        for (auto gram : trigrams(term)) {
+            termsByTrigram[gram].push_back(id);
+        }
+        return true;
+    }
+
+    bool contains(const std::string& term) const { return idByTerm.count(term) > 0; }
+
+    // Known terms within maxDistance edits of term, closest first (ties alphabetical)
+    std::vector<Match> nearest(const std::string& term, std::size_t maxDistance) const {
+        std::vector<Match> matches;
+        if (term.empty()) return matches;
+
+        auto grams = trigrams(term);
+        std::size_t needed = grams.size() > 3 * maxDistance ? grams.size() - 3 * maxDistance : 1;
+
+        sharedCounts.resize(terms.size());
+        std::vector<std::uint32_t> touched;
+        for (auto gram : grams) {
+            auto it = termsByTrigram.find(gram);
+            if (it == termsByTrigram.end()) continue;
+            for (auto id : it->second) {
+                if (sharedCounts[id]++ == 0) touched.push_back(id);
+            }
+        }
+
+        EditDistanceMatcher matcher(term);
+        for (auto id : touched) {
+            if (sharedCounts[id] >= needed) {
+                std::size_t distance = matcher.distance(terms[id], maxDistance);
+                if (distance <= maxDistance) matches.push_back(Match{terms[id], distance});
+            }
+            sharedCounts[id] = 0;
+        }
+
+        std::sort(matches.begin(), matches.end(), [](const Match& a, const Match& b) {
+            return a.distance != b.distance ? a.distance < b.distance : a.term < b.term;
+        });
+        return matches;
+    }
+
+    // Splits a run-together word into two known terms ("datastructure" ->
+    // "data", "structure"), preferring the most even split
+    std::optional<std::pair<std::string, std::string>> splitCompound(const std::string& term) const {
+        std::optional<std::pair<std::string, std::string>> best;
+        std::size_t bestShorter = 0;
+        for (std::size_t cut = 2; cut + 2 <= term.size(); ++cut) {
+            std::size_t shorter = std::min(cut, term.size() - cut);
+            if (shorter <= bestShorter) continue;
+            std::string left = term.substr(0, cut);
+            std::string right = term.substr(cut);
+            if (contains(left) && contains(right)) {
+                best.emplace(std::move(left), std::move(right));
+                bestShorter = shorter;
+            }
+        }
+        return best;
+    }
+
+    std::size_t size() const { return terms.size(); }
+};
+
+}
@@ -0,0 +1,268 @@
+#pragma once
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <utility>
+#include <memory>
+
+namespace uni {
+
+using DocId = std::uint32_t;
+
+// ============================================================================
+// Compressed Posting List (delta + varint, block skip pointers)
+// ============================================================================
+// Ids are stored as varint-encoded gaps in blocks of kBlockSize postings, each
+// followed by a varint payload (e.g. packed term frequencies). Each block has
+// a skip entry (last id, byte offset), so a cursor can jump over whole blocks
+// without decoding them; only the block being read is decoded.
+//
+// A list can also be a read-only view over bytes owned by someone else (a
+// mapped index snapshot); it is copied into owned storage on first modification.
+class CompressedPostingList {
+public:
+    static constexpr std::size_t kBlockSize = 128;
+
+    struct Skip {
+        DocId lastId;          // Largest id in the block
+        std::uint32_t offset;  // Byte offset of the block's first gap
+    };
+
+private:
+    std::vector<std::uint8_t> bytes;
+    std::vector<Skip> skips;
+    std::uint32_t count = 0;
+
+    // Borrowed storage, used instead of bytes/skips while viewSkips is set
+    const std::uint8_t* viewBytes = nullptr;
+    std::size_t viewByteCount = 0;
+    const Skip* viewSkips = nullptr;
+    std::size_t viewSkipCount = 0;
+    std::shared_ptr<const void> viewOwner;
+
+    void detach() {
+        if (!viewSkips) return;
+        bytes.assign(viewBytes, viewBytes + viewByteCount);
+        skips.assign(viewSkips, viewSkips + viewSkipCount);
+        viewBytes = nullptr;
+        viewSkips = nullptr;
+        viewByteCount = viewSkipCount = 0;
+        viewOwner.reset();
+    }
+
+    static void putVarint(std::vector<std::uint8_t>& out, std::uint32_t value) {
+        while (value >= 0x80) {
+            out.push_back(static_cast<std::uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        out.push_back(static_cast<std::uint8_t>(value));
+    }
+
+    static std::uint32_t getVarint(const std::uint8_t*& p) {
+        std::uint32_t value = 0;
+        int shift = 0;
+        while (*p & 0x80) {
+            value |= static_cast<std::uint32_t>(*p++ & 0x7F) << shift;
+            shift += 7;
+        }
+        value |= static_cast<std::uint32_t>(*p++) << shift;
+        return value;
+    }
+
+    // getVarint with bounds: false if the varint runs past size or 32 bits
+    static bool readVarint(const std::uint8_t* data, std::size_t size, std::size_t& offset, std::uint32_t& value) {
+        value = 0;
+        for (int shift = 0; shift < 35; shift += 7) {
+            if (offset >= size) return false;
+            std::uint8_t byte = data[offset++];
+            if (shift == 28 && byte > 0x0F) return false;
+            value |= static_cast<std::uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) return true;
+        }
+        return false;
+    }
+
+    void append(DocId id, std::uint32_t payload) {
+        detach();
+        if (count % kBlockSize == 0) {
+            // A new block restarts gaps from the previous block's last id
+            DocId base = skips.empty() ? 0 : skips.back().lastId;
+            skips.push_back(Skip{id, static_cast<std::uint32_t>(bytes.size())});
+            putVarint(bytes, id - base);
+        } else {
+            putVarint(bytes, id - skips.back().lastId);
+            skips.back().lastId = id;
+        }
+        putVarint(bytes, payload);
+        ++count;
+    }
+
+public:
+    // Forward iterator that decodes lazily and skips blocks on advance()
+    class Cursor {
+    private:
+        const CompressedPostingList* list;
+        std::size_t block = 0;
+        std::size_t index = 0;          // Position within the current block
+        const std::uint8_t* pos = nullptr;
+        DocId current = 0;
+        std::uint32_t currentPayload = 0;
+        bool end = false;
+
+        std::size_t blockLength(std::size_t b) const {
+            return std::min(kBlockSize, list->count - b * kBlockSize);
+        }
+
+        void loadBlock(std::size_t b) {
+            const Skip* skips = list->skipData();
+            block = b;
+            index = 0;
+            pos = list->byteData() + skips[b].offset;
+            DocId base = b == 0 ? 0 : skips[b - 1].lastId;
+            current = base + getVarint(pos);
+            currentPayload = getVarint(pos);
+        }
+
+    public:
+        explicit Cursor(const CompressedPostingList* l) : list(l) {
+            if (list->count == 0) end = true;
+            else loadBlock(0);
+        }
+
+        bool atEnd() const { return end; }
+        DocId docId() const { return current; }
+        std::uint32_t payload() const { return currentPayload; }
+
+        void next() {
+            if (end) return;
+            if (++index < blockLength(block)) {
+                current += getVarint(pos);
+                currentPayload = getVarint(pos);
+            } else if (block + 1 < list->skipCount()) {
+                loadBlock(block + 1);
+            } else {
+                end = true;
+            }
+        }
+
+        // Moves to the first id >= target
+        void advance(DocId target) {
+            if (end || current >= target) return;
+
+            const Skip* skips = list->skipData();
+            const std::size_t skipCount = list->skipCount();
+            if (skips[block].lastId < target) {
+                // Gallop over skip entries, then binary search the bracketed range
+                std::size_t lo = block + 1;
+                std::size_t step = 1;
+                std::size_t hi = lo;
+                while (hi < skipCount && skips[hi].lastId < target) {
+                    lo = hi + 1;
+                    hi += step;
+                    step <<= 1;
+                }
+                hi = std::min(hi + 1, skipCount);
+                const Skip* it = std::lower_bound(skips + lo, skips + hi, target,
+                                                  [](const Skip& s, DocId t) { return s.lastId < t; });
+                if (it == skips + hi) {
+                    end = true;
+                    return;
+                }
+                loadBlock(it - skips);
+            }
+
+            while (current < target) next();
+        }
+    };
+
+    // Adds id (or replaces its payload); in-order ids are appended, anything
+    // else re-encodes the list
+    void insert(DocId id, std::uint32_t payload = 0) {
+        if (count == 0 || id > skipData()[skipCount() - 1].lastId) {
+            append(id, payload);
+            return;
+        }
+
+        std::vector<std::pair<DocId, std::uint32_t>> entries;
+        entries.reserve(count + 1);
+        for (Cursor c = cursor(); !c.atEnd(); c.next()) {
+            entries.emplace_back(c.docId(), c.payload());
+        }
+        auto pos = std::lower_bound(entries.begin(), entries.end(), std::make_pair(id, std::uint32_t(0)));
+        if (pos != entries.end() && pos->first == id) pos->second = payload;
+        else entries.insert(pos, {id, payload});
+
+        clear();
+        for (const auto& [value, data] : entries) append(value, data);
+    }
+
+    std::vector<DocId> decode() const {
+        std::vector<DocId> ids;
+        ids.reserve(count);
+        for (Cursor c = cursor(); !c.atEnd(); c.next()) {
+            ids.push_back(c.docId());
+        }
+        return ids;
+    }
+
+    void clear() {
+        detach();
+        bytes.clear();
+        skips.clear();
+        count = 0;
+    }
+
+    // Wraps encoded data without copying it; owner keeps the storage alive
+    static CompressedPostingList view(const std::uint8_t* data, std::size_t byteCount,
+                                      const Skip* skipEntries, std::size_t skipEntryCount,
+                                      std::uint32_t postingCount, std::shared_ptr<const void> owner) {
+        CompressedPostingList list;
+        list.viewBytes = data;
+        list.viewByteCount = byteCount;
+        list.viewSkips = skipEntries;
+        list.viewSkipCount = skipEntryCount;
+        list.viewOwner = std::move(owner);
+        list.count = postingCount;
+        return list;
+    }
+
+    // Whether the encoding decodes, within its bytes, into count increasing
+    // ids below idLimit that agree with the skip entries. Cursors trust the
+    // encoding, so lists viewed from disk are checked once before use.
+    bool valid(std::uint64_t idLimit) const {
+        const std::uint8_t* data = byteData();
+        const std::size_t size = byteSize();
+        const Skip* skipEntries = skipData();
+        if (skipCount() != (count + kBlockSize - 1) / kBlockSize) return false;
+        std::size_t offset = 0;
+        std::uint64_t last = 0;
+        for (std::size_t b = 0; b < skipCount(); ++b) {
+            if (skipEntries[b].offset != offset) return false;
+            std::size_t length = std::min(kBlockSize, count - b * kBlockSize);
+            for (std::size_t i = 0; i < length; ++i) {
+                std::uint32_t gap;
+                std::uint32_t payload;
+                if (!readVarint(data, size, offset, gap) || !readVarint(data, size, offset, payload)) return false;
+                bool first = b == 0 && i == 0;
+                if (!first && gap == 0) return false;
+                last += gap;
+                if (last >= idLimit) return false;
+            }
+            if (skipEntries[b].lastId != last) return false;
+        }
+        return offset == size;
+    }
+
+    const std::uint8_t* byteData() const { return viewSkips ? viewBytes : bytes.data(); }
+    std::size_t byteSize() const { return viewSkips ? viewByteCount : bytes.size(); }
+    const Skip* skipData() const { return viewSkips ? viewSkips : skips.data(); }
+    std::size_t skipCount() const { return viewSkips ? viewSkipCount : skips.size(); }
+
+    Cursor cursor() const { return Cursor(this); }
+    std::size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    std::size_t memoryBytes() const { return bytes.capacity() + skips.capacity() * sizeof(Skip); }
+};
+
+}
@@ -0,0 +1,170 @@
+#pragma once
+#include "posting_list.h"
+#include "tokenizer.h"
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <sstream>
+
+namespace uni {
+
+// ============================================================================
+// Boolean Query Engine over Compressed Posting Lists
+// ============================================================================
+
+// ----------------------------------------------------------------------------
+// Posting list kernels (inputs sorted ascending, no duplicates)
+// ----------------------------------------------------------------------------
+
+// Adds id to a sorted posting list (an append whenever ids arrive in order)
+inline void insertPosting(std::vector<DocId>& postings, DocId id) {
+    if (postings.empty() || postings.back() < id) {
+        postings.push_back(id);
+        return;
+    }
+    auto pos = std::lower_bound(postings.begin(), postings.end(), id);
+    if (*pos != id) postings.insert(pos, id);
+}
+
+inline std::vector<DocId> unionPostings(const std::vector<DocId>& a, const std::vector<DocId>& b) {
+    std::vector<DocId> result;
+    result.reserve(a.size() + b.size());
+    std::set_union(a.begin(), a.end(), b.begin(), b.end(), std::back_inserter(result));
+    return result;
+}
+
+// ----------------------------------------------------------------------------
+// Query parsing and evaluation
+// ----------------------------------------------------------------------------
+
+// Disjunction of conjunctive clauses: "a b OR c -d" is (a AND b) OR (c AND NOT d)
+struct BooleanQuery {
+    struct Clause {
+        std::vector<std::string> required;
+        std::vector<std::string> excluded;
+    };
+    std::vector<Clause> clauses;
+};
+
+// Operators are uppercase AND / OR / NOT; "|" is OR and a leading "-" negates a term
+inline BooleanQuery parseBooleanQuery(const std::string& text) {
+    BooleanQuery query;
+    query.clauses.emplace_back();
+
+    std::istringstream iss(text);
+    std::string word;
+    bool negateNext = false;
+    Tokenizer tokenizer;
+
+    while (iss >> word) {
+        if (word == "OR" || word == "|") {
+            if (!query.clauses.back().required.empty() || !query.clauses.back().excluded.empty()) {
+                query.clauses.emplace_back();
+            }
+            negateNext = false;
+            continue;
+        }
+        if (word == "AND") continue;
+        if (word == "NOT") {
+            negateNext = true;
+            continue;
+        }
+
+        bool negated = negateNext;
+        negateNext = false;
+        if (word.size() > 1 && word[0] == '-') {
+            negated = true;
+            word.erase(0, 1);
+        }
+
+        // Same tokenizer as indexing: "data-structures" requires both terms
+        auto& clause = query.clauses.back();
+        for (auto term : tokenizer.tokenize(word)) {
+            (negated ? clause.excluded : clause.required).emplace_back(term);
+        }
+    }
+
+    return query;
+}
+
+// Intersects the cursors (rarest first) and drops ids found in any excluded cursor.
+// Candidates leapfrog between lists, so long lists are skipped block by block.
+inline std::vector<DocId> intersectCursors(std::vector<CompressedPostingList::Cursor>& lists,
+                                           std::vector<CompressedPostingList::Cursor>& excluded) {
+    std::vector<DocId> result;
+    if (lists.empty()) return result;
+
+    auto& lead = lists.front();
+    while (!lead.atEnd()) {
+        DocId candidate = lead.docId();
+        bool matched = true;
+
+        for (std::size_t i = 1; i < lists.size(); ++i) {
+            lists[i].advance(candidate);
+            if (lists[i].atEnd()) return result;
+            if (lists[i].docId() != candidate) {
+                lead.advance(lists[i].docId());
+                matched = false;
+                break;
+            }
+        }
+        if (!matched) continue;
+
+        for (auto& ex : excluded) {
+            ex.advance(candidate);
+            if (!ex.atEnd() && ex.docId() == candidate) {
+                matched = false;
+                break;
+            }
+        }
+        if (matched) result.push_back(candidate);
+        lead.next();
+    }
+
+    return result;
+}
+
+// Evaluates a query; lookup(term) returns the term's postings or nullptr.
+// Clauses without any required term are ignored (pure negation is not supported).
+template<typename Lookup>
+std::vector<DocId> evaluateBooleanQuery(const BooleanQuery& query, Lookup lookup) {
+    std::vector<DocId> result;
+
+    for (const auto& clause : query.clauses) {
+        if (clause.required.empty()) continue;
+
+        std::vector<const CompressedPostingList*> lists;
+        bool missing = false;
+        for (const auto& term : clause.required) {
+            const CompressedPostingList* postings = lookup(term);
+            if (!postings || postings->empty()) {
+                missing = true;
+                break;
+            }
+            lists.push_back(postings);
+        }
+        if (missing) continue;
+
+        // Rarest term leads so every other list is only probed at its candidates
+        std::sort(lists.begin(), lists.end(),
+                  [](const auto* x, const auto* y) { return x->size() < y->size(); });
+
+        std::vector<CompressedPostingList::Cursor> cursors;
+        for (const auto* list : lists) cursors.push_back(list->cursor());
+
+        std::vector<CompressedPostingList::Cursor> excluded;
+        for (const auto& term : clause.excluded) {
+            if (const CompressedPostingList* postings = lookup(term)) {
+                excluded.push_back(postings->cursor());
+            }
+        }
+
+        auto matches = intersectCursors(cursors, excluded);
+        result = result.empty() ? std::move(matches) : unionPostings(result, matches);
+    }
+
+    return result;
+}
+
+}
@@ -0,0 +1,91 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <unordered_set>
+#include <optional>
+#include <chrono>
+#include <cstdint>
+
+namespace uni {
+
+// ============================================================================
+// Resource Catalog (in-memory listing of the resource tree)
+// ============================================================================
+// Holds every folder of the resource tree with its file names, so listings
+// are answered from memory instead of a directory read and a stat per file.
+// One inotify watch per folder keeps it current: events for files written,
+// renamed or deleted (by the application or from outside) update the folder
+// they happened in, and new folders are watched and read as they appear.
+// Sizes and mtimes are read the first time a file is listed after a change.
+//
+// Paths whose state changed are also queued for takeChanges(), so the
+// resource index can pick up files dropped into the tree without a rescan.
+// If inotify is unavailable or runs out of watches, watching() is false and
+// callers read the tree directly; an event queue overflow rereads the tree.
+
+struct CatalogFile {
+    std::string path;
+    std::string name;
+    std::uint64_t sizeBytes = 0;   // Logical size (a manifest's file size)
+    std::chrono::system_clock::time_point modified;
+};
+
+class ResourceCatalog {
+private:
+    struct Entry {
+        std::uint64_t sizeBytes = 0;
+        std::chrono::system_clock::time_point modified;
+        bool described = false;    // Size and mtime are current
+    };
+
+    struct Folder {
+        int watch = -1;
+        std::map<std::string, Entry> files;
+    };
+
+    std::string root;
+    int inotifyFd = -1;
+    std::unordered_map<std::string, Folder> folders;
+    std::unordered_map<int, std::string> watchedFolders;
+    std::unordered_set<std::string> changes;
+
+    bool addTree(const std::string& dir, bool reportFiles);
+    void dropTree(const std::string& dir);
+    // Returns false once the watches started over; the rest of the events read
+    // belong to the closed instance
+    bool handleEvent(int watch, std::uint32_t mask, const std::string& name);
+    void rescan();
+    void stopWatching();
+
+public:
+    explicit ResourceCatalog(std::string rootDir) : root(std::move(rootDir)) {}
+    ~ResourceCatalog();
+
+    ResourceCatalog(const ResourceCatalog&) = delete;
+    ResourceCatalog& operator=(const ResourceCatalog&) = delete;
+
+    // Reads the tree and watches every folder; false if inotify is unavailable
+    bool open();
+
+    bool watching() const { return inotifyFd >= 0; }
+
+    // Applies pending inotify events without blocking
+    void refresh();
+
+    // Files of a folder by name, or nullopt if the catalog cannot answer
+    // (not watching, or a folder outside the tree or not seen yet)
+    std::optional<std::vector<CatalogFile>> list(const std::string& folder);
+
+    // ensureDir() that skips the filesystem for folders known to exist
+    bool ensureFolder(const std::string& folder);
+
+    // Paths added, changed or removed since the last call
+    std::vector<std::string> takeChanges();
+};
+
+// The catalog of resourcesDir(), opened on first use
+ResourceCatalog& resourceCatalog();
+
+}
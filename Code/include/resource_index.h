@@ -1,16 +1,28 @@
 #pragma once
 #include "resources.h"
 #include "data_structures.h"
+#include "query_engine.h"
+#include "bm25.h"
+#include "resource_store.h"
+#include "fuzzy_vocabulary.h"
+#include "content_extractor.h"
+#include "facet_index.h"
+#include "similarity_index.h"
+#include "resource_log.h"
+#include "bplus_tree.h"
 #include <string>
 #include <vector>
 #include <unordered_map>
-#include <queue>
+#include <unordered_set>
 #include <memory>
 #include <chrono>
 #include <algorithm>
 #include <cctype>
 #include <sstream>
 #include <optional>
+#include <filesystem>
+#include <deque>
+#include <future>
 
 namespace uni {
 
@@ -18,198 +30,659 @@ namespace uni {
 // Enhanced Resource Management with Simple Data Structures
 // ============================================================================
 
-struct ResourceMetadata {
-    std::string filename;
-    std::string displayName;
-    std::string filePath;
-    std::string resourceType;
-    std::string subject;
-    std::string uploader;
-    std::size_t sizeBytes;
-    std::chrono::system_clock::time_point uploadTime;
-    int downloadCount;
-    double rating;
-    std::vector<std::string> tags;
-    
-    ResourceMetadata() : sizeBytes(0), uploadTime(std::chrono::system_clock::now()),
-                        downloadCount(0), rating(0.0) {}
+// Directory modification times of the resource tree when a snapshot was taken.
+// Adding or removing a file changes its directory's mtime, so checking the
+// recorded directories detects tree changes without listing any files.
+struct TreeFingerprint {
+    std::vector<std::pair<std::string, std::int64_t>> directories;
     
-    bool operator<(const ResourceMetadata& other) const {
-        // For priority queue (higher priority = more popular)
-        return downloadCount < other.downloadCount;
-    }
+    static TreeFingerprint scan(const std::string& root);
+    bool stillMatches() const;
+};
+
+// Metadata for a file stored at <root>/<year>/<sem>/<branch>/<section>/<subject>/<type>/<name>
+std::optional<ResourceMetadata> describeStoredResource(const std::string& root, const std::filesystem::path& file);
+
+// A resource's index terms with their per-field frequencies, its field lengths
+// and the MinHash signature of its term set
+struct AnalyzedDocument {
+    std::vector<std::pair<std::string, FieldFrequencies>> terms;
+    FieldLengths lengths{};
+    MinHashSignature signature = MinHasher().result();
+};
+
+// A resource linked to another in the resource graph, with the edge weight
+// (estimated term-set similarity, or 1 for explicit relationships)
+struct RelatedResource {
+    std::string filename;
+    double weight;
+};
+
+// Outcome of a bulk (re)build of the index from the resource tree
+struct BulkIndexStats {
+    std::size_t files = 0;
+    std::size_t directories = 0;
+    std::size_t threads = 0;
+    double scanSeconds = 0.0;       // Parallel walk, stat and tokenization
+    double mergeSeconds = 0.0;      // Folding per-thread partials into the index
     
-    // For BST comparison (sort by filename)
-    bool operator<(const std::string& filename) const {
-        return this->filename < filename;
-    }
+    double seconds() const { return scanSeconds + mergeSeconds; }
+    double filesPerSecond() const { return seconds() > 0 ? files / seconds() : 0.0; }
 };
 
+// Columns with an ordered (B+tree) index
+enum class RangeColumn { UploadTime, Size, Rating };
+constexpr RangeColumn kRangeColumns[] = {RangeColumn::UploadTime, RangeColumn::Size, RangeColumn::Rating};
+
 class ResourceIndex {
 private:
-    // BST: Efficient file metadata storage and search (instead of B-Tree)
-    BST<ResourceMetadata> resourceBST;
+    // Columnar Store: single owner of all metadata, hands out dense ids
+    ResourceStore store;
+    
+    // BST: Resource ids ordered by filename (AVL-balanced, since bulk indexing
+    // and snapshot loads insert ids in filename order)
+    struct FilenameOrder {
+        const ResourceStore* store;
+        bool operator()(DocId a, DocId b) const { return store->filename(a) < store->filename(b); }
+    };
+    AVLTree<DocId, FilenameOrder> resourceBST{FilenameOrder{&store}};
+    
+    // Radix Trie: Autocomplete for resource names, ranked by downloads. Names
+    // are shared by resources in different folders, so live uses are counted.
+    RadixTrie resourceNameAutocomplete;
+    std::unordered_map<std::string, std::uint32_t> displayNameCounts;
     
-    // Simple Array: Autocomplete for resource names (instead of Trie)
-    SimpleAutocomplete resourceNameAutocomplete;
+    // Ranked Counter: Most popular resources, one entry per resource
+    RankedCounter<DocId> popularResources;
     
-    // Priority Queue: Most popular resources
-    std::priority_queue<ResourceMetadata> popularResources;
+    // Graph: Resource relationships (similar content, references), weighted
+    Graph<DocId> resourceGraph;
     
-    // Graph: Resource relationships (similar content, references)
-    Graph<std::string> resourceGraph;
+    // MinHash signatures per document and their LSH buckets: new resources
+    // are linked in the graph to the similar ones found through the buckets
+    std::vector<MinHashSignature> signatures;
+    SimilarityIndex similarity;
     
     // Hash Maps: Various indexes
-    std::unordered_map<std::string, ResourceMetadata> filenameIndex;
-    std::unordered_map<std::string, std::vector<std::string>> tagIndex;
-    std::unordered_map<std::string, std::vector<std::string>> uploaderIndex;
-    
-    // Inverted Index: Full-text search capability
-    std::unordered_map<std::string, std::vector<std::string>> invertedIndex;
-    
-    void updateInvertedIndex(const ResourceMetadata& resource) {
-        // Simple tokenization and indexing
-        std::string text = resource.displayName + " " + resource.subject + " " + resource.resourceType;
-        std::istringstream iss(text);
-        std::string word;
-        
-        while (iss >> word) {
-            // Convert to lowercase and remove punctuation
-            std::transform(word.begin(), word.end(), word.begin(), ::tolower);
-            word.erase(std::remove_if(word.begin(), word.end(), ::ispunct), word.end());
-            
-            if (!word.empty()) {
-                invertedIndex[word].push_back(resource.filename);
+    std::unordered_map<std::string, std::vector<DocId>> tagIndex;
+    std::unordered_map<std::string, std::vector<DocId>> uploaderIndex;
+    
+    // Inverted Index: Full-text search over compressed postings with field frequencies
+    std::unordered_map<std::string, TermPostings> invertedIndex;
+    
+    // Trigram Vocabulary: Typo-tolerant lookup of query terms missing from the index
+    FuzzyVocabulary vocabulary;
+    
+    // Facet Bitmaps: live ids per year, semester, branch, section, subject and type
+    FacetIndex facets;
+    
+    // B+Trees: live ids ordered by upload time, size and rating (range scans)
+    BPlusTree uploadTimeOrder;
+    BPlusTree sizeOrder;
+    BPlusTree ratingOrder;
+    
+    // BM25 statistics: per-document field lengths and collection totals
+    std::vector<FieldLengths> fieldLengths;
+    CollectionStats collectionStats;
+    RankingParams rankingParams;
+    
+    // Last write-ahead log event reflected here (saved in snapshots)
+    std::uint64_t appliedLsn = 0;
+    
+    void updateInvertedIndex(const AnalyzedDocument& analyzed, DocId id) {
+        fieldLengths.resize(id + 1);
+        fieldLengths[id] = analyzed.lengths;
+        collectionStats.add(analyzed.lengths);
+        
+        // One posting per term and document, carrying its field frequencies
+        for (const auto& [term, tf] : analyzed.terms) {
+            auto [entry, added] = invertedIndex.try_emplace(term);
+            if (added) vocabulary.add(term);
+            entry->second.add(id, tf);
+        }
+    }
+    
+    // Postings a query term stands for: its own when indexed; otherwise those of
+    // its closest spellings (any may match) or of the two words it runs
+    // together (both must match)
+    struct ResolvedTerm {
+        std::vector<const TermPostings*> postings;
+        bool allRequired = false;
+    };
+    
+    static constexpr std::size_t kMaxCorrections = 3;
+    
+    ResolvedTerm resolveTerm(const std::string& term) const {
+        ResolvedTerm resolved;
+        auto exact = invertedIndex.find(term);
+        if (exact != invertedIndex.end()) {
+            resolved.postings.push_back(&exact->second);
+            return resolved;
+        }
+        
+        auto matches = vocabulary.nearest(term, typoBudget(term.size()));
+        auto compound = vocabulary.splitCompound(term);
+        
+        // A one-letter slip beats a split; a split beats a two-letter slip
+        if (compound && (matches.empty() || matches.front().distance > 1)) {
+            resolved.postings = {&invertedIndex.at(compound->first), &invertedIndex.at(compound->second)};
+            resolved.allRequired = true;
+            return resolved;
+        }
+        
+        // Only the closest spellings, the most common ones first
+        std::vector<const TermPostings*> closest;
+        for (const auto& match : matches) {
+            if (match.distance != matches.front().distance) break;
+            closest.push_back(&invertedIndex.at(match.term));
+        }
+        std::stable_sort(closest.begin(), closest.end(), [](const TermPostings* a, const TermPostings* b) {
+            return a->postings.size() > b->postings.size();
+        });
+        if (closest.size() > kMaxCorrections) closest.resize(kMaxCorrections);
+        resolved.postings = std::move(closest);
+        return resolved;
+    }
+    
+    // Folds a multi-term resolution into one list (intersection or union)
+    static CompressedPostingList combinePostings(const ResolvedTerm& resolved) {
+        std::vector<DocId> ids;
+        if (resolved.allRequired) {
+            std::vector<CompressedPostingList::Cursor> cursors;
+            std::vector<CompressedPostingList::Cursor> none;
+            for (const auto* term : resolved.postings) cursors.push_back(term->postings.cursor());
+            ids = intersectCursors(cursors, none);
+        } else {
+            for (const auto* term : resolved.postings) ids = unionPostings(ids, term->postings.decode());
+        }
+        
+        CompressedPostingList combined;
+        for (DocId id : ids) combined.insert(id);
+        return combined;
+    }
+    
+    // Records id's signature and links it to its nearest live neighbours
+    void linkSimilar(DocId id, const MinHashSignature& signature) {
+        signatures.resize(id + 1, MinHasher().result());
+        signatures[id] = signature;
+        if (!hasTerms(signature)) return;
+        auto live = [this](DocId other) { return store.isLive(other); };
+        for (const auto& neighbor : similarity.neighbors(signature, id, signatures, live)) {
+            resourceGraph.addEdge(id, neighbor.id, neighbor.similarity);
+        }
+        similarity.insert(id, signature);
+    }
+    
+    // Fills every id-based structure and the vocabulary from the live rows
+    // (after loading a snapshot or compacting)
+    void rebuildDerivedIndexes();
+    
+    // Dead ids are dropped here, so every query path filters tombstones
+    std::vector<ResourceMetadata> materialize(const std::vector<DocId>& ids) const {
+        std::vector<ResourceMetadata> result;
+        result.reserve(ids.size());
+        for (DocId id : ids) {
+            if (store.isLive(id)) result.push_back(store.get(id));
+        }
+        return result;
+    }
+    
+    // Ids matching a boolean query (see searchByKeyword)
+    std::vector<DocId> matchQuery(const BooleanQuery& parsed) const {
+        std::deque<CompressedPostingList> combined;
+        return evaluateBooleanQuery(parsed,
+            [this, &combined](const std::string& term) -> const CompressedPostingList* {
+                auto resolved = resolveTerm(term);
+                if (resolved.postings.empty()) return nullptr;
+                if (resolved.postings.size() == 1) return &resolved.postings.front()->postings;
+                combined.push_back(combinePostings(resolved));
+                return &combined.back();
+            });
+    }
+    
+    // The k best BM25 matches among live ids that pass accept (see searchRanked)
+    template<typename Accept>
+    std::vector<DocId> rankQuery(const BooleanQuery& parsed, std::size_t k, Accept accept) const {
+        std::vector<const TermPostings*> terms;
+        std::vector<CompressedPostingList::Cursor> excluded;
+        std::unordered_set<std::string> seen;
+        for (const auto& clause : parsed.clauses) {
+            for (const auto& term : clause.required) {
+                if (!seen.insert(term).second) continue;
+                // Corrections and compound parts each contribute their own scores
+                for (const auto* postings : resolveTerm(term).postings) {
+                    if (std::find(terms.begin(), terms.end(), postings) == terms.end()) {
+                        terms.push_back(postings);
+                    }
+                }
+            }
+            for (const auto& term : clause.excluded) {
+                auto it = invertedIndex.find(term);
+                if (it != invertedIndex.end()) {
+                    excluded.push_back(it->second.postings.cursor());
+                }
             }
         }
         
-        // Index tags
-        for (const auto& tag : resource.tags) {
-            std::string lowerTag = tag;
-            std::transform(lowerTag.begin(), lowerTag.end(), lowerTag.begin(), ::tolower);
-            invertedIndex[lowerTag].push_back(resource.filename);
+        // Candidates arrive in increasing id order, so exclusion cursors only move forward
+        auto notExcluded = [this, &excluded, &accept](DocId id) {
+            if (!store.isLive(id) || !accept(id)) return false;
+            for (auto& cursor : excluded) {
+                cursor.advance(id);
+                if (!cursor.atEnd() && cursor.docId() == id) return false;
+            }
+            return true;
+        };
+        
+        Bm25Scorer scorer(rankingParams, collectionStats);
+        auto hits = wandTopK(terms, scorer, k, notExcluded,
+                             [this](DocId id) { return fieldLengths[id]; });
+        
+        std::vector<DocId> ids;
+        for (const auto& hit : hits) ids.push_back(hit.id);
+        return ids;
+    }
+    
+    // ------------------------------------------------------------------------
+    // Tombstones and compaction (resource_index.cpp)
+    // ------------------------------------------------------------------------
+    // Removing a resource flags its row dead and takes it out of the
+    // popularity ranking, autocomplete and facet bitmaps; posting lists, tag/uploader lists,
+    // field lengths, signatures and the graph keep the dead id until compaction. Once dead
+    // rows pass kMaxDeadRatio, a background task renumbers the live rows and
+    // rewrites those structures without the dead ids. Queries keep running on
+    // the current structures meanwhile (the task only reads them); the result
+    // is installed by the next call, and mutations wait for it first.
+    static constexpr double kMaxDeadRatio = 0.2;
+    
+    struct CompactedIndex {
+        ResourceStore store;
+        std::vector<FieldLengths> fieldLengths;
+        std::unordered_map<std::string, TermPostings> invertedIndex;
+        std::vector<MinHashSignature> signatures;
+        std::vector<Graph<DocId>::Edge> edges;
+    };
+    
+    std::future<CompactedIndex> compaction;
+    
+    void tombstone(DocId id);
+    void maybeCompact();
+    CompactedIndex compactLive(std::vector<Graph<DocId>::Edge> edges) const;
+    void installCompaction(CompactedIndex compacted);
+    
+    // Installs a finished compaction without waiting for a running one
+    void pollCompaction() {
+        if (compaction.valid() && compaction.wait_for(std::chrono::seconds(0)) == std::future_status::ready) {
+            installCompaction(compaction.get());
         }
     }
-
+    
+    void finishCompaction() {
+        if (compaction.valid()) installCompaction(compaction.get());
+    }
+    
+    BPlusTree& rangeOrder(RangeColumn column) {
+        switch (column) {
+            case RangeColumn::UploadTime: return uploadTimeOrder;
+            case RangeColumn::Size: return sizeOrder;
+            case RangeColumn::Rating: break;
+        }
+        return ratingOrder;
+    }
+    
+    BPlusTree::Key rangeKey(RangeColumn column, DocId id) const {
+        switch (column) {
+            case RangeColumn::UploadTime: return uploadTimeKey(store.uploadTime(id));
+            case RangeColumn::Size: return BPlusTree::orderedKey(static_cast<std::uint64_t>(store.sizeBytes(id)));
+            case RangeColumn::Rating: break;
+        }
+        return BPlusTree::orderedKey(store.rating(id));
+    }
+    
+    static BPlusTree::Key uploadTimeKey(std::chrono::system_clock::time_point time) {
+        return BPlusTree::orderedKey(static_cast<std::int64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count()));
+    }
+    
 public:
-    ResourceIndex() : resourceBST([](const ResourceMetadata& a, const ResourceMetadata& b) { 
-        return a.filename < b.filename; 
-    }) {}
+    ResourceIndex() = default;
+    
+    // The BST comparator and the compaction task refer back to this object
+    ResourceIndex(const ResourceIndex&) = delete;
+    ResourceIndex& operator=(const ResourceIndex&) = delete;
+    
+    ~ResourceIndex() {
+        if (compaction.valid()) compaction.wait();
+    }
+    
+    // Distinct body terms indexed per document (see StreamingTermCounter)
+    static constexpr std::size_t kMaxContentTerms = 4096;
+    
+    // Tokenizes a resource's fields and streams its file's text. Touches no
+    // index state, so bulk indexing runs it on worker threads.
+    static AnalyzedDocument analyze(const ResourceMetadata& resource) {
+        std::unordered_map<std::string, FieldFrequencies> frequencies;
+        AnalyzedDocument analyzed;
+        Tokenizer tokenizer;
+        
+        auto indexField = [&](IndexField field, const std::string& text) {
+            auto f = static_cast<std::size_t>(field);
+            for (auto term : tokenizer.tokenize(text)) {
+                auto& tf = frequencies[std::string(term)][f];
+                if (tf < UINT8_MAX) ++tf;
+                if (analyzed.lengths[f] < UINT16_MAX) ++analyzed.lengths[f];
+            }
+        };
+        
+        indexField(IndexField::DisplayName, resource.displayName);
+        indexField(IndexField::Subject, resource.subject);
+        indexField(IndexField::ResourceType, resource.resourceType);
+        // Tags use the same tokenization so multi-word tags are queryable
+        for (const auto& tag : resource.tags) {
+            indexField(IndexField::Tags, tag);
+        }
+        
+        // Document body, read chunk by chunk so large files stay out of memory
+        StreamingTermCounter body(kMaxContentTerms);
+        if (!resource.filePath.empty()) {
+            extractText(resource.filePath, [&body](std::string_view text) { body.feed(text); });
+            body.finish();
+        }
+        auto content = static_cast<std::size_t>(IndexField::Content);
+        for (const auto& [term, count] : body.terms()) {
+            frequencies[term][content] = static_cast<std::uint8_t>(std::min<std::uint32_t>(count, UINT8_MAX));
+        }
+        analyzed.lengths[content] = static_cast<std::uint16_t>(std::min<std::uint64_t>(body.termCount(), UINT16_MAX));
+        
+        MinHasher signature;
+        for (const auto& [term, tf] : frequencies) signature.add(term);
+        analyzed.signature = signature.result();
+        
+        analyzed.terms.assign(frequencies.begin(), frequencies.end());
+        return analyzed;
+    }
     
     void addResource(const ResourceMetadata& resource) {
-        // Add to all data structures
-        filenameIndex[resource.filename] = resource;
+        addResource(resource, analyze(resource));
+    }
+    
+    // A resource already stored under the same filename is replaced: its old
+    // row is tombstoned and the new one gets a fresh id
+    void addResource(const ResourceMetadata& resource, const AnalyzedDocument& analyzed) {
+        finishCompaction();
+        auto existing = store.find(resource.filename);
+        if (existing) tombstone(*existing);
+        
+        // Store the row once; everything else refers to its id
+        DocId id = store.add(resource);
+        
+        // Add to BST
+        resourceBST.insert(id);
         
-        // Add to BST (instead of B-Tree)
-        resourceBST.insert(resource);
+        // Add to autocomplete trie, weighted by downloads
+        resourceNameAutocomplete.insert(resource.displayName, resource.downloadCount);
+        ++displayNameCounts[resource.displayName];
         
-        // Add to Simple Autocomplete (instead of Trie)
-        resourceNameAutocomplete.insert(resource.displayName);
+        // Add to popularity ranking
+        popularResources.set(id, resource.downloadCount);
         
-        // Add to popularity queue
-        popularResources.push(resource);
+        // Add to graph, linked to the most similar live resources
+        resourceGraph.addNode(id);
+        linkSimilar(id, analyzed.signature);
         
-        // Add to graph
-        resourceGraph.addNode(resource.filename);
+        // Index by the academic facets of its storage path
+        facets.add(id, facetsFromPath(resource.filename));
+        
+        // Index by upload time, size and rating
+        for (auto column : kRangeColumns) rangeOrder(column).insert(rangeKey(column, id), id);
         
         // Index by tags
         for (const auto& tag : resource.tags) {
-            tagIndex[tag].push_back(resource.filename);
+            insertPosting(tagIndex[tag], id);
         }
         
         // Index by uploader
-        uploaderIndex[resource.uploader].push_back(resource.filename);
+        insertPosting(uploaderIndex[resource.uploader], id);
         
         // Update inverted index
-        updateInvertedIndex(resource);
+        updateInvertedIndex(analyzed, id);
+        
+        if (existing) maybeCompact();
+    }
+    
+    // Re-indexes a stored resource after its file or metadata changed.
+    // Returns false if nothing is stored under resource.filename.
+    bool updateResource(const ResourceMetadata& resource) {
+        if (!store.find(resource.filename)) return false;
+        addResource(resource);
+        return true;
+    }
+    
+    // Drops a resource from every query path in O(1) (see tombstone())
+    bool removeResource(const std::string& filename) {
+        finishCompaction();
+        auto id = store.find(filename);
+        if (!id) return false;
+        tombstone(*id);
+        maybeCompact();
+        return true;
     }
     
-    std::vector<std::string> autocompleteResourceName(const std::string& prefix) {
-        return resourceNameAutocomplete.getWordsWithPrefix(prefix);
+    // Falls back to prefixes within a few typos when nothing starts with prefix
+    std::vector<std::string> autocompleteResourceName(const std::string& prefix, std::size_t limit = 10) {
+        pollCompaction();
+        auto exact = resourceNameAutocomplete.getWordsWithPrefix(prefix, limit);
+        if (!exact.empty()) return exact;
+        return resourceNameAutocomplete.getWordsWithFuzzyPrefix(prefix, typoBudget(prefix.size()), limit);
     }
     
     std::vector<ResourceMetadata> getPopularResources(int count = 10) {
-        std::vector<ResourceMetadata> result;
-        auto tempQueue = popularResources;
-        
-        for (int i = 0; i < count && !tempQueue.empty(); ++i) {
-            result.push_back(tempQueue.top());
-            tempQueue.pop();
-        }
-        
-        return result;
+        if (count <= 0) return {};
+        pollCompaction();
+        return materialize(popularResources.top(count));
     }
     
-    std::vector<ResourceMetadata> searchByKeyword(const std::string& keyword) {
-        std::vector<ResourceMetadata> result;
-        std::string lowerKeyword = keyword;
-        std::transform(lowerKeyword.begin(), lowerKeyword.end(), lowerKeyword.begin(), ::tolower);
-        
-        auto it = invertedIndex.find(lowerKeyword);
-        if (it != invertedIndex.end()) {
-            for (const auto& filename : it->second) {
-                auto resIt = filenameIndex.find(filename);
-                if (resIt != filenameIndex.end()) {
-                    result.push_back(resIt->second);
-                }
+    // Boolean search: terms are ANDed, with OR / NOT / -term operators.
+    // Misspelled and run-together terms are resolved against the vocabulary.
+    std::vector<ResourceMetadata> searchByKeyword(const std::string& query) {
+        pollCompaction();
+        return materialize(matchQuery(parseBooleanQuery(query)));
+    }
+    
+    // Ranked search: the documents searchByKeyword matches (terms ANDed, with
+    // OR / NOT), the k best by BM25 first
+    std::vector<ResourceMetadata> searchRanked(const std::string& query, std::size_t k = 20) {
+        pollCompaction();
+        auto parsed = parseBooleanQuery(query);
+        std::vector<DocId> matches = matchQuery(parsed);   // In increasing id order
+        return materialize(rankQuery(parsed, k, [&matches](DocId id) {
+            return std::binary_search(matches.begin(), matches.end(), id);
+        }));
+    }
+    
+    // Keyword search narrowed by facets ("EndSemPapers for CSE year 2"): the
+    // facet bitmaps are ANDed first, keyword matches are kept only inside that
+    // set, and the k best are ranked by BM25. Counts cover all matches. With
+    // no keywords, every resource in the facets matches, most downloaded first.
+    struct FacetedSearch {
+        std::vector<ResourceMetadata> resources;
+        std::size_t total = 0;
+        FacetCounts counts;
+    };
+    
+    FacetedSearch searchFaceted(const std::string& query, const FacetFilter& filter, std::size_t k = 20) {
+        pollCompaction();
+        FacetedSearch result;
+        RoaringBitmap matches = facets.select(filter);
+        
+        auto parsed = parseBooleanQuery(query);
+        bool hasTerms = std::any_of(parsed.clauses.begin(), parsed.clauses.end(),
+                                    [](const auto& clause) { return !clause.required.empty(); });
+        std::vector<DocId> best;
+        if (hasTerms) {
+            RoaringBitmap keywordMatches;
+            for (DocId id : matchQuery(parsed)) {
+                if (matches.contains(id)) keywordMatches.add(id);
             }
+            matches = std::move(keywordMatches);
+            best = rankQuery(parsed, k, [&matches](DocId id) { return matches.contains(id); });
+        } else {
+            best = matches.toVector();
+            std::size_t keep = std::min(k, best.size());
+            std::partial_sort(best.begin(), best.begin() + keep, best.end(), [this](DocId a, DocId b) {
+                return store.downloadCount(a) > store.downloadCount(b);
+            });
+            best.resize(keep);
         }
         
+        result.total = matches.cardinality();
+        result.counts = facets.count(matches);
+        result.resources = materialize(best);
         return result;
     }
     
+    void setRankingParams(const RankingParams& params) { rankingParams = params; }
+    const RankingParams& getRankingParams() const { return rankingParams; }
+    
     std::vector<ResourceMetadata> getResourcesByTag(const std::string& tag) {
-        std::vector<ResourceMetadata> result;
+        pollCompaction();
         auto it = tagIndex.find(tag);
-        if (it != tagIndex.end()) {
-            for (const auto& filename : it->second) {
-                auto resIt = filenameIndex.find(filename);
-                if (resIt != filenameIndex.end()) {
-                    result.push_back(resIt->second);
-                }
-            }
-        }
-        return result;
+        if (it == tagIndex.end()) return {};
+        return materialize(it->second);
     }
     
     std::vector<ResourceMetadata> getResourcesByUploader(const std::string& uploader) {
-        std::vector<ResourceMetadata> result;
+        pollCompaction();
         auto it = uploaderIndex.find(uploader);
-        if (it != uploaderIndex.end()) {
-            for (const auto& filename : it->second) {
-                auto resIt = filenameIndex.find(filename);
-                if (resIt != filenameIndex.end()) {
-                    result.push_back(resIt->second);
-                }
-            }
-        }
-        return result;
+        if (it == uploaderIndex.end()) return {};
+        return materialize(it->second);
     }
     
     void addResourceRelationship(const std::string& resource1, const std::string& resource2) {
-        resourceGraph.addEdge(resource1, resource2);
+        finishCompaction();
+        auto id1 = store.find(resource1);
+        auto id2 = store.find(resource2);
+        if (id1 && id2) {
+            resourceGraph.addEdge(*id1, *id2);
+        }
     }
     
-    std::vector<std::string> getRelatedResources(const std::string& resourceFilename) {
-        return resourceGraph.getConnected(resourceFilename);
+    // Live neighbours in the resource graph, strongest link first
+    std::vector<RelatedResource> getRelatedResources(const std::string& resourceFilename, std::size_t limit = 10) {
+        pollCompaction();
+        std::vector<RelatedResource> related;
+        auto id = store.find(resourceFilename);
+        if (!id) return related;
+        
+        for (const auto& [other, weight] : resourceGraph.getWeighted(*id)) {
+            if (related.size() == limit) break;
+            if (store.isLive(other)) related.push_back(RelatedResource{store.filename(other), weight});
+        }
+        return related;
     }
     
     void incrementDownloadCount(const std::string& filename) {
-        auto it = filenameIndex.find(filename);
-        if (it != filenameIndex.end()) {
-            it->second.downloadCount++;
-            // Re-add to priority queue with updated count
-            popularResources.push(it->second);
+        finishCompaction();
+        auto id = store.find(filename);
+        if (id) {
+            store.incrementDownloadCount(*id);
+            resourceNameAutocomplete.insert(store.displayName(*id), 1);
+            // Update popularity ranking in place
+            popularResources.increment(*id);
         }
     }
     
-    std::optional<ResourceMetadata> getResource(const std::string& filename) {
-        auto it = filenameIndex.find(filename);
-        if (it != filenameIndex.end()) {
-            return it->second;
+    // ------------------------------------------------------------------------
+    // Range queries (B+trees, resource_index.cpp)
+    // ------------------------------------------------------------------------
+    // Resources whose column lies in [low, high], in column order (descending
+    // for newest / largest / best first), one page of up to limit at a time in
+    // O(log n + limit). A page's cursor continues after its last resource,
+    // also when resources were added or removed in between.
+    struct RangeCursor {
+        BPlusTree::Key key = 0;
+        std::string filename;
+    };
+    
+    struct RangePage {
+        std::vector<ResourceMetadata> resources;
+        std::optional<RangeCursor> next;    // Set when more resources follow
+    };
+    
+    RangePage rangePage(RangeColumn column, BPlusTree::Key low, BPlusTree::Key high, std::size_t limit,
+                        bool descending, const RangeCursor* after = nullptr);
+    
+    RangePage getResourcesUploadedBetween(std::chrono::system_clock::time_point from,
+                                          std::chrono::system_clock::time_point to, std::size_t limit,
+                                          bool newestFirst = true, const RangeCursor* after = nullptr) {
+        return rangePage(RangeColumn::UploadTime, uploadTimeKey(from), uploadTimeKey(to), limit, newestFirst, after);
+    }
+    
+    RangePage getResourcesSizedBetween(std::uint64_t minBytes, std::uint64_t maxBytes, std::size_t limit,
+                                       bool largestFirst = true, const RangeCursor* after = nullptr) {
+        return rangePage(RangeColumn::Size, BPlusTree::orderedKey(minBytes), BPlusTree::orderedKey(maxBytes),
+                         limit, largestFirst, after);
+    }
+    
+    RangePage getResourcesRatedBetween(double minRating, double maxRating, std::size_t limit,
+                                       bool bestFirst = true, const RangeCursor* after = nullptr) {
+        return rangePage(RangeColumn::Rating, BPlusTree::orderedKey(minRating), BPlusTree::orderedKey(maxRating),
+                         limit, bestFirst, after);
+    }
+    
+    std::optional<ResourceMetadata> getResource(const std::string& filename) const {
+        auto id = store.find(filename);
+        if (id) {
+            return store.get(*id);
         }
         return std::nullopt;
     }
+    
+    std::size_t size() const { return store.liveSize(); }
+    
+    // ------------------------------------------------------------------------
+    // Write-ahead log (resource_log.h)
+    // ------------------------------------------------------------------------
+    // Mutations are logged by the owner of the log; the index only remembers
+    // how far the log is reflected in it, so a snapshot knows where replay
+    // has to start.
+    std::uint64_t loggedLsn() const { return appliedLsn; }
+    void markLogged(std::uint64_t lsn) { appliedLsn = std::max(appliedLsn, lsn); }
+    
+    // Applies the logged events newer than loggedLsn(), in order
+    void replay(const std::vector<ResourceEvent>& events);
+    
+    // ------------------------------------------------------------------------
+    // Persistence (resource_index.cpp)
+    // ------------------------------------------------------------------------
+    static constexpr std::uint32_t kSnapshotVersion = 6;
+    
+    // Writes the index to path (via a temporary file, fsync and rename, since
+    // the write-ahead log is emptied once a snapshot holds its events)
+    bool saveSnapshot(const std::string& path, const TreeFingerprint& tree) const;
+    
+    // Maps a snapshot into this (empty) index. Posting lists stay in the mapping
+    // and are read in place. Fails on a missing, corrupt or other-version file,
+    // and on a changed resource tree unless ignoreTree is set.
+    bool loadSnapshot(const std::string& path, bool ignoreTree = false);
+    
+    // Indexes every file under root on a thread pool (bulk_indexer.cpp); rows
+    // found in previous keep their uploader, tags, counts and rating. Records
+    // the tree's directory mtimes in tree when given.
+    BulkIndexStats rebuildFromTree(const std::string& root, const ResourceIndex* previous = nullptr,
+                                   TreeFingerprint* tree = nullptr, std::size_t threads = 0);
+    
+    // Loads the snapshot if it is current, otherwise rebuilds from the tree and
+    // writes a fresh snapshot. Either way the logged events the snapshot lacks
+    // are replayed. Returns true when the snapshot was used as is; rebuilt
+    // receives the rebuild's statistics otherwise.
+    bool openPersistent(const std::string& snapshotPath, const std::string& root,
+                        BulkIndexStats* rebuilt = nullptr, const std::vector<ResourceEvent>& logged = {});
+    
+    // Rebuilds this (empty) index from the tree, carrying over what the old
+    // snapshot and the logged events after it knew, and replaces the snapshot
+    BulkIndexStats rebuildPersistent(const std::string& snapshotPath, const std::string& root,
+                                     std::size_t threads = 0, const std::vector<ResourceEvent>& logged = {});
 };
 
-}
\ No newline at end of file
+}
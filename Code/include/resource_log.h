@@ -0,0 +1,116 @@
+#pragma once
+#include "resource_store.h"
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+
+namespace uni {
+
+// ============================================================================
+// Resource Events (what the write-ahead log records)
+// ============================================================================
+
+enum class ResourceEventType : std::uint8_t {
+    Upsert = 1,     // Resource added or replaced (full row: counts, rating, tags)
+    Remove = 2,     // Resource removed
+    Download = 3,   // Download count incremented
+    Relate = 4,     // Explicit relationship between two resources
+};
+
+struct ResourceEvent {
+    std::uint64_t lsn = 0;                 // Log sequence number, assigned by ResourceLog
+    ResourceEventType type = ResourceEventType::Upsert;
+    ResourceMetadata resource;             // Upsert: the row; others: filename only
+    std::string other;                     // Relate: the second filename
+
+    static ResourceEvent upsert(const ResourceMetadata& resource);
+    static ResourceEvent remove(const std::string& filename);
+    static ResourceEvent download(const std::string& filename);
+    static ResourceEvent relate(const std::string& first, const std::string& second);
+};
+
+// ============================================================================
+// Write-Ahead Log with Group Commit
+// ============================================================================
+// Append-only file of resource events: magic "UNIHUBWL" and a version, then
+// records of (payload length, CRC32C of the payload, payload). A torn or
+// corrupt record ends the log; open() cuts the file there. A batch whose
+// write fails is cut off at once, so the records after it stay readable, and
+// goes back to the front of the queue: it is retried every kRetryDelay until
+// it is written or a snapshot takes it over (reset()). Its events never count
+// as durable meanwhile.
+//
+// append() only queues an event. A committer thread writes everything queued
+// with one write() and one fdatasync(), after waiting up to kCommitDelay for
+// more events to join, so a burst of downloads costs one fsync rather than
+// one each. An event is durable at most kCommitDelay (plus one fsync) after
+// it is appended; sync() waits for everything appended so far.
+//
+// The log only grows until the index is saved: a snapshot records the last
+// LSN it covers (ResourceIndex::loggedLsn()), after which reset() empties the
+// log. Replay skips events the snapshot already holds, so a crash between the
+// two loses nothing and applies nothing twice.
+
+class ResourceLog {
+private:
+    std::string path;
+    int fd = -1;
+
+    std::mutex mutex;
+    std::condition_variable queued;
+    std::condition_variable committed;
+    std::string pending;               // Framed records not yet written
+    std::uint64_t nextLsn = 1;
+    std::uint64_t durableLsn = 0;      // Every event up to this one is on disk
+    std::uint64_t logBytes = 0;        // Size of the log including queued records
+    std::uint64_t writtenBytes = 0;    // Size of the log up to the last batch written in full
+    bool syncRequested = false;
+    bool writing = false;              // The committer is writing a batch
+    bool failed = false;               // The last write failed; its batch waits in pending
+    bool torn = false;                 // A failed write could not be cut off yet; tried again before the retry
+    bool stopping = false;
+    std::thread committer;
+
+    void commitLoop();
+
+public:
+    static constexpr auto kCommitDelay = std::chrono::milliseconds(20);
+    static constexpr auto kRetryDelay = std::chrono::seconds(1);
+
+    explicit ResourceLog(std::string logPath) : path(std::move(logPath)) {}
+    ~ResourceLog();
+
+    ResourceLog(const ResourceLog&) = delete;
+    ResourceLog& operator=(const ResourceLog&) = delete;
+
+    // Opens (or creates) the log, returns its intact events in order and
+    // starts the committer. Returns false if the file cannot be written.
+    bool open(std::vector<ResourceEvent>& events);
+
+    bool isOpen() const { return fd >= 0; }
+
+    // Numbers after lsn are used from now on (the snapshot may be ahead of an
+    // emptied log)
+    void continueAfter(std::uint64_t lsn);
+
+    // Queues the event for the next group commit and returns its LSN (0 if
+    // the log is not open)
+    std::uint64_t append(ResourceEvent event);
+
+    // Waits until every appended event is on disk; false after a write error
+    bool sync();
+
+    // Empties the log once a snapshot holds all its events
+    bool reset();
+
+    // Whether the last write failed (its events are queued, not durable)
+    bool failing();
+
+    std::uint64_t size();
+};
+
+}
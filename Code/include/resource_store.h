@@ -0,0 +1,332 @@
+#pragma once
+#include "query_engine.h"
+#include "binary_io.h"
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <chrono>
+#include <optional>
+#include <algorithm>
+#include <cstdint>
+
+namespace uni {
+
+// ============================================================================
+// Resource Metadata (materialized row)
+// ============================================================================
+
+struct ResourceMetadata {
+    std::string filename;
+    std::string displayName;
+    std::string filePath;
+    std::string resourceType;
+    std::string subject;
+    std::string uploader;
+    std::size_t sizeBytes;
+    std::chrono::system_clock::time_point uploadTime;
+    int downloadCount;
+    double rating;
+    std::vector<std::string> tags;
+
+    ResourceMetadata() : sizeBytes(0), uploadTime(std::chrono::system_clock::now()),
+                        downloadCount(0), rating(0.0) {}
+
+    bool operator<(const ResourceMetadata& other) const {
+        // Popularity order (higher = more popular)
+        return downloadCount < other.downloadCount;
+    }
+
+    // For BST comparison (sort by filename)
+    bool operator<(const std::string& filename) const {
+        return this->filename < filename;
+    }
+};
+
+// ============================================================================
+// String Dictionary: interns low-cardinality values behind 32-bit codes
+// ============================================================================
+class StringDictionary {
+private:
+    std::vector<std::string> values;
+    std::unordered_map<std::string, std::uint32_t> codes;
+
+public:
+    std::uint32_t intern(const std::string& value) {
+        auto it = codes.find(value);
+        if (it != codes.end()) return it->second;
+
+        auto code = static_cast<std::uint32_t>(values.size());
+        values.push_back(value);
+        codes.emplace(value, code);
+        return code;
+    }
+
+    std::optional<std::uint32_t> find(const std::string& value) const {
+        auto it = codes.find(value);
+        if (it != codes.end()) return it->second;
+        return std::nullopt;
+    }
+
+    const std::string& operator[](std::uint32_t code) const { return values[code]; }
+    std::size_t size() const { return values.size(); }
+
+    void serialize(BinaryWriter& out) const { out.putStrings(values); }
+
+    bool deserialize(BinaryReader& in) {
+        values.clear();
+        codes.clear();
+        for (auto& value : in.getStrings()) intern(value);
+        return in.ok();
+    }
+};
+
+// ============================================================================
+// Columnar Resource Store with Dense Ids
+// ============================================================================
+// Single owner of all resource metadata. Each resource gets a dense DocId;
+// every other index refers to resources by id only. Hot fields used by scans
+// and rankings live in contiguous columns, repeated strings are interned.
+class ResourceStore {
+private:
+    // Identity (removed rows keep their slot, flagged dead, until compaction)
+    std::vector<std::string> filenames;
+    std::unordered_map<std::string, DocId> idByFilename;
+    std::vector<std::uint8_t> live;
+    std::size_t liveCount = 0;
+
+    // Cold columns
+    std::vector<std::string> displayNames;
+    std::vector<std::string> filePaths;                 // Empty when equal to the filename
+    std::vector<std::uint32_t> typeCodes;
+    std::vector<std::uint32_t> subjectCodes;
+    std::vector<std::uint32_t> uploaderCodes;
+    std::vector<std::vector<std::uint32_t>> tagCodes;
+    StringDictionary types;
+    StringDictionary subjects;
+    StringDictionary uploaders;
+    StringDictionary tagValues;
+
+    // Hot columns
+    std::vector<int> downloadCounts;
+    std::vector<double> ratings;
+    std::vector<std::size_t> sizes;
+    std::vector<std::chrono::system_clock::time_point> uploadTimes;
+
+    void write(DocId id, const ResourceMetadata& resource) {
+        displayNames[id] = resource.displayName;
+        filePaths[id] = resource.filePath == resource.filename ? std::string() : resource.filePath;
+        typeCodes[id] = types.intern(resource.resourceType);
+        subjectCodes[id] = subjects.intern(resource.subject);
+        uploaderCodes[id] = uploaders.intern(resource.uploader);
+
+        tagCodes[id].clear();
+        for (const auto& tag : resource.tags) {
+            tagCodes[id].push_back(tagValues.intern(tag));
+        }
+
+        downloadCounts[id] = resource.downloadCount;
+        ratings[id] = resource.rating;
+        sizes[id] = resource.sizeBytes;
+        uploadTimes[id] = resource.uploadTime;
+    }
+
+public:
+    // Inserts a new row, or overwrites the row already stored under the same filename
+    DocId add(const ResourceMetadata& resource) {
+        auto it = idByFilename.find(resource.filename);
+        if (it != idByFilename.end()) {
+            write(it->second, resource);
+            return it->second;
+        }
+
+        auto id = static_cast<DocId>(filenames.size());
+        filenames.push_back(resource.filename);
+        idByFilename.emplace(resource.filename, id);
+        live.push_back(1);
+        ++liveCount;
+
+        displayNames.emplace_back();
+        filePaths.emplace_back();
+        typeCodes.emplace_back();
+        subjectCodes.emplace_back();
+        uploaderCodes.emplace_back();
+        tagCodes.emplace_back();
+        downloadCounts.emplace_back();
+        ratings.emplace_back();
+        sizes.emplace_back();
+        uploadTimes.emplace_back();
+
+        write(id, resource);
+        return id;
+    }
+
+    // Tombstones the row in O(1): its filename becomes free for a new row and
+    // the id stays dead until the store is compacted
+    bool remove(DocId id) {
+        if (id >= live.size() || !live[id]) return false;
+        live[id] = 0;
+        --liveCount;
+        idByFilename.erase(filenames[id]);
+        return true;
+    }
+
+    bool isLive(DocId id) const { return id < live.size() && live[id]; }
+    std::size_t liveSize() const { return liveCount; }
+    std::size_t deadSize() const { return filenames.size() - liveCount; }
+
+    // Copy holding only the live rows, renumbered densely in id order.
+    // remap[old id] is the new id, or kNoDoc for dead rows.
+    static constexpr DocId kNoDoc = UINT32_MAX;
+
+    ResourceStore compacted(std::vector<DocId>& remap) const {
+        ResourceStore result;
+        remap.assign(filenames.size(), kNoDoc);
+        for (DocId id = 0; id < filenames.size(); ++id) {
+            if (live[id]) remap[id] = result.add(get(id));
+        }
+        return result;
+    }
+
+    // Live rows only
+    std::optional<DocId> find(const std::string& filename) const {
+        auto it = idByFilename.find(filename);
+        if (it != idByFilename.end()) return it->second;
+        return std::nullopt;
+    }
+
+    // Rebuilds the full row for callers that want a ResourceMetadata value
+    ResourceMetadata get(DocId id) const {
+        ResourceMetadata resource;
+        resource.filename = filenames[id];
+        resource.displayName = displayNames[id];
+        resource.filePath = filePaths[id].empty() ? filenames[id] : filePaths[id];
+        resource.resourceType = types[typeCodes[id]];
+        resource.subject = subjects[subjectCodes[id]];
+        resource.uploader = uploaders[uploaderCodes[id]];
+        for (auto code : tagCodes[id]) {
+            resource.tags.push_back(tagValues[code]);
+        }
+        resource.downloadCount = downloadCounts[id];
+        resource.rating = ratings[id];
+        resource.sizeBytes = sizes[id];
+        resource.uploadTime = uploadTimes[id];
+        return resource;
+    }
+
+    std::size_t size() const { return filenames.size(); }
+
+    const std::string& filename(DocId id) const { return filenames[id]; }
+    const std::string& displayName(DocId id) const { return displayNames[id]; }
+    const std::string& resourceType(DocId id) const { return types[typeCodes[id]]; }
+    const std::string& subject(DocId id) const { return subjects[subjectCodes[id]]; }
+    const std::string& uploader(DocId id) const { return uploaders[uploaderCodes[id]]; }
+
+    int downloadCount(DocId id) const { return downloadCounts[id]; }
+    double rating(DocId id) const { return ratings[id]; }
+    std::size_t sizeBytes(DocId id) const { return sizes[id]; }
+    std::chrono::system_clock::time_point uploadTime(DocId id) const { return uploadTimes[id]; }
+
+    int incrementDownloadCount(DocId id) { return ++downloadCounts[id]; }
+
+    // Columns are written back to back; fixed-width ones as raw arrays
+    void serialize(BinaryWriter& out) const {
+        out.putStrings(filenames);
+        out.putStrings(displayNames);
+        out.putStrings(filePaths);
+        out.putArray(typeCodes);
+        out.putArray(subjectCodes);
+        out.putArray(uploaderCodes);
+        types.serialize(out);
+        subjects.serialize(out);
+        uploaders.serialize(out);
+        tagValues.serialize(out);
+
+        std::vector<std::uint32_t> tagCounts;
+        std::vector<std::uint32_t> flatTags;
+        for (const auto& codes : tagCodes) {
+            tagCounts.push_back(static_cast<std::uint32_t>(codes.size()));
+            flatTags.insert(flatTags.end(), codes.begin(), codes.end());
+        }
+        out.putArray(tagCounts);
+        out.putArray(flatTags);
+
+        std::vector<std::uint64_t> sizeColumn(sizes.begin(), sizes.end());
+        std::vector<std::int64_t> timeColumn;
+        timeColumn.reserve(uploadTimes.size());
+        for (const auto& t : uploadTimes) {
+            timeColumn.push_back(std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count());
+        }
+        out.putArray(downloadCounts);
+        out.putArray(ratings);
+        out.putArray(sizeColumn);
+        out.putArray(timeColumn);
+        out.putArray(live);
+    }
+
+    bool deserialize(BinaryReader& in) {
+        filenames = in.getStrings();
+        displayNames = in.getStrings();
+        filePaths = in.getStrings();
+        typeCodes = in.getArray<std::uint32_t>();
+        subjectCodes = in.getArray<std::uint32_t>();
+        uploaderCodes = in.getArray<std::uint32_t>();
+        if (!types.deserialize(in) || !subjects.deserialize(in) ||
+            !uploaders.deserialize(in) || !tagValues.deserialize(in)) {
+            return false;
+        }
+
+        auto tagCounts = in.getArray<std::uint32_t>();
+        auto flatTags = in.getArray<std::uint32_t>();
+        downloadCounts = in.getArray<int>();
+        ratings = in.getArray<double>();
+        auto sizeColumn = in.getArray<std::uint64_t>();
+        auto timeColumn = in.getArray<std::int64_t>();
+        live = in.getArray<std::uint8_t>();
+        if (!in.ok()) return false;
+
+        const std::size_t n = filenames.size();
+        for (const auto* column : {&typeCodes, &subjectCodes, &uploaderCodes, &tagCounts}) {
+            if (column->size() != n) return false;
+        }
+        if (displayNames.size() != n || filePaths.size() != n || downloadCounts.size() != n ||
+            ratings.size() != n || sizeColumn.size() != n || timeColumn.size() != n || live.size() != n) {
+            return false;
+        }
+
+        // Every code must name a dictionary value
+        auto within = [](const std::vector<std::uint32_t>& column, const StringDictionary& dictionary) {
+            return std::all_of(column.begin(), column.end(),
+                               [&dictionary](std::uint32_t code) { return code < dictionary.size(); });
+        };
+        if (!within(typeCodes, types) || !within(subjectCodes, subjects) || !within(uploaderCodes, uploaders) ||
+            !within(flatTags, tagValues)) {
+            return false;
+        }
+
+        tagCodes.assign(n, {});
+        std::size_t next = 0;
+        for (std::size_t id = 0; id < n; ++id) {
+            if (flatTags.size() - next < tagCounts[id]) return false;
+            tagCodes[id].assign(flatTags.begin() + next, flatTags.begin() + next + tagCounts[id]);
+            next += tagCounts[id];
+        }
+
+        sizes.assign(sizeColumn.begin(), sizeColumn.end());
+        uploadTimes.clear();
+        for (auto ns : timeColumn) {
+            uploadTimes.push_back(std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(std::chrono::nanoseconds(ns))));
+        }
+
+        idByFilename.clear();
+        liveCount = 0;
+        for (std::size_t id = 0; id < n; ++id) {
+            if (!live[id]) continue;
+            idByFilename.emplace(filenames[id], static_cast<DocId>(id));
+            ++liveCount;
+        }
+        return true;
+    }
+};
+
+}
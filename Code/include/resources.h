@@ -3,9 +3,10 @@
 
     This header file defines the interfaces and structures for managing resource files
     within the UniHub-CLI application. It provides functionality for listing, uploading,
-    and downloading files in resource folders. The ResourceItem structure represents
-    metadata for each resource file, and the declared functions allow interaction
-    with the resource storage system.
+    and downloading files in resource folders. Uploaded files are stored deduplicated
+    (see chunk_store.h): the resource path holds a manifest of shared chunks. The
+    ResourceItem structure represents metadata for each resource file, and the declared
+    functions allow interaction with the resource storage system.
 
     These interfaces are used to facilitate file sharing and management among users
     in the application.
@@ -13,9 +14,11 @@
 
 #pragma once // Ensures this header is included only once during compilation
 
+#include "storage.h"  // Provides TransferCallback for progress reports
 #include <string>      // Provides std::string for string handling
 #include <vector>      // Provides std::vector for dynamic arrays
 #include <utility>    // Provides std::pair for returning multiple values
+#include <optional>   // Provides std::optional for optional return values
 
 using namespace std;   // Allows usage of standard library types without std:: prefix
 
@@ -29,15 +32,23 @@ struct ResourceItem {
 };
 
 // Lists all files under the specified resource folder
-// Returns a vector of ResourceItem objects representing each file
+// Returns a vector of ResourceItem objects representing each file (with logical sizes)
 vector<ResourceItem> listResources(const string& folder);
 
-// Uploads a local file to the specified resource folder
+// Uploads a local file to the specified resource folder, storing only chunks not stored yet
 // Returns a pair: (success flag, destination path or error message)
-pair<bool,string> uploadResource(const string& localPath, const string& folder);
+// progress, if given, receives bytes processed and throughput as the upload runs
+// duplicateOf, if given, receives a stored path that already had the same contents (empty if none)
+pair<bool,string> uploadResource(const string& localPath, const string& folder, const TransferCallback& progress = nullptr,
+                                 string* duplicateOf = nullptr);
 
 // Downloads a file from the resource folder to a local destination
 // Returns a pair: (success flag, message indicating result)
-pair<bool,string> downloadResource(const string& storedPath, const string& localDest);
+// progress, if given, receives bytes written and throughput as the download runs
+pair<bool,string> downloadResource(const string& storedPath, const string& localDest, const TransferCallback& progress = nullptr);
+
+// Deletes a stored resource file; its unshared chunks are swept at the next startup
+// Returns a pair: (success flag, deleted path or error message)
+pair<bool,string> deleteResource(const string& storedPath);
 
 } // namespace uni
@@ -0,0 +1,310 @@
+#pragma once
+#include "posting_list.h"
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>
+#include <iterator>
+
+namespace uni {
+
+// ============================================================================
+// Compressed Bitmap (Roaring-style array / bitmap containers)
+// ============================================================================
+// Ids are split into a 16-bit key (high half) and a 16-bit value (low half).
+// Each key's values live in one container: a sorted array while it holds at
+// most kArrayMax values (2 bytes per id), a 65536-bit bitmap beyond that
+// (8 KiB flat). Sparse facets therefore cost little, dense ones stay fixed
+// size, and AND / OR / counts run container by container: a word-wise AND
+// for two bitmaps, probes for an array against a bitmap, a merge otherwise.
+class RoaringBitmap {
+public:
+    static constexpr std::size_t kArrayMax = 4096;
+
+private:
+    static constexpr std::size_t kWords = 65536 / 64;
+
+    struct Container {
+        std::uint16_t key = 0;
+        std::uint32_t cardinality = 0;
+        std::vector<std::uint16_t> array;   // Sorted values (array form)
+        std::vector<std::uint64_t> bits;    // kWords words (bitmap form)
+
+        bool isBitmap() const { return !bits.empty(); }
+
+        bool contains(std::uint16_t value) const {
+            if (isBitmap()) return (bits[value >> 6] >> (value & 63)) & 1;
+            return std::binary_search(array.begin(), array.end(), value);
+        }
+
+        void toBitmap() {
+            bits.assign(kWords, 0);
+            for (auto value : array) bits[value >> 6] |= std::uint64_t(1) << (value & 63);
+            array.clear();
+            array.shrink_to_fit();
+        }
+
+        void toArray() {
+            array.clear();
+            array.reserve(cardinality);
+            forEach([this](std::uint16_t value) { array.push_back(value); });
+            bits.clear();
+            bits.shrink_to_fit();
+        }
+
+        // Picks the smaller form for the current cardinality
+        void normalize() {
+            if (isBitmap() && cardinality <= kArrayMax) toArray();
+            else if (!isBitmap() && cardinality > kArrayMax) toBitmap();
+        }
+
+        bool add(std::uint16_t value) {
+            if (isBitmap()) {
+                std::uint64_t& word = bits[value >> 6];
+                std::uint64_t mask = std::uint64_t(1) << (value & 63);
+                if (word & mask) return false;
+                word |= mask;
+            } else if (array.empty() || array.back() < value) {
+                array.push_back(value);
+            } else {
+                auto pos = std::lower_bound(array.begin(), array.end(), value);
+                if (*pos == value) return false;
+                array.insert(pos, value);
+            }
+            ++cardinality;
+            normalize();
+            return true;
+        }
+
+        bool remove(std::uint16_t value) {
+            if (isBitmap()) {
+                std::uint64_t& word = bits[value >> 6];
+                std::uint64_t mask = std::uint64_t(1) << (value & 63);
+                if (!(word & mask)) return false;
+                word &= ~mask;
+            } else {
+                auto pos = std::lower_bound(array.begin(), array.end(), value);
+                if (pos == array.end() || *pos != value) return false;
+                array.erase(pos);
+            }
+            --cardinality;
+            normalize();
+            return true;
+        }
+
+        template <typename F>
+        void forEach(F&& visit) const {
+            if (!isBitmap()) {
+                for (auto value : array) visit(value);
+                return;
+            }
+            for (std::size_t w = 0; w < kWords; ++w) {
+                for (std::uint64_t word = bits[w]; word != 0; word &= word - 1) {
+                    visit(static_cast<std::uint16_t>(w * 64 + __builtin_ctzll(word)));
+                }
+            }
+        }
+    };
+
+    std::vector<Container> containers;   // Sorted by key
+
+    static std::uint16_t high(DocId id) { return static_cast<std::uint16_t>(id >> 16); }
+    static std::uint16_t low(DocId id) { return static_cast<std::uint16_t>(id & 0xFFFF); }
+
+    static bool keyBefore(const Container& c, std::uint16_t key) { return c.key < key; }
+
+    Container* find(std::uint16_t key) {
+        auto it = std::lower_bound(containers.begin(), containers.end(), key, keyBefore);
+        return it != containers.end() && it->key == key ? &*it : nullptr;
+    }
+
+    const Container* find(std::uint16_t key) const {
+        auto it = std::lower_bound(containers.begin(), containers.end(), key, keyBefore);
+        return it != containers.end() && it->key == key ? &*it : nullptr;
+    }
+
+    static std::size_t intersectCount(const Container& a, const Container& b) {
+        if (a.isBitmap() && b.isBitmap()) {
+            std::size_t count = 0;
+            for (std::size_t w = 0; w < kWords; ++w) count += __builtin_popcountll(a.bits[w] & b.bits[w]);
+            return count;
+        }
+        if (a.isBitmap() || b.isBitmap()) {
+            const Container& sparse = a.isBitmap() ? b : a;
+            const Container& dense = a.isBitmap() ? a : b;
+            std::size_t count = 0;
+            for (auto value : sparse.array) count += dense.contains(value);
+            return count;
+        }
+        std::size_t count = 0;
+        auto i = a.array.begin();
+        auto j = b.array.begin();
+        while (i != a.array.end() && j != b.array.end()) {
+            if (*i < *j) ++i;
+            else if (*j < *i) ++j;
+            else { ++count; ++i; ++j; }
+        }
+        return count;
+    }
+
+    static Container intersect(const Container& a, const Container& b) {
+        Container result;
+        result.key = a.key;
+        if (a.isBitmap() && b.isBitmap()) {
+            result.bits.resize(kWords);
+            for (std::size_t w = 0; w < kWords; ++w) {
+                result.bits[w] = a.bits[w] & b.bits[w];
+                result.cardinality += __builtin_popcountll(result.bits[w]);
+            }
+            result.normalize();
+            return result;
+        }
+        if (a.isBitmap() || b.isBitmap()) {
+            const Container& sparse = a.isBitmap() ? b : a;
+            const Container& dense = a.isBitmap() ? a : b;
+            for (auto value : sparse.array) {
+                if (dense.contains(value)) result.array.push_back(value);
+            }
+        } else {
+            std::set_intersection(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                                  std::back_inserter(result.array));
+        }
+        result.cardinality = static_cast<std::uint32_t>(result.array.size());
+        return result;
+    }
+
+    static Container unite(const Container& a, const Container& b) {
+        Container result;
+        result.key = a.key;
+        if (!a.isBitmap() && !b.isBitmap() && a.cardinality + b.cardinality <= kArrayMax) {
+            std::set_union(a.array.begin(), a.array.end(), b.array.begin(), b.array.end(),
+                           std::back_inserter(result.array));
+            result.cardinality = static_cast<std::uint32_t>(result.array.size());
+            return result;
+        }
+        result.bits.assign(kWords, 0);
+        for (const Container* side : {&a, &b}) {
+            if (side->isBitmap()) {
+                for (std::size_t w = 0; w < kWords; ++w) result.bits[w] |= side->bits[w];
+            } else {
+                for (auto value : side->array) result.bits[value >> 6] |= std::uint64_t(1) << (value & 63);
+            }
+        }
+        for (auto word : result.bits) result.cardinality += __builtin_popcountll(word);
+        result.normalize();
+        return result;
+    }
+
+public:
+    // Returns false if id was already present. Ids added in increasing order
+    // append to the last container.
+    bool add(DocId id) {
+        std::uint16_t key = high(id);
+        if (containers.empty() || containers.back().key < key) {
+            containers.emplace_back();
+            containers.back().key = key;
+            return containers.back().add(low(id));
+        }
+        Container* container = find(key);
+        if (!container) {
+            auto pos = std::lower_bound(containers.begin(), containers.end(), key, keyBefore);
+            container = &*containers.emplace(pos);
+            container->key = key;
+        }
+        return container->add(low(id));
+    }
+
+    bool remove(DocId id) {
+        Container* container = find(high(id));
+        if (!container || !container->remove(low(id))) return false;
+        if (container->cardinality == 0) {
+            containers.erase(containers.begin() + (container - containers.data()));
+        }
+        return true;
+    }
+
+    bool contains(DocId id) const {
+        const Container* container = find(high(id));
+        return container && container->contains(low(id));
+    }
+
+    std::size_t cardinality() const {
+        std::size_t total = 0;
+        for (const auto& c : containers) total += c.cardinality;
+        return total;
+    }
+
+    bool empty() const { return containers.empty(); }
+
+    // |a AND b| without building the intersection
+    static std::size_t andCardinality(const RoaringBitmap& a, const RoaringBitmap& b) {
+        std::size_t count = 0;
+        auto i = a.containers.begin();
+        auto j = b.containers.begin();
+        while (i != a.containers.end() && j != b.containers.end()) {
+            if (i->key < j->key) ++i;
+            else if (j->key < i->key) ++j;
+            else count += intersectCount(*i++, *j++);
+        }
+        return count;
+    }
+
+    static RoaringBitmap intersect(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap result;
+        auto i = a.containers.begin();
+        auto j = b.containers.begin();
+        while (i != a.containers.end() && j != b.containers.end()) {
+            if (i->key < j->key) {
+                ++i;
+            } else if (j->key < i->key) {
+                ++j;
+            } else {
+                Container c = intersect(*i++, *j++);
+                if (c.cardinality > 0) result.containers.push_back(std::move(c));
+            }
+        }
+        return result;
+    }
+
+    static RoaringBitmap unite(const RoaringBitmap& a, const RoaringBitmap& b) {
+        RoaringBitmap result;
+        auto i = a.containers.begin();
+        auto j = b.containers.begin();
+        while (i != a.containers.end() || j != b.containers.end()) {
+            if (j == b.containers.end() || (i != a.containers.end() && i->key < j->key)) {
+                result.containers.push_back(*i++);
+            } else if (i == a.containers.end() || j->key < i->key) {
+                result.containers.push_back(*j++);
+            } else {
+                result.containers.push_back(unite(*i++, *j++));
+            }
+        }
+        return result;
+    }
+
+    // Ids in increasing order
+    template <typename F>
+    void forEach(F&& visit) const {
+        for (const auto& c : containers) {
+            DocId base = static_cast<DocId>(c.key) << 16;
+            c.forEach([&](std::uint16_t value) { visit(base | value); });
+        }
+    }
+
+    std::vector<DocId> toVector() const {
+        std::vector<DocId> ids;
+        ids.reserve(cardinality());
+        forEach([&ids](DocId id) { ids.push_back(id); });
+        return ids;
+    }
+
+    std::size_t memoryBytes() const {
+        std::size_t bytes = containers.capacity() * sizeof(Container);
+        for (const auto& c : containers) {
+            bytes += c.array.capacity() * sizeof(std::uint16_t) + c.bits.capacity() * sizeof(std::uint64_t);
+        }
+        return bytes;
+    }
+};
+
+}
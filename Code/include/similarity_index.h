@@ -0,0 +1,176 @@
+#pragma once
+#include "posting_list.h"
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace uni {
+
+// ============================================================================
+// Near-Duplicate Detection (MinHash signatures + LSH banding)
+// ============================================================================
+
+inline constexpr std::size_t kMinHashes = 64;
+
+// Per hash function, the smallest hash over a document's term set. The share
+// of positions where two signatures agree estimates the Jaccard similarity of
+// their term sets (standard error about 1 / sqrt(kMinHashes)).
+using MinHashSignature = std::array<std::uint32_t, kMinHashes>;
+
+class MinHasher {
+private:
+    MinHashSignature signature;
+
+    // FNV-1a, so signatures stay comparable across builds and snapshots
+    static std::uint64_t hashTerm(std::string_view term) {
+        std::uint64_t h = 0xcbf29ce484222325ULL;
+        for (unsigned char c : term) {
+            h ^= c;
+            h *= 0x100000001b3ULL;
+        }
+        return h;
+    }
+
+    static std::uint64_t mix(std::uint64_t x) {
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+public:
+    MinHasher() { signature.fill(UINT32_MAX); }
+
+    // The kMinHashes functions are h1 + i * h2 over two hashes of the term,
+    // which behaves like independent hashes for MinHash at one mix per term
+    void add(std::string_view term) {
+        std::uint64_t h1 = mix(hashTerm(term));
+        std::uint64_t h2 = mix(h1) | 1;
+        for (std::size_t i = 0; i < kMinHashes; ++i) {
+            auto value = static_cast<std::uint32_t>((h1 + i * h2) >> 32);
+            signature[i] = std::min(signature[i], value);
+        }
+    }
+
+    const MinHashSignature& result() const { return signature; }
+};
+
+// False for the signature of an empty term set, which matches nothing
+inline bool hasTerms(const MinHashSignature& signature) {
+    return std::any_of(signature.begin(), signature.end(), [](std::uint32_t v) { return v != UINT32_MAX; });
+}
+
+inline double estimateSimilarity(const MinHashSignature& a, const MinHashSignature& b) {
+    std::size_t agree = 0;
+#if defined(__SSE2__)
+    // Four positions per compare, one mask bit per agreeing position
+    for (std::size_t i = 0; i < kMinHashes; i += 4) {
+        __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a.data() + i));
+        __m128i y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b.data() + i));
+        agree += __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(x, y))));
+    }
+#else
+    for (std::size_t i = 0; i < kMinHashes; ++i) agree += a[i] == b[i];
+#endif
+    return static_cast<double>(agree) / kMinHashes;
+}
+
+// Locality-sensitive index over signatures: kBands bands of kRows values
+// each, one bucket table per band. Documents sharing any band are candidates,
+// which happens with probability 1 - (1 - s^kRows)^kBands at similarity s
+// (about 0.64 at s = 0.5, above 0.99 at s = 0.75), so neighbours are found
+// without comparing against every document.
+class SimilarityIndex {
+public:
+    static constexpr std::size_t kBands = 16;
+    static constexpr std::size_t kRows = kMinHashes / kBands;
+
+    // Estimated Jaccard similarity needed for a neighbour
+    static constexpr double kMinSimilarity = 0.5;
+    // Neighbours kept per lookup, most similar first
+    static constexpr std::size_t kMaxNeighbors = 8;
+    // Most recent members checked per bucket, so large clusters of similar
+    // documents do not make every insertion linear
+    static constexpr std::size_t kMaxBucketScan = 32;
+    // Candidates whose signatures are compared per lookup
+    static constexpr std::size_t kMaxVerified = 4 * kMaxNeighbors;
+
+    struct Neighbor {
+        DocId id;
+        double similarity;
+    };
+
+private:
+    std::array<std::unordered_map<std::uint64_t, std::vector<DocId>>, kBands> buckets;
+
+    static std::uint64_t bandKey(const MinHashSignature& signature, std::size_t band) {
+        std::uint64_t key = 0;
+        for (std::size_t r = 0; r < kRows; ++r) {
+            key = (key ^ signature[band * kRows + r]) * 0x9e3779b97f4a7c15ULL;
+        }
+        return key;
+    }
+
+public:
+    void insert(DocId id, const MinHashSignature& signature) {
+        for (std::size_t band = 0; band < kBands; ++band) {
+            buckets[band][bandKey(signature, band)].push_back(id);
+        }
+    }
+
+    // Indexed documents other than self that pass accept and reach
+    // kMinSimilarity against signature, at most kMaxNeighbors of them.
+    // signatures holds every indexed document's signature by id.
+    template<typename Accept>
+    std::vector<Neighbor> neighbors(const MinHashSignature& signature, DocId self,
+                                    const std::vector<MinHashSignature>& signatures, Accept accept) const {
+        std::vector<DocId> candidates;
+        for (std::size_t band = 0; band < kBands; ++band) {
+            auto it = buckets[band].find(bandKey(signature, band));
+            if (it == buckets[band].end()) continue;
+            const auto& members = it->second;
+            auto first = members.size() > kMaxBucketScan ? members.end() - kMaxBucketScan : members.begin();
+            candidates.insert(candidates.end(), first, members.end());
+        }
+        std::sort(candidates.begin(), candidates.end());
+
+        // Bands shared per candidate: more shared bands means likely more
+        // similar, so only the kMaxVerified strongest signatures are compared
+        std::vector<std::pair<DocId, std::uint32_t>> shared;
+        for (std::size_t i = 0; i < candidates.size();) {
+            std::size_t j = i;
+            while (j < candidates.size() && candidates[j] == candidates[i]) ++j;
+            if (candidates[i] != self && accept(candidates[i])) {
+                shared.emplace_back(candidates[i], static_cast<std::uint32_t>(j - i));
+            }
+            i = j;
+        }
+        if (shared.size() > kMaxVerified) {
+            std::nth_element(shared.begin(), shared.begin() + kMaxVerified, shared.end(),
+                             [](const auto& a, const auto& b) { return a.second > b.second; });
+            shared.resize(kMaxVerified);
+        }
+
+        std::vector<Neighbor> found;
+        for (const auto& [id, bands] : shared) {
+            double similarity = estimateSimilarity(signature, signatures[id]);
+            if (similarity >= kMinSimilarity) found.push_back(Neighbor{id, similarity});
+        }
+        std::size_t keep = std::min(kMaxNeighbors, found.size());
+        std::partial_sort(found.begin(), found.begin() + keep, found.end(), [](const Neighbor& a, const Neighbor& b) {
+            return a.similarity != b.similarity ? a.similarity > b.similarity : a.id < b.id;
+        });
+        found.resize(keep);
+        return found;
+    }
+};
+
+}
@@ -4,7 +4,8 @@
     This header file defines interfaces for file and directory operations used in
     the UniHub-CLI application. It provides functions for managing data and resource
     directories, reading and writing text files, listing files in directories, and
-    copying files. These functions abstract the underlying file system operations
+    copying files (by reflink or in-kernel copy where the filesystem allows, with
+    progress reporting). These functions abstract the underlying file system operations
     required for persistent storage and resource management in the application.
 */
 
@@ -14,6 +15,9 @@
 #include <optional>    // Provides std::optional for optional return values
 #include <vector>      // Provides std::vector for dynamic arrays
 #include <filesystem> // Provides filesystem utilities (C++17 feature)
+#include <memory>      // Provides std::shared_ptr for shared file mappings
+#include <functional>  // Provides std::function for progress callbacks
+#include <cstdint>     // Provides fixed-width integer types
 
 using namespace std;   // Allows usage of standard library types without std:: prefix
 
@@ -23,14 +27,56 @@ string dataDir();         // Returns the path to the application's data director
 
 string resourcesDir();    // Returns the path to the application's resources directory
 
+string indexDir();        // Returns the path to the directory holding persistent index files
+
+string chunksDir();       // Returns the path to the deduplicated chunk store
+
 bool ensureDir(const string& path); // Ensures the specified directory exists (creates if needed), returns true on success
 
 optional<string> readTextFile(const string& path); // Reads the contents of a text file, returns content or std::nullopt on failure
 
-optional<string> writeTextFile(const string& path, const string& content); // Writes content to a text file, returns error message or std::nullopt on success
+optional<string> writeTextFile(const string& path, const string& content); // Replaces a text file atomically (see replaceFile), returns error message or std::nullopt on success
+
+// Replaces the file at path atomically and durably: the data goes to a temporary file beside it, which is
+// flushed to disk and renamed over path before the directory is flushed. Readers and crashes see either
+// the old or the new content, never a mix. Returns true on success.
+// With durable false nothing is flushed (readers still never see a partial file); the caller makes many
+// such files durable at once, e.g. with syncfs, before anything refers to them.
+bool replaceFile(const string& path, const char* data, size_t size, bool durable = true);
 
 vector<string> listFiles(const string& path); // Lists all files in the specified directory, returns a vector of filenames
 
-bool copyFile(const string& src, const string& dst); // Copies a file from src to dst, returns true on success
+// Progress of a file transfer, reported after each step and once at the end
+struct TransferProgress {
+    uint64_t bytesDone = 0;      // Bytes transferred so far
+    uint64_t totalBytes = 0;     // Bytes to transfer in total
+    double seconds = 0.0;        // Time since the transfer started
+    const char* method = "";     // How bytes are moved: reflink, copy_file_range, sendfile or buffered
+    double bytesPerSecond() const { return seconds > 0 ? bytesDone / seconds : 0.0; } // Average throughput
+};
+
+using TransferCallback = function<void(const TransferProgress&)>; // Receives transfer progress
+
+// Copies a file from src to dst, returns true on success. Tries a reflink (shared extents), then
+// copy_file_range and sendfile (in-kernel copies), then aligned buffered reads and writes. Large
+// files are evicted from the page cache behind the copy, since their pages are not read again.
+bool copyFile(const string& src, const string& dst, const TransferCallback& progress = nullptr);
+
+void dropCachedPages(const string& path); // Asks the kernel to evict a file's clean cached pages (after one-shot reads)
+
+// Read-only memory mapping of a whole file; unmapped when the last owner releases it
+class MappedFile {
+public:
+    static shared_ptr<const MappedFile> open(const string& path); // Maps the file, returns nullptr on failure
+    ~MappedFile();                                                 // Unmaps the file
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    const char* data() const { return base; }                      // Start of the mapped bytes
+    size_t size() const { return length; }                         // Number of mapped bytes
+private:
+    MappedFile(const char* b, size_t n) : base(b), length(n) {}
+    const char* base;   // Mapping address
+    size_t length;      // Mapping length in bytes
+};
 
 } // namespace uni
@@ -0,0 +1,86 @@
+#pragma once
+#include <vector>
+#include <queue>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <cstdint>
+#include <algorithm>
+
+namespace uni {
+
+// ============================================================================
+// Fixed-size Thread Pool
+// ============================================================================
+// Tasks run in FIFO order on a fixed set of workers. Each worker knows its own
+// index (currentWorker()), so callers can keep per-worker partial results
+// without locking. The destructor finishes queued tasks before joining.
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable available;
+    bool stopping = false;
+
+    static inline thread_local std::size_t workerIndex = SIZE_MAX;
+
+    void workerLoop(std::size_t index) {
+        workerIndex = index;
+        while (true) {
+            std::function<void()> task;
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                available.wait(lock, [this] { return stopping || !tasks.empty(); });
+                if (tasks.empty()) return;
+                task = std::move(tasks.front());
+                tasks.pop();
+            }
+            task();
+        }
+    }
+
+public:
+    // threads == 0 uses one worker per hardware thread
+    explicit ThreadPool(std::size_t threads = 0) {
+        if (threads == 0) threads = std::max(1u, std::thread::hardware_concurrency());
+        for (std::size_t i = 0; i < threads; ++i) {
+            workers.emplace_back(&ThreadPool::workerLoop, this, i);
+        }
+    }
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        available.notify_all();
+        for (auto& worker : workers) worker.join();
+    }
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    template<typename F>
+    auto submit(F&& fn) -> std::future<decltype(fn())> {
+        using Result = decltype(fn());
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<F>(fn));
+        std::future<Result> result = task->get_future();
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            tasks.emplace([task] { (*task)(); });
+        }
+        available.notify_one();
+        return result;
+    }
+
+    std::size_t size() const { return workers.size(); }
+
+    // Index of the calling worker in [0, size()), or SIZE_MAX off the pool
+    static std::size_t currentWorker() { return workerIndex; }
+};
+
+}
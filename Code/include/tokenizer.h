@@ -0,0 +1,69 @@
+#pragma once
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+
+namespace uni {
+
+// ============================================================================
+// Tokenizer (SIMD ASCII fast path, UTF-8 case folding)
+// ============================================================================
+// Splits text into index terms: maximal runs of letters, marks and digits in
+// any script, folded to lower case. Everything else (whitespace, punctuation,
+// symbols, invalid UTF-8) separates terms, so "notes_DSA-2024.pdf" yields
+// "notes", "dsa", "2024", "pdf".
+//
+// Sixteen-byte blocks of pure ASCII are lowered and classified with SSE2 and
+// their token boundaries read off a bit mask; other input is decoded one code
+// point at a time with simple Unicode case folding for Latin, Greek, Cyrillic
+// and Armenian (scripts without case, such as Devanagari and Tamil, pass
+// through unchanged). Zero-width joiners are dropped without splitting a word.
+//
+// Folded text goes into a buffer owned by the tokenizer and tokens are views
+// into it, so tokenizing allocates nothing once the buffers have grown. The
+// views stay valid until the next call on the same tokenizer.
+class Tokenizer {
+public:
+    // Longer runs (hashes, base64, minified code) are not useful terms
+    static constexpr std::size_t kMaxTokenBytes = 64;
+
+private:
+    std::string buffer;
+    std::vector<std::pair<std::uint32_t, std::uint32_t>> spans;   // (offset, length) in buffer
+    std::vector<std::string_view> tokens;
+
+    std::size_t tokenStart = 0;
+    bool inToken = false;
+
+    void open(std::size_t offset) {
+        tokenStart = offset;
+        inToken = true;
+    }
+
+    void close(std::size_t offset) {
+        inToken = false;
+        std::size_t length = offset - tokenStart;
+        if (length > 0 && length <= kMaxTokenBytes) {
+            spans.emplace_back(static_cast<std::uint32_t>(tokenStart), static_cast<std::uint32_t>(length));
+        }
+    }
+
+    std::size_t scanAsciiBlocks(const char* data, std::size_t size);
+    std::size_t scanCodePoint(const char* data, std::size_t size);
+
+public:
+    const std::vector<std::string_view>& tokenize(std::string_view text);
+
+    // Convenience for callers that keep their terms
+    std::vector<std::string> terms(std::string_view text);
+};
+
+// Simple case folding of one code point (identity for uncased scripts)
+char32_t foldCase(char32_t cp);
+
+// Whether a non-ASCII code point belongs inside a term (letters, marks, digits)
+bool isTermCodePoint(char32_t cp);
+
+}
@@ -0,0 +1,61 @@
+#pragma once
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <cstddef>
+
+namespace uni {
+
+// ============================================================================
+// CRC32C (Castagnoli)
+// ============================================================================
+// Uses the SSE4.2 crc32 instruction when the CPU has it, slicing-by-8 tables
+// otherwise. Pass a previous result as crc to continue a running checksum.
+
+std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc = 0);
+
+// ============================================================================
+// Transfer Journal (resumable transfers)
+// ============================================================================
+// A sidecar file recording which parts of a long transfer are done. The header
+// holds a key naming the transfer (source path, size, modification time, ...);
+// each record after it is an opaque payload guarded by its own CRC32C. Records
+// are appended without fsync: a crash can lose or tear the last ones, and a
+// torn record ends the journal where it starts. Whatever a record claims is
+// checked against the data on resume, so the journal never has to be in step
+// with the data it describes.
+
+class TransferJournal {
+private:
+    std::string path;
+    int fd = -1;
+    std::vector<std::uint64_t> recordEnds;  // End of the header, then of each record open() read
+    std::mutex mutex;
+
+public:
+    explicit TransferJournal(std::string journalPath) : path(std::move(journalPath)) {}
+    ~TransferJournal();
+
+    TransferJournal(const TransferJournal&) = delete;
+    TransferJournal& operator=(const TransferJournal&) = delete;
+
+    // Opens the journal for the transfer named by key and returns the records
+    // an earlier run of the same transfer left. A journal for another key (or
+    // none) is started over. Returns false if the file cannot be written.
+    bool open(const std::string& key, std::vector<std::string>& records);
+
+    // Drops the records open() returned after the first keep of them
+    bool truncate(std::size_t keep);
+
+    // Appends one record; safe to call from several threads
+    bool append(const std::string& record);
+
+    // Closes and deletes the journal once the transfer is complete
+    void discard();
+
+    // Records of the journal at path, whatever its key (for housekeeping)
+    static std::vector<std::string> readRecords(const std::string& path);
+};
+
+}
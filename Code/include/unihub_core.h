@@ -2,6 +2,8 @@
 #include "user_manager.h"
 #include "academic_manager.h"
 #include "resource_index.h"
+#include "resource_catalog.h"
+#include "storage.h"
 #include <stack>
 #include <string>
 #include <vector>
@@ -83,6 +85,21 @@ private:
     ResourceIndex resourceIndex;
     NavigationManager navigationManager;
     
+    // Write-ahead log of resource index mutations, folded into the snapshot
+    // once it reaches kLogCheckpointBytes, when it cannot be written, and on
+    // exit
+    ResourceLog resourceLog{indexDir() + "/resources.wal"};
+    static constexpr std::uint64_t kLogCheckpointBytes = 4ull << 20;
+    
+    void logResourceEvent(ResourceEvent event) {
+        resourceIndex.markLogged(resourceLog.append(std::move(event)));
+    }
+    
+    // A failing log holds events only in memory; the snapshot saves them
+    void maybeCheckpoint() {
+        if (resourceLog.failing() || resourceLog.size() >= kLogCheckpointBytes) saveResourceIndex();
+    }
+    
     // Current session
     std::optional<UserRecord> currentUser;
 
@@ -116,6 +133,20 @@ public:
     std::vector<std::string> searchUsersByPrefix(const std::string& prefix) {
         return userManager.searchUsersByPrefix(prefix);
     }
+    std::size_t countUsers() const { return userManager.countUsers(); }
+    
+    // Registers the students of a CSV file in one batch, then saves the users snapshot
+    UserImportStats importUsers(const std::string& csvPath, std::size_t threads = 0) {
+        UserImportStats stats = userManager.importUsers(csvPath, threads);
+        if (stats.imported > 0) userManager.saveSnapshot(usersSnapshotPath());
+        return stats;
+    }
+    std::vector<std::string> getUsersPage(std::size_t first, std::size_t limit) const {
+        return userManager.getUsersPage(first, limit);
+    }
+    std::pair<std::size_t, std::size_t> userPrefixRange(const std::string& prefix) const {
+        return userManager.prefixRange(prefix);
+    }
     
     // Academic Management
     std::vector<EnhancedSubject> getSubjects(int year, int semester, const std::string& branch, char section) {
@@ -138,9 +169,29 @@ public:
         return academicManager.getSubject(code);
     }
     
-    // Resource Management
+    // Resource Management (every mutation is logged)
     void addResource(const ResourceMetadata& resource) {
         resourceIndex.addResource(resource);
+        logResourceEvent(ResourceEvent::upsert(resource));
+        maybeCheckpoint();
+    }
+    
+    bool updateResource(const ResourceMetadata& resource) {
+        if (!resourceIndex.updateResource(resource)) return false;
+        logResourceEvent(ResourceEvent::upsert(resource));
+        maybeCheckpoint();
+        return true;
+    }
+    
+    bool removeResource(const std::string& filename) {
+        if (!resourceIndex.removeResource(filename)) return false;
+        logResourceEvent(ResourceEvent::remove(filename));
+        maybeCheckpoint();
+        return true;
+    }
+    
+    std::optional<ResourceMetadata> getResource(const std::string& filename) const {
+        return resourceIndex.getResource(filename);
     }
     
     std::vector<std::string> autocompleteResourceName(const std::string& prefix) {
@@ -151,20 +202,141 @@ public:
         return resourceIndex.getPopularResources(count);
     }
     
+    // Range queries, a page at a time (pass the previous page's cursor)
+    ResourceIndex::RangePage getResourcesUploadedBetween(std::chrono::system_clock::time_point from,
+                                                         std::chrono::system_clock::time_point to,
+                                                         std::size_t limit, bool newestFirst = true,
+                                                         const ResourceIndex::RangeCursor* after = nullptr) {
+        return resourceIndex.getResourcesUploadedBetween(from, to, limit, newestFirst, after);
+    }
+    
+    ResourceIndex::RangePage getResourcesSizedBetween(std::uint64_t minBytes, std::uint64_t maxBytes,
+                                                      std::size_t limit, bool largestFirst = true,
+                                                      const ResourceIndex::RangeCursor* after = nullptr) {
+        return resourceIndex.getResourcesSizedBetween(minBytes, maxBytes, limit, largestFirst, after);
+    }
+    
+    ResourceIndex::RangePage getResourcesRatedBetween(double minRating, double maxRating, std::size_t limit,
+                                                      bool bestFirst = true,
+                                                      const ResourceIndex::RangeCursor* after = nullptr) {
+        return resourceIndex.getResourcesRatedBetween(minRating, maxRating, limit, bestFirst, after);
+    }
+    
     std::vector<ResourceMetadata> searchResourcesByKeyword(const std::string& keyword) {
         return resourceIndex.searchByKeyword(keyword);
     }
     
+    std::vector<ResourceMetadata> searchResourcesRanked(const std::string& query, std::size_t k = 20) {
+        return resourceIndex.searchRanked(query, k);
+    }
+    
+    ResourceIndex::FacetedSearch searchResourcesFaceted(const std::string& query, const FacetFilter& filter,
+                                                        std::size_t k = 20) {
+        return resourceIndex.searchFaceted(query, filter, k);
+    }
+    
+    void setRankingParams(const RankingParams& params) {
+        resourceIndex.setRankingParams(params);
+    }
+    
     std::vector<ResourceMetadata> getResourcesByTag(const std::string& tag) {
         return resourceIndex.getResourcesByTag(tag);
     }
     
-    std::vector<std::string> getRelatedResources(const std::string& resourceFilename) {
+    void addResourceRelationship(const std::string& first, const std::string& second) {
+        resourceIndex.addResourceRelationship(first, second);
+        logResourceEvent(ResourceEvent::relate(first, second));
+        maybeCheckpoint();
+    }
+    
+    std::vector<RelatedResource> getRelatedResources(const std::string& resourceFilename) {
         return resourceIndex.getRelatedResources(resourceFilename);
     }
     
+    // Logged without waiting for the disk: concurrent downloads share the
+    // log's next group commit
     void incrementDownloadCount(const std::string& filename) {
         resourceIndex.incrementDownloadCount(filename);
+        logResourceEvent(ResourceEvent::download(filename));
+        maybeCheckpoint();
+    }
+    
+    // Applies what the resource catalog saw change in the tree (files dropped in,
+    // overwritten or removed from outside) to the index. Rows the application
+    // wrote itself are newer than their files and stay as they are.
+    std::size_t syncResourceCatalog() {
+        std::size_t applied = 0;
+        for (const auto& path : resourceCatalog().takeChanges()) {
+            auto described = describeStoredResource(resourcesDir(), path);
+            auto known = resourceIndex.getResource(path);
+            if (!described) {
+                if (known && resourceIndex.removeResource(path)) {
+                    logResourceEvent(ResourceEvent::remove(path));
+                    ++applied;
+                }
+                continue;
+            }
+            if (!known) {
+                resourceIndex.addResource(*described);
+                logResourceEvent(ResourceEvent::upsert(*described));
+            } else if (described->uploadTime > known->uploadTime || described->sizeBytes != known->sizeBytes) {
+                // Keep what the tree cannot tell us (uploader, tags, counts, subject code)
+                known->sizeBytes = described->sizeBytes;
+                known->uploadTime = described->uploadTime;
+                resourceIndex.updateResource(*known);
+                logResourceEvent(ResourceEvent::upsert(*known));
+            } else {
+                continue;
+            }
+            ++applied;
+        }
+        return applied;
+    }
+    
+    // Resource index persistence: loaded (or rebuilt) at startup, saved on exit
+    std::string resourceSnapshotPath() const { return indexDir() + "/resources.idx"; }
+    std::string usersSnapshotPath() const { return indexDir() + "/users.snap"; }
+    
+    // Loads every user from the users snapshot, or from the per-user files if
+    // they changed since it was written; returns whether the snapshot was used
+    bool openUsers() {
+        return userManager.openPersistent(usersSnapshotPath());
+    }
+    
+    // Saves the users and resource index snapshots (each replaced atomically)
+    bool saveState() {
+        bool usersSaved = userManager.saveSnapshot(usersSnapshotPath());
+        return saveResourceIndex() && usersSaved;
+    }
+    
+    // Events logged after the snapshot (a crash, or a session that never
+    // reached its exit) are replayed and folded into a fresh snapshot
+    bool openResourceIndex(BulkIndexStats* rebuilt = nullptr) {
+        std::vector<ResourceEvent> logged;
+        resourceLog.open(logged);
+        bool current = resourceIndex.openPersistent(resourceSnapshotPath(), resourcesDir(), rebuilt, logged);
+        resourceLog.continueAfter(resourceIndex.loggedLsn());
+        if (!logged.empty()) saveResourceIndex();
+        return current;
+    }
+    
+    // Rebuilds the index from the resource tree even if the snapshot is current
+    // (instead of openResourceIndex, on a fresh core)
+    BulkIndexStats reindexResources(std::size_t threads = 0) {
+        std::vector<ResourceEvent> logged;
+        resourceLog.open(logged);
+        BulkIndexStats stats = resourceIndex.rebuildPersistent(resourceSnapshotPath(), resourcesDir(), threads, logged);
+        resourceLog.continueAfter(resourceIndex.loggedLsn());
+        resourceLog.reset();
+        return stats;
+    }
+    
+    // Writes a snapshot holding every logged event, then empties the log
+    bool saveResourceIndex() {
+        syncResourceCatalog();
+        if (!resourceIndex.saveSnapshot(resourceSnapshotPath(), TreeFingerprint::scan(resourcesDir()))) return false;
+        resourceLog.reset();
+        return true;
     }
     
     // Navigation Management
@@ -1,13 +1,59 @@
 #pragma once
 #include "auth.h"
 #include "data_structures.h"
+#include "binary_io.h"
+#include "storage.h"
 #include <unordered_map>
 #include <list>
 #include <memory>
 #include <optional>
+#include <filesystem>
+#include <system_error>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <limits>
+#include <chrono>
+#include <charconv>
+#include <cctype>
 
 namespace uni {
 
+// Branch code for a code or full name in any case ("cse", "Civil Engineering"),
+// or nullopt for an unknown branch
+inline std::optional<std::string> normalizeBranch(const std::string& branch) {
+    static const std::pair<const char*, const char*> kBranches[] = {
+        {"CSE", "COMPUTER SCIENCE AND ENGINEERING"},
+        {"ECE", "ELECTRONICS AND COMMUNICATION ENGINEERING"},
+        {"EEE", "ELECTRICAL AND ELECTRONICS ENGINEERING"},
+        {"ICE", "INSTRUMENTATION AND CONTROL ENGINEERING"},
+        {"ME", "MECHANICAL ENGINEERING"},
+        {"CHE", "CHEMICAL ENGINEERING"},
+        {"PROD", "PRODUCTION ENGINEERING"},
+        {"CIVIL", "CIVIL ENGINEERING"},
+        {"MME", "METALLURGICAL AND MATERIALS ENGINEERING"},
+        {"ARCH", "ARCHITECTURE"},
+    };
+    std::string upper = branch;
+    std::transform(upper.begin(), upper.end(), upper.begin(), [](unsigned char c) { return std::toupper(c); });
+    for (const auto& [code, name] : kBranches) {
+        if (upper == code || upper == name) return std::string(code);
+    }
+    return std::nullopt;
+}
+
+struct UserImportStats {
+    std::size_t rows = 0;               // Data rows in the file
+    std::size_t imported = 0;
+    std::size_t threads = 0;            // Threads that hashed the credentials
+    double parseSeconds = 0.0;          // Reading and checking the rows
+    double registerSeconds = 0.0;       // Hashing credentials, writing and flushing the batch
+    std::vector<std::string> errors;    // "line N: reason" for each row not imported
+    
+    double seconds() const { return parseSeconds + registerSeconds; }
+    double usersPerSecond() const { return seconds() > 0 ? imported / seconds() : 0.0; }
+};
+
 // ============================================================================
 // Enhanced User Management with Hybrid Data Structures
 // ============================================================================
@@ -45,9 +91,138 @@ private:
             recentIndex.erase(last);
         }
     }
+    
+    // Adds a loaded user to the lookup structures
+    void remember(const UserRecord& record) {
+        const std::string& email = record.profile.email;
+        emailIndex[email] = std::make_shared<UserRecord>(record);
+        sortedEmails.insert(email);
+        socialGraph.addNode(email);
+    }
+    
+    // ========================================================================
+    // Snapshot
+    // ========================================================================
+    // Layout: magic "UNIHUBUS", version, mtime and size of the users database,
+    // the profiles in email order, recent users (most recent first),
+    // connections, magic again. The database stays authoritative: a snapshot
+    // is only used while the database is unchanged since it was written, and
+    // credentials are never copied into it (login reads them from the database).
+    
+    static constexpr char kSnapshotMagic[8] = {'U', 'N', 'I', 'H', 'U', 'B', 'U', 'S'};
+    static constexpr std::uint32_t kSnapshotVersion = 2;
+    
+    static constexpr std::int64_t kNoStamp = std::numeric_limits<std::int64_t>::min();
+    
+    struct UsersDbStamp {
+        std::int64_t modified = kNoStamp;
+        std::uint64_t size = 0;
+        
+        bool operator==(const UsersDbStamp& other) const { return modified == other.modified && size == other.size; }
+        bool operator!=(const UsersDbStamp& other) const { return !(*this == other); }
+    };
+    
+    static UsersDbStamp usersDbStamp() {
+        std::error_code ec;
+        auto modified = std::filesystem::last_write_time(usersDbPath(), ec);
+        if (ec) return UsersDbStamp();
+        auto size = std::filesystem::file_size(usersDbPath(), ec);
+        if (ec) return UsersDbStamp();
+        return {static_cast<std::int64_t>(modified.time_since_epoch().count()), static_cast<std::uint64_t>(size)};
+    }
+    
+    // Loads everything or nothing
+    bool loadSnapshot(const std::string& path, bool ignoreUsersDb = false) {
+        auto mapping = MappedFile::open(path);
+        if (!mapping) return false;
+        BinaryReader in(mapping->data(), mapping->size());
+        
+        const char* magic = in.take(sizeof(kSnapshotMagic));
+        if (!magic || std::memcmp(magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) return false;
+        if (in.get<std::uint32_t>() != kSnapshotVersion) return false;
+        UsersDbStamp stamp;
+        stamp.modified = in.get<std::int64_t>();
+        stamp.size = in.get<std::uint64_t>();
+        if (!in.ok() || (!ignoreUsersDb && (stamp.modified == kNoStamp || stamp != usersDbStamp()))) return false;
+        
+        // Counts are capped by the bytes left, so a corrupt one cannot allocate much
+        std::vector<UserRecord> records(
+            static_cast<std::size_t>(std::min<std::uint64_t>(in.get<std::uint64_t>(), in.remaining())));
+        for (auto& record : records) {
+            Profile& profile = record.profile;
+            profile.firstName = in.getString();
+            profile.lastName = in.getString();
+            profile.email = in.getString();
+            profile.year = in.get<std::int32_t>();
+            profile.semester = in.get<std::int32_t>();
+            profile.branch = in.getString();
+            profile.section = in.get<char>();
+        }
+        auto recent = in.getStrings();
+        std::vector<std::pair<std::string, std::string>> connections(
+            static_cast<std::size_t>(std::min<std::uint64_t>(in.get<std::uint64_t>(), in.remaining())));
+        for (auto& connection : connections) {
+            connection.first = in.getString();
+            connection.second = in.getString();
+        }
+        const char* trailer = in.take(sizeof(kSnapshotMagic));
+        if (!in.ok() || !trailer || std::memcmp(trailer, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) return false;
+        
+        *this = UserManager();
+        emailIndex.reserve(records.size());
+        sortedEmails.reserve(records.size());
+        socialGraph.reserve(records.size());
+        for (const auto& record : records) remember(record);
+        for (auto it = recent.rbegin(); it != recent.rend(); ++it) {
+            if (emailIndex.count(*it)) updateRecentAccess(*it);
+        }
+        for (const auto& [first, second] : connections) socialGraph.addEdge(first, second);
+        return true;
+    }
+
+    // Parses "firstName,lastName,email,year,semester,branch,section,password"
+    // (the password is the rest of the line); returns why the row is invalid
+    static std::optional<std::string> parseStudentRow(const std::string& line, Profile& profile, std::string& password) {
+        std::vector<std::string> fields;
+        std::size_t start = 0;
+        while (fields.size() < 7) {
+            std::size_t comma = line.find(',', start);
+            if (comma == std::string::npos) return "expected 8 fields, got " + std::to_string(fields.size() + 1);
+            fields.push_back(line.substr(start, comma - start));
+            start = comma + 1;
+        }
+        password = line.substr(start);
+        
+        auto number = [](const std::string& field, int low, int high) -> std::optional<int> {
+            int value = 0;
+            auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value);
+            if (error != std::errc() || end != field.data() + field.size() || value < low || value > high) return std::nullopt;
+            return value;
+        };
+        profile.firstName = fields[0];
+        profile.lastName = fields[1];
+        profile.email = fields[2];
+        if (profile.email.find('@') == std::string::npos) return "invalid email \"" + profile.email + "\"";
+        auto year = number(fields[3], 1, 5);
+        if (!year) return "year must be 1-5";
+        auto semester = number(fields[4], 1, 10);
+        if (!semester) return "semester must be 1-10";
+        profile.year = *year;
+        profile.semester = *semester;
+        auto branch = normalizeBranch(fields[5]);
+        if (!branch) return "unknown branch \"" + fields[5] + "\"";
+        profile.branch = *branch;
+        const std::string& section = fields[6];
+        if (section.size() != 1 || (std::toupper(section[0]) != 'A' && std::toupper(section[0]) != 'B')) {
+            return std::string("section must be A or B");
+        }
+        profile.section = static_cast<char>(std::toupper(section[0]));
+        if (password.empty()) return std::string("empty password");
+        return std::nullopt;
+    }
 
 public:
-    UserManager() : sortedEmails([](const std::string& a, const std::string& b) { return a < b; }) {}
+    UserManager() = default;
     
     // Register new user
     std::optional<std::string> registerUser(const Profile& profile, const std::string& password) {
@@ -105,6 +280,33 @@ public:
         return sortedEmails.getSorted();
     }
     
+    std::size_t countUsers() const { return sortedEmails.size(); }
+    
+    // Up to limit emails in sorted order, starting at position first
+    std::vector<std::string> getUsersPage(std::size_t first, std::size_t limit) const {
+        std::vector<std::string> page;
+        if (first >= sortedEmails.size()) return page;
+        page.reserve(std::min(limit, sortedEmails.size() - first));
+        sortedEmails.forEachFrom(first, [&page, limit](const std::string& email) {
+            if (page.size() == limit) return false;
+            page.push_back(email);
+            return true;
+        });
+        return page;
+    }
+    
+    // Positions [first, last) of the emails starting with prefix; first is
+    // also where prefix would sort when nothing matches
+    std::pair<std::size_t, std::size_t> prefixRange(const std::string& prefix) const {
+        std::size_t first = sortedEmails.rank(prefix);
+        // Every match sorts before the prefix with its last byte below 0xff incremented
+        std::string end = prefix;
+        while (!end.empty() && static_cast<unsigned char>(end.back()) == 0xff) end.pop_back();
+        if (end.empty()) return {first, sortedEmails.size()};
+        end.back() = static_cast<char>(static_cast<unsigned char>(end.back()) + 1);
+        return {first, sortedEmails.rank(end)};
+    }
+    
     // Get recently active users
     std::vector<std::string> getRecentUsers() {
         return std::vector<std::string>(recentUsers.begin(), recentUsers.end());
@@ -134,18 +336,125 @@ public:
         return std::nullopt;
     }
     
+    // Writes every known user, the recent list and the connections atomically
+    bool saveSnapshot(const std::string& path) {
+        BinaryWriter out;
+        out.putBytes(kSnapshotMagic, sizeof(kSnapshotMagic));
+        out.put<std::uint32_t>(kSnapshotVersion);
+        UsersDbStamp stamp = usersDbStamp();
+        out.put<std::int64_t>(stamp.modified);
+        out.put<std::uint64_t>(stamp.size);
+        
+        auto emails = sortedEmails.getSorted();
+        out.put<std::uint64_t>(emails.size());
+        for (const auto& email : emails) {
+            const Profile& profile = emailIndex.at(email)->profile;
+            out.putString(profile.firstName);
+            out.putString(profile.lastName);
+            out.putString(profile.email);
+            out.put<std::int32_t>(profile.year);
+            out.put<std::int32_t>(profile.semester);
+            out.putString(profile.branch);
+            out.put<char>(profile.section);
+        }
+        out.putStrings(getRecentUsers());
+        auto edges = socialGraph.getEdges();
+        out.put<std::uint64_t>(edges.size());
+        for (const auto& edge : edges) {
+            out.putString(edge.from);
+            out.putString(edge.to);
+        }
+        out.putBytes(kSnapshotMagic, sizeof(kSnapshotMagic));
+        
+        std::error_code ec;
+        std::filesystem::create_directories(std::filesystem::path(path).parent_path(), ec);
+        return replaceFile(path, out.data().data(), out.size());
+    }
+    
+    // Loads the snapshot if the users database is unchanged since it was
+    // written. Otherwise every user is read from the database (recent users
+    // and connections of the old snapshot are kept) and a new snapshot is
+    // written. Returns whether the snapshot was current.
+    bool openPersistent(const std::string& path) {
+        if (loadSnapshot(path)) return true;
+        
+        UserManager previous;
+        previous.loadSnapshot(path, true);
+        *this = UserManager();
+        auto records = loadAllUsers();
+        emailIndex.reserve(records.size());
+        sortedEmails.reserve(records.size());
+        socialGraph.reserve(records.size());
+        for (const auto& record : records) remember(record);
+        auto recent = previous.getRecentUsers();
+        for (auto it = recent.rbegin(); it != recent.rend(); ++it) {
+            if (emailIndex.count(*it)) updateRecentAccess(*it);
+        }
+        for (const auto& edge : previous.socialGraph.getEdges()) {
+            if (emailIndex.count(edge.from) && emailIndex.count(edge.to)) socialGraph.addEdge(edge.from, edge.to);
+        }
+        saveSnapshot(path);
+        return false;
+    }
+    
     // Search users by email prefix
     std::vector<std::string> searchUsersByPrefix(const std::string& prefix) {
-        std::vector<std::string> results;
-        auto sorted = getSortedUsers();
+        auto range = prefixRange(prefix);
+        return getUsersPage(range.first, range.second - range.first);
+    }
+    
+    // Registers every student of a CSV file (rows as in parseStudentRow, an
+    // optional header row) with one batched commit, and adds them to the
+    // lookup structures from the records written, without reading them back.
+    // Rows that fail a check are skipped and reported by line.
+    UserImportStats importUsers(const std::string& csvPath, std::size_t threads = 0) {
+        UserImportStats stats;
+        auto started = std::chrono::steady_clock::now();
+        auto content = readTextFile(csvPath);
+        if (!content) {
+            stats.errors.push_back("cannot read " + csvPath);
+            return stats;
+        }
         
-        for (const auto& email : sorted) {
-            if (email.substr(0, prefix.length()) == prefix) {
-                results.push_back(email);
+        std::vector<std::pair<Profile, std::string>> students;
+        std::vector<std::size_t> lineNumbers;
+        std::size_t lineNumber = 0;
+        for (std::size_t pos = 0; pos < content->size();) {
+            std::size_t end = std::min(content->find('\n', pos), content->size());
+            std::string line = content->substr(pos, end - pos);
+            pos = end + 1;
+            ++lineNumber;
+            if (!line.empty() && line.back() == '\r') line.pop_back();
+            if (line.empty()) continue;
+            if (lineNumber == 1 && line.rfind("firstName,", 0) == 0) continue; // Header row
+            
+            ++stats.rows;
+            Profile profile;
+            std::string password;
+            if (auto error = parseStudentRow(line, profile, password)) {
+                stats.errors.push_back("line " + std::to_string(lineNumber) + ": " + *error);
+                continue;
             }
+            students.emplace_back(std::move(profile), std::move(password));
+            lineNumbers.push_back(lineNumber);
         }
+        auto parsed = std::chrono::steady_clock::now();
+        stats.parseSeconds = std::chrono::duration<double>(parsed - started).count();
         
-        return results;
+        auto results = registerUsers(students, threads, &stats.threads);
+        emailIndex.reserve(emailIndex.size() + students.size());
+        sortedEmails.reserve(sortedEmails.size() + students.size());
+        socialGraph.reserve(emailIndex.size() + students.size());
+        for (std::size_t i = 0; i < results.size(); ++i) {
+            if (results[i].record) {
+                remember(*results[i].record);
+                ++stats.imported;
+            } else {
+                stats.errors.push_back("line " + std::to_string(lineNumbers[i]) + ": " + results[i].error);
+            }
+        }
+        stats.registerSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - parsed).count();
+        return stats;
     }
 };
 
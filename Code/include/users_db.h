@@ -0,0 +1,144 @@
+#pragma once
+#include "auth.h"
+#include <string>
+#include <vector>
+#include <optional>
+#include <cstdint>
+#include <cstddef>
+
+namespace uni {
+
+// ============================================================================
+// Users Database (single file, extendible hashing)
+// ============================================================================
+// Every user is a fixed 256-byte record in one file of 4 KiB pages:
+//
+//   page 0      header: magic "UNIHUBDB", version, global depth, directory page
+//   directory   2^depth bucket page numbers, indexed by the low bits of the
+//               email's hash, on consecutive pages
+//   buckets     CRC32C, count, local depth and hash pattern, then up to
+//               kRecordsPerPage records
+//
+// The directory is held in memory and the file is mapped, so find() reads one
+// bucket page. A full bucket splits on its next hash bit into a page appended
+// to the file, doubling the directory (as a new copy) when the bucket was
+// already as deep as it. A split is written in an order that keeps every
+// record reachable after a crash: the new bucket (holding copies of the moved
+// records), then the directory, then the old bucket without them. Until that
+// last write the old bucket still holds the copies; a record only counts in
+// the bucket its hash leads to, and stale copies are dropped when the bucket
+// next fills up.
+//
+// Each bucket names its own depth and pattern, so a directory that a power
+// cut left half-written (detected at open) is rebuilt from the buckets it
+// names: the deepest bucket for a hash wins. Pages the directory on disk does
+// not reach (old directory copies, a split cut short) are free: new buckets
+// reuse them, and open() cuts free pages off the end of the file.
+//
+// A batch (beginBatch() .. commitBatch()) is all or nothing. It never writes
+// a page the directory on disk reaches: a bucket it changes is copied to a
+// free page, and the directory stays in memory. The commit flushes the new
+// pages, writes the directory as a new copy and switches the header to it;
+// only then are the replaced pages free. A crash before the header switch
+// leaves the database as it was before the batch.
+
+class UsersDb {
+public:
+    static constexpr std::size_t kPageSize = 4096;
+    static constexpr std::size_t kRecordSize = 256;
+    static constexpr std::size_t kRecordsPerPage = 15;
+
+    // Longest accepted field values in bytes
+    static constexpr std::size_t kMaxEmail = 96;
+    static constexpr std::size_t kMaxName = 40;
+    static constexpr std::size_t kMaxBranch = 24;
+    static constexpr std::size_t kMaxSalt = 24;
+
+    explicit UsersDb(std::string dbPath) : path(std::move(dbPath)) {}
+    ~UsersDb();
+
+    UsersDb(const UsersDb&) = delete;
+    UsersDb& operator=(const UsersDb&) = delete;
+
+    // Opens (or creates) the database. Returns false if the file cannot be
+    // used. A write error that may leave memory and file apart closes the
+    // database; calling open() again carries on from what the file holds.
+    bool open();
+    bool isOpen() const { return fd >= 0; }
+
+    std::optional<UserRecord> find(const std::string& email) const;
+
+    // Adds a user; returns an error message on failure (an existing email,
+    // a field that does not fit its record, a write error)
+    std::optional<std::string> insert(const UserRecord& record);
+
+    // Replaces the profile of an existing user (the email names the user)
+    std::optional<std::string> updateProfile(const Profile& profile);
+
+    // Every user, in no particular order
+    std::vector<UserRecord> loadAll() const;
+
+    // Each change is on disk when it returns; with false, changes are only
+    // flushed by sync() (for bulk loads)
+    void setSyncEachWrite(bool enabled) { syncEachWrite = enabled; }
+    bool sync();
+
+    // Changes from beginBatch() on become durable together, with the three
+    // flushes of commitBatch(); lookups see them at once. Returns false (and
+    // closes the database, keeping the file as before the batch) on a write
+    // error, also one during the batch.
+    void beginBatch();
+    bool commitBatch();
+
+    // Writes the records into a new database at path, replacing any file
+    // there only once all of them are on disk. Records that do not fit (or
+    // repeat an email) are left out and listed in skipped, as "email: reason".
+    // Returns false, leaving path untouched, on a write error.
+    static bool create(const std::string& path, const std::vector<UserRecord>& records,
+                       std::vector<std::string>* skipped = nullptr);
+
+private:
+    struct Location {
+        std::uint32_t page;
+        std::uint32_t slot;
+    };
+
+    std::string path;
+    int fd = -1;
+    const char* mapped = nullptr;
+    std::size_t mappedBytes = 0;
+    std::uint32_t pageCount = 0;
+    std::uint32_t globalDepth = 0;
+    std::uint32_t directoryPage = 0;          // First page of the directory in use
+    std::vector<std::uint32_t> directory;     // Bucket page per hash value (low globalDepth bits)
+    std::vector<std::uint8_t> localDepth;     // Per page; meaningful for buckets the directory reaches
+    bool syncEachWrite = true;
+    std::uint32_t directorySpan = 0;          // Pages of the directory on disk
+    std::vector<std::uint32_t> freePages;     // Pages the directory on disk does not reach
+    bool batching = false;
+    std::vector<bool> reachable;              // In a batch: pages the directory on disk reaches
+    std::vector<std::uint32_t> replaced;      // In a batch: buckets copied, free after the commit
+
+    const char* page(std::uint32_t number) const { return mapped + std::size_t(number) * kPageSize; }
+    std::uint32_t bucketOf(std::uint64_t hash) const {
+        return directory[hash & ((std::uint64_t(1) << globalDepth) - 1)];
+    }
+
+    void closeFile();
+    bool initialize();
+    bool mapPages(std::uint32_t pages);
+    bool loadDirectory();
+    void collectFreePages();
+    std::uint32_t allocatePage();
+    bool directoryConsistent();
+    bool rebuildDirectory();
+    bool appendDirectory();
+    bool writeDirectoryPages(std::uint32_t pattern, std::uint32_t depth);
+    bool writePage(std::uint32_t number, const char* data);
+    std::uint32_t writableBucket(std::uint32_t bucket, std::uint32_t pattern, std::uint32_t depth);
+    bool barrier();
+    bool splitBucket(std::uint32_t bucket, std::uint64_t hash);
+    std::optional<Location> locate(const std::string& email, std::uint64_t hash) const;
+};
+
+}
@@ -4,16 +4,21 @@
     This source file implements the authentication and user profile management logic
     for the UniHub-CLI application. It provides functions for registering users,
     logging in, loading and saving profiles, and handling user credential storage.
-    The file interacts with the file system to persist user data and credentials,
-    and uses hashing and random salt generation for password security.
+    Users are kept in a single database file (see users_db.h); the per-user profile
+    and credential files of earlier versions are imported into it once, on the first
+    run that finds no database. Passwords are hashed with a random salt.
 */
 
 #include "auth.h"         // Includes the authentication and profile interface definitions
 #include "storage.h"      // Includes file and directory utility functions
+#include "users_db.h"     // Includes the single-file users database
+#include "thread_pool.h"  // Includes the worker pool for hashing credentials in bulk
 #include <filesystem>     // Provides file system operations (e.g., checking file existence)
 #include <random>         // Provides random number generation for salt creation
 #include <sstream>        // Provides string stream utilities for parsing and formatting
 #include <unordered_map>  // Provides hash map containers (may be used elsewhere)
+#include <vector>         // Provides vector for loading all users
+#include <system_error>   // Provides error_code for non-throwing directory iteration
 
 using namespace std; // Allows usage of standard library types without std:: prefix
 
@@ -21,110 +26,212 @@ namespace fs = filesystem; // Alias for filesystem namespace
 
 namespace uni { // Begin namespace uni
 
-// Helper function to sanitize email addresses for use as filenames
-static string sanitizeEmail(const string& email) {
-    string s = email;
-    for (char& c : s) { if (c=='/'||c=='\\'||c==' ') c = '_'; } // Replace invalid filename characters with '_'
-    return s;
-}
-
-// Returns the directory path where user data is stored
+// Returns the directory of the per-user files imported into the database
 string usersDir() { return dataDir() + string("/users"); }
 
+// Returns the path of the users database
+string usersDbPath() { return dataDir() + string("/users.db"); }
+
 // Hashes the password using the provided salt
 static size_t hashPassword(const string& salt, const string& password) {
     return hash<string>{}(salt + password); // Hashes the concatenated salt and password
 }
 
-// Generates a random salt string for password hashing
-static string randSalt() {
-    mt19937_64 rng(random_device{}()); // Random number generator
+// Draws a salt string for password hashing from the given generator
+static string saltFrom(mt19937_64& rng) {
     uniform_int_distribution<unsigned long long> dist; // Distribution for random numbers
     ostringstream oss; oss << hex << dist(rng); // Convert random number to hex string
     return oss.str();
 }
 
-// Builds the file path for storing a user's profile
-static string profilePath(const string& email) {
-    return usersDir() + string("/") + sanitizeEmail(email) + ".profile";
+// Generates a random salt string for password hashing
+static string randSalt() {
+    mt19937_64 rng(random_device{}()); // Random number generator
+    return saltFrom(rng);
+}
+
+// Reads the salt and password hash from a credentials file
+// Returns false if the file is missing or malformed
+static bool readCredentials(const string& path, string& salt, size_t& storedHash) {
+    auto content = readTextFile(path); // Read credentials file
+    if (!content) return false; // Fail if file not found
+    istringstream iss(*content); // Parse credentials
+    string hashStr;
+    if (!getline(iss, salt)) return false; // Read salt
+    if (!getline(iss, hashStr)) return false; // Read hash
+    try { storedHash = stoull(hashStr); } catch (...) { return false; } // Convert hash to integer
+    return true;
+}
+
+// Reads a profile file
+// Returns the Profile on success, or std::nullopt if missing or malformed
+static optional<Profile> readProfile(const string& path) {
+    auto content = readTextFile(path); // Read profile file
+    if (!content) return nullopt; // Fail if file not found
+    Profile pr;
+    istringstream iss(*content); // Parse CSV-like profile string
+    string tok;
+    if (!getline(iss, pr.firstName, ',')) return nullopt;
+    if (!getline(iss, pr.lastName, ',')) return nullopt;
+    if (!getline(iss, pr.email, ',')) return nullopt;
+    if (!getline(iss, tok, ',')) return nullopt;
+    try { pr.year = stoi(tok); } catch (...) { return nullopt; } // Parse year
+    if (!getline(iss, tok, ',')) return nullopt;
+    try { pr.semester = stoi(tok); } catch (...) { return nullopt; } // Parse semester
+    if (!getline(iss, pr.branch, ',')) return nullopt;
+    if (!getline(iss, tok, ',')) return nullopt;
+    pr.section = tok.empty()? 'A' : tok[0];
+    return pr;
+}
+
+// Loads every user with both a credentials and a profile file in the former layout
+// Users whose files are missing or malformed are listed in skipped, as "file: reason"
+static vector<UserRecord> loadUserFiles(vector<string>& skipped) {
+    vector<UserRecord> users; // Loaded records
+    error_code ec;
+    for (fs::directory_iterator it(usersDir(), ec), end; !ec && it != end; it.increment(ec)) { // Each file in the users directory
+        if (it->path().extension() != ".cred") continue; // Start from the credentials files
+        UserRecord record;
+        if (!readCredentials(it->path().string(), record.salt, record.passwordHash)) { // Unreadable credentials
+            skipped.push_back(it->path().string() + ": unreadable or malformed credentials");
+            continue;
+        }
+        fs::path profileFile = it->path(); // The profile sits beside the credentials
+        auto profile = readProfile(profileFile.replace_extension(".profile").string()); // Read it
+        if (!profile) { // No usable profile
+            skipped.push_back(profileFile.string() + ": missing, unreadable or malformed profile");
+            continue;
+        }
+        record.profile = *profile; // Complete the record
+        users.push_back(move(record)); // Keep it
+    }
+    return users; // Return all loaded users
+}
+
+static string openError;            // Why the database is not open, for openUsersDatabase
+static vector<string> importSkipped; // Users the import left out, until openUsersDatabase reports them
+
+// Imports the per-user files into a new database
+// Returns an error message if the database could not be written (nothing is created then)
+static optional<string> importUserFiles() {
+    vector<string> skipped; // Users that cannot be imported
+    auto users = loadUserFiles(skipped); // Read the former layout
+    vector<string> rejected; // Users the database cannot hold
+    if (!UsersDb::create(usersDbPath(), users, &rejected)) { // Write them all, or nothing
+        return optional<string>("Failed to import the users of " + usersDir() + " into " + usersDbPath() +
+                                "; the import is retried on the next use");
+    }
+    skipped.insert(skipped.end(), rejected.begin(), rejected.end()); // Report both kinds
+    importSkipped.insert(importSkipped.end(), skipped.begin(), skipped.end());
+    return nullopt; // Imported
+}
+
+// Returns the users database, opened on first use and again after a write error closed it
+// A run without a database imports the per-user files (left in place) into a new one first;
+// the database is only opened (or created empty) once that import succeeded
+static UsersDb& database() {
+    static UsersDb db(usersDbPath()); // The one database of the process
+    if (db.isOpen()) return db; // Already usable
+    openError.clear();
+    error_code ec;
+    if (!fs::exists(usersDbPath(), ec) && fs::is_directory(usersDir(), ec)) { // Files of an earlier version
+        auto error = importUserFiles(); // Import them in one go
+        if (error) { // Opening now would create an empty database and end the import for good
+            openError = *error;
+            return db; // Every use fails until an import succeeds
+        }
+    }
+    if (!db.open()) openError = "Failed to open: " + usersDbPath(); // Open (or create) the database
+    return db;
 }
 
-// Builds the file path for storing a user's credentials
-static string credentialsPath(const string& email) {
-    return usersDir() + string("/") + sanitizeEmail(email) + ".cred";
+optional<string> openUsersDatabase(vector<string>* skipped) {
+    bool open = database().isOpen(); // Opens, importing first if needed
+    if (skipped) skipped->insert(skipped->end(), importSkipped.begin(), importSkipped.end()); // Hand over the report
+    importSkipped.clear(); // Reported once
+    if (open) return nullopt;
+    return optional<string>(openError);
 }
 
 // Registers a new user with the given profile and password
 // Returns an error message on failure, or std::nullopt on success
 optional<string> registerUser(const Profile& profile, const string& password) {
-    ensureDir(usersDir()); // Ensure the users directory exists
-    auto credP = credentialsPath(profile.email); // Get credentials file path
-    if (filesystem::exists(credP)) { // Check if user already exists
-        return optional<string>("User already exists");
+    UserRecord record{profile, randSalt(), 0}; // Generate random salt
+    record.passwordHash = hashPassword(record.salt, password); // Hash the password with salt
+    return database().insert(record); // Fails if the user already exists
+}
+
+// Registers many users with one durable commit
+// Returns one Registration per (profile, password) pair, in the same order
+vector<Registration> registerUsers(const vector<pair<Profile, string>>& users, size_t threads, size_t* workers) {
+    vector<UserRecord> records(users.size()); // Records with their credentials
+    auto hashRange = [&users, &records](size_t begin, size_t end) {
+        mt19937_64 rng(random_device{}()); // One seeded generator per range, not per user
+        for (size_t i = begin; i < end; ++i) {
+            records[i].profile = users[i].first; // Copy the profile
+            records[i].salt = saltFrom(rng); // Draw the salt
+            records[i].passwordHash = hashPassword(records[i].salt, users[i].second); // Hash the password with it
+        }
+    };
+    const size_t kRangeSize = 256; // Users per hashing task
+    if (users.size() <= kRangeSize) {
+        hashRange(0, users.size()); // Too few to be worth the threads
+        if (workers) *workers = 1; // Hashed on the calling thread
+    } else {
+        ThreadPool pool(threads); // Workers for the hashing
+        if (workers) *workers = pool.size(); // The threads actually started
+        vector<future<void>> ranges; // One task per range
+        for (size_t begin = 0; begin < users.size(); begin += kRangeSize) {
+            size_t end = min(users.size(), begin + kRangeSize); // End of this range
+            ranges.push_back(pool.submit([&hashRange, begin, end] { hashRange(begin, end); }));
+        }
+        for (auto& range : ranges) range.get(); // Wait for every range
     }
-    string salt = randSalt(); // Generate random salt
-    size_t h = hashPassword(salt, password); // Hash the password with salt
-    // Store credentials: salt and hash, separated by newline
-    {
-        ostringstream oss; oss << salt << "\n" << h;
-        if (auto err = writeTextFile(credP, oss.str())) return err; // Write credentials to file
+
+    vector<Registration> results(users.size()); // Outcome per user
+    UsersDb& db = database(); // The database to write to
+    db.beginBatch(); // Nothing is durable until the commit
+    for (size_t i = 0; i < records.size(); ++i) {
+        auto error = db.insert(records[i]); // Fails on an existing email or a field that does not fit
+        if (error) results[i].error = *error; // Keep the reason
+        else results[i].record = move(records[i]); // Keep the stored record
     }
-    // Store profile as a simple CSV-like string
-    {
-        ostringstream oss;
-        oss << profile.firstName << "," << profile.lastName << "," << profile.email << "," 
-            << profile.year << "," << profile.semester << "," << profile.branch << "," << profile.section;
-        if (auto err = writeTextFile(profilePath(profile.email), oss.str())) return err; // Write profile to file
+    if (!db.commitBatch()) { // One flush for the whole batch
+        for (auto& result : results) {
+            if (!result.record) continue; // Already failed
+            result.record.reset(); // Not stored after all
+            result.error = "Failed to write: " + usersDbPath(); // Report the write failure
+        }
     }
-    return nullopt; // Success
+    return results; // Every user's outcome
 }
 
 // Attempts to log in a user with the given email and password
 // Returns the loaded UserRecord on success, or std::nullopt on failure
 optional<UserRecord> login(const string& email, const string& password) {
-    auto credP = credentialsPath(email); // Get credentials file path
-    auto content = readTextFile(credP); // Read credentials file
-    if (!content) return nullopt; // Fail if file not found
-    istringstream iss(*content); // Parse credentials
-    string salt; string hashStr;
-    if (!getline(iss, salt)) return nullopt; // Read salt
-    if (!getline(iss, hashStr)) return nullopt; // Read hash
-    size_t storedHash = 0;
-    try { storedHash = stoull(hashStr); } catch (...) { return nullopt; } // Convert hash to integer
-    if (hashPassword(salt, password) != storedHash) return nullopt; // Check password
-    auto p = loadProfile(email); // Load user profile
-    if (!p) return nullopt; // Fail if profile not found
-    return UserRecord{*p, salt, storedHash}; // Return user record
+    auto record = database().find(email); // One bucket page of the database
+    if (!record) return nullopt; // Fail if the user is unknown
+    if (hashPassword(record->salt, password) != record->passwordHash) return nullopt; // Check password
+    return record; // Return user record
 }
 
 // Loads a user's profile by their email address
 // Returns the Profile on success, or std::nullopt if not found
 optional<Profile> loadProfile(const string& email) {
-    auto path = profilePath(email); // Get profile file path
-    auto content = readTextFile(path); // Read profile file
-    if (!content) return nullopt; // Fail if file not found
-    Profile pr;
-    istringstream iss(*content); // Parse CSV-like profile string
-    string tok;
-    if (!getline(iss, pr.firstName, ',')) return nullopt;
-    if (!getline(iss, pr.lastName, ',')) return nullopt;
-    if (!getline(iss, pr.email, ',')) return nullopt;
-    if (!getline(iss, tok, ',')) return nullopt;
-    pr.year = stoi(tok);
-    if (!getline(iss, tok, ',')) return nullopt;
-    pr.semester = stoi(tok);
-    if (!getline(iss, pr.branch, ',')) return nullopt;
-    if (!getline(iss, tok, ',')) return nullopt;
-    pr.section = tok.empty()? 'A' : tok[0];
-    return pr;
+    auto record = database().find(email); // Look the user up
+    if (!record) return nullopt; // Not found
+    return record->profile; // Return the profile
+}
+
+// Loads every user in the database
+vector<UserRecord> loadAllUsers() {
+    return database().loadAll(); // Reads each bucket page once
 }
 
 // Saves the given profile information
 // Returns an error message on failure, or std::nullopt on success
 optional<string> saveProfile(const Profile& profile) {
-    return writeTextFile(profilePath(profile.email),
-        profile.firstName + "," + profile.lastName + "," + profile.email + "," +
-        to_string(profile.year) + "," + to_string(profile.semester) + "," + profile.branch + "," + profile.section);
+    return database().updateProfile(profile); // Rewrites the user's record in place
 }
 
 } // End namespace uni
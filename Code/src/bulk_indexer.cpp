@@ -0,0 +1,160 @@
+#include "resource_index.h"
+#include "thread_pool.h"
+#include <filesystem>
+#include <system_error>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <algorithm>
+#include <exception>
+
+namespace fs = std::filesystem;
+
+namespace uni {
+
+// ============================================================================
+// Parallel Bulk Indexer
+// ============================================================================
+// Every directory of the resource tree becomes a task on a thread pool. A task
+// lists its directory, queues its subdirectories as new tasks and describes and
+// tokenizes its files into the partial belonging to the worker running it, so
+// workers never share mutable state. Once the walk drains, the partials are
+// sorted by filename (ids stay stable from one rebuild to the next) and merged
+// into the index on the calling thread.
+
+namespace {
+
+// Files live at <year>/<sem>/<branch>/<section>/<subject>/<type>/<name>
+constexpr int kFileDepth = 6;
+
+struct IndexedFile {
+    ResourceMetadata metadata;
+    AnalyzedDocument analyzed;
+};
+
+struct WorkerPartial {
+    std::vector<IndexedFile> files;
+    std::vector<std::pair<std::string, std::int64_t>> directories;
+};
+
+class TreeWalk {
+private:
+    ThreadPool& pool;
+    const std::string& root;
+    const ResourceIndex* previous;
+    std::vector<WorkerPartial> partials;
+
+    std::mutex mutex;
+    std::condition_variable drained;
+    std::size_t pending = 0;
+    std::exception_ptr error;        // First exception a task threw, rethrown by run()
+
+    void schedule(fs::path dir, int depth) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ++pending;
+        }
+        pool.submit([this, dir = std::move(dir), depth] {
+            // A task that throws still counts as done, or run() would wait forever
+            std::exception_ptr thrown;
+            try {
+                visit(dir, depth);
+            } catch (...) {
+                thrown = std::current_exception();
+            }
+            std::lock_guard<std::mutex> lock(mutex);
+            if (thrown && !error) error = thrown;
+            if (--pending == 0) drained.notify_all();
+        });
+    }
+
+    void visit(const fs::path& dir, int depth) {
+        auto& partial = partials[ThreadPool::currentWorker()];
+        std::error_code ec;
+        auto mtime = fs::last_write_time(dir, ec);
+        partial.directories.emplace_back(dir.string(), ec ? -1 :
+            std::chrono::duration_cast<std::chrono::nanoseconds>(mtime.time_since_epoch()).count());
+
+        for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+            // Entry types come from readdir, so only files at file depth are stat'ed
+            std::error_code typeError;
+            if (it->is_directory(typeError)) {
+                if (depth < kFileDepth) schedule(it->path(), depth + 1);
+                continue;
+            }
+            if (depth != kFileDepth || !it->is_regular_file(typeError)) continue;
+
+            auto metadata = describeStoredResource(root, it->path());
+            if (!metadata) continue;
+            if (previous) {
+                if (auto known = previous->getResource(metadata->filename)) {
+                    // Keep what the tree cannot tell us (uploader, tags, counts, subject code)
+                    known->sizeBytes = metadata->sizeBytes;
+                    metadata = std::move(known);
+                }
+            }
+
+            AnalyzedDocument analyzed = ResourceIndex::analyze(*metadata);
+            partial.files.push_back(IndexedFile{std::move(*metadata), std::move(analyzed)});
+        }
+    }
+
+public:
+    TreeWalk(ThreadPool& p, const std::string& r, const ResourceIndex* prev)
+        : pool(p), root(r), previous(prev), partials(p.size()) {}
+
+    std::vector<WorkerPartial> run() {
+        schedule(fs::path(root), 0);
+        std::unique_lock<std::mutex> lock(mutex);
+        drained.wait(lock, [this] { return pending == 0; });
+        if (error) std::rethrow_exception(error);
+        return std::move(partials);
+    }
+};
+
+}
+
+BulkIndexStats ResourceIndex::rebuildFromTree(const std::string& root, const ResourceIndex* previous,
+                                              TreeFingerprint* tree, std::size_t threads) {
+    BulkIndexStats stats;
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) return stats;
+
+    using Clock = std::chrono::steady_clock;
+    auto started = Clock::now();
+
+    std::vector<WorkerPartial> partials;
+    {
+        ThreadPool pool(threads);
+        stats.threads = pool.size();
+        partials = TreeWalk(pool, root, previous).run();
+    }
+
+    std::vector<IndexedFile*> files;
+    for (auto& partial : partials) {
+        for (auto& file : partial.files) files.push_back(&file);
+        stats.directories += partial.directories.size();
+        if (tree) {
+            tree->directories.insert(tree->directories.end(),
+                                     std::make_move_iterator(partial.directories.begin()),
+                                     std::make_move_iterator(partial.directories.end()));
+        }
+    }
+    std::sort(files.begin(), files.end(), [](const IndexedFile* a, const IndexedFile* b) {
+        return a->metadata.filename < b->metadata.filename;
+    });
+    auto scanned = Clock::now();
+
+    for (const auto* file : files) {
+        addResource(file->metadata, file->analyzed);
+    }
+    stats.files = files.size();
+
+    std::chrono::duration<double> scanTime = scanned - started;
+    std::chrono::duration<double> mergeTime = Clock::now() - scanned;
+    stats.scanSeconds = scanTime.count();
+    stats.mergeSeconds = mergeTime.count();
+    return stats;
+}
+
+}
@@ -0,0 +1,872 @@
+#include "chunk_store.h"
+#include "binary_io.h"
+#include "storage.h"
+#include "thread_pool.h"
+#include "transfer_journal.h"
+#include <filesystem>
+#include <system_error>
+#include <unordered_set>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace uni {
+
+// ============================================================================
+// SHA-256 (FIPS 180-4)
+// ============================================================================
+
+namespace {
+
+constexpr std::uint32_t kRoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+inline std::uint32_t rotr(std::uint32_t x, int n) { return (x >> n) | (x << (32 - n)); }
+
+}
+
+Sha256::Sha256()
+    : state{0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19} {}
+
+void Sha256::compress(const std::uint8_t* data) {
+    std::uint32_t w[64];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (std::uint32_t(data[4 * i]) << 24) | (std::uint32_t(data[4 * i + 1]) << 16) |
+               (std::uint32_t(data[4 * i + 2]) << 8) | std::uint32_t(data[4 * i + 3]);
+    }
+    for (int i = 16; i < 64; ++i) {
+        std::uint32_t s0 = rotr(w[i - 15], 7) ^ rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        std::uint32_t s1 = rotr(w[i - 2], 17) ^ rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    std::uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    std::uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+    for (int i = 0; i < 64; ++i) {
+        std::uint32_t t1 = h + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + ((e & f) ^ (~e & g)) +
+                           kRoundConstants[i] + w[i];
+        std::uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+    state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+    state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+}
+
+void Sha256::update(const void* data, std::size_t size) {
+    auto bytes = static_cast<const std::uint8_t*>(data);
+    totalBytes += size;
+    if (blockSize > 0) {
+        std::size_t take = std::min(size, block.size() - blockSize);
+        std::memcpy(block.data() + blockSize, bytes, take);
+        blockSize += take;
+        bytes += take;
+        size -= take;
+        if (blockSize < block.size()) return;
+        compress(block.data());
+        blockSize = 0;
+    }
+    // Whole blocks are compressed straight from the input
+    for (; size >= block.size(); bytes += block.size(), size -= block.size()) compress(bytes);
+    std::memcpy(block.data(), bytes, size);
+    blockSize = size;
+}
+
+ContentHash Sha256::finish() {
+    std::uint64_t bits = totalBytes * 8;
+    std::uint8_t padding[72] = {0x80};
+    std::size_t padSize = (blockSize < 56 ? 56 : 120) - blockSize;
+    for (int i = 0; i < 8; ++i) padding[padSize + i] = static_cast<std::uint8_t>(bits >> (56 - 8 * i));
+    update(padding, padSize + 8);
+
+    ContentHash digest;
+    for (int i = 0; i < 8; ++i) {
+        for (int j = 0; j < 4; ++j) digest[4 * i + j] = static_cast<std::uint8_t>(state[i] >> (24 - 8 * j));
+    }
+    return digest;
+}
+
+void Sha256::saveState(BinaryWriter& out) const {
+    out.put(state);
+    out.put(block);
+    out.put<std::uint64_t>(blockSize);
+    out.put<std::uint64_t>(totalBytes);
+}
+
+bool Sha256::loadState(BinaryReader& in) {
+    auto savedState = in.get<decltype(state)>();
+    auto savedBlock = in.get<decltype(block)>();
+    auto savedBlockSize = in.get<std::uint64_t>();
+    auto savedTotal = in.get<std::uint64_t>();
+    if (!in.ok() || savedBlockSize >= block.size() || savedTotal % block.size() != savedBlockSize) return false;
+    state = savedState;
+    block = savedBlock;
+    blockSize = static_cast<std::size_t>(savedBlockSize);
+    totalBytes = savedTotal;
+    return true;
+}
+
+ContentHash Sha256::of(const void* data, std::size_t size) {
+    Sha256 sha;
+    sha.update(data, size);
+    return sha.finish();
+}
+
+std::string Sha256::hex(const ContentHash& hash) {
+    static constexpr char kDigits[] = "0123456789abcdef";
+    std::string text;
+    text.reserve(hash.size() * 2);
+    for (auto byte : hash) {
+        text.push_back(kDigits[byte >> 4]);
+        text.push_back(kDigits[byte & 15]);
+    }
+    return text;
+}
+
+// ============================================================================
+// Content-Defined Chunking (Gear rolling hash, normalized cut points)
+// ============================================================================
+
+namespace {
+
+// One pseudo-random 64-bit value per byte value (SplitMix64 sequence)
+constexpr std::array<std::uint64_t, 256> makeGearTable() {
+    std::array<std::uint64_t, 256> table{};
+    std::uint64_t seed = 0x5eed5eed5eed5eedULL;
+    for (auto& entry : table) {
+        std::uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        entry = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr auto kGear = makeGearTable();
+
+// Shifting left by one per byte, bit k of the hash depends on the last k + 1
+// bytes, so cut conditions test the top bits (a 64-byte window). Before the
+// average size a cut needs 15 zero bits, after it 11, which pulls chunk sizes
+// towards the average (FastCDC's normalized chunking).
+constexpr std::uint64_t kMaskBeforeAverage = ~std::uint64_t(0) << (64 - 15);
+constexpr std::uint64_t kMaskAfterAverage = ~std::uint64_t(0) << (64 - 11);
+
+// Manifest layout: magic "UNIHUBCM", version, logical size, file hash, chunks
+constexpr char kManifestMagic[8] = {'U', 'N', 'I', 'H', 'U', 'B', 'C', 'M'};
+constexpr std::uint32_t kManifestVersion = 1;
+constexpr std::size_t kManifestHeaderSize = sizeof(kManifestMagic) + sizeof(std::uint32_t) + sizeof(std::uint64_t);
+
+std::optional<std::string> readWholeFile(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::nullopt;
+    return std::string((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+}
+
+std::optional<ContentHash> parseHex(const std::string& text) {
+    ContentHash hash;
+    if (text.size() != hash.size() * 2) return std::nullopt;
+    auto digit = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        return -1;
+    };
+    for (std::size_t i = 0; i < hash.size(); ++i) {
+        int high = digit(text[2 * i]);
+        int low = digit(text[2 * i + 1]);
+        if (high < 0 || low < 0) return std::nullopt;
+        hash[i] = static_cast<std::uint8_t>(high << 4 | low);
+    }
+    return hash;
+}
+
+// Progress is reported once per this many bytes
+constexpr std::uint64_t kProgressStep = 8ull << 20;
+
+// Sources this large are evicted from the page cache once stored, since
+// an upload reads them only once
+constexpr std::uint64_t kDropSourceBytes = 64ull << 20;
+
+// Smaller uploads store their chunks on the calling thread: starting the
+// workers would cost more than they save
+constexpr std::uint64_t kParallelStoreBytes = 256 << 10;
+
+class ProgressReporter {
+private:
+    const TransferCallback& progress;
+    std::uint64_t total;
+    const char* method;
+    std::uint64_t reported = 0;
+    std::chrono::steady_clock::time_point started = std::chrono::steady_clock::now();
+
+public:
+    ProgressReporter(const TransferCallback& callback, std::uint64_t totalBytes, const char* name)
+        : progress(callback), total(totalBytes), method(name) {}
+
+    void update(std::uint64_t done, bool last = false) {
+        if (!progress || (!last && done - reported < kProgressStep)) return;
+        reported = done;
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - started;
+        progress(TransferProgress{done, total, elapsed.count(), method});
+    }
+};
+
+struct ContentHashHasher {
+    std::size_t operator()(const ContentHash& hash) const {
+        std::size_t value;
+        std::memcpy(&value, hash.data(), sizeof(value));
+        return value;
+    }
+};
+
+// ----------------------------------------------------------------------------
+// Resumable transfers
+// ----------------------------------------------------------------------------
+
+// Upload journals nobody resumed for this long are dropped by the sweep
+constexpr auto kJournalMaxAge = std::chrono::hours(24 * 7);
+
+// A chunk named in an upload journal, with the CRC32C of its bytes
+struct JournaledChunk {
+    ContentHash hash;
+    std::uint32_t size;
+    std::uint32_t crc;
+};
+
+// One upload journal record: a step's chunks, the source offset after them
+// and the whole-file hash state at that offset
+struct UploadStep {
+    std::uint64_t end = 0;
+    std::string hashState;
+    std::vector<JournaledChunk> chunks;
+};
+
+std::string encodeStep(const UploadStep& step) {
+    BinaryWriter out;
+    out.put<std::uint64_t>(step.end);
+    out.putString(step.hashState);
+    out.putArray(step.chunks);
+    return out.data();
+}
+
+std::optional<UploadStep> decodeStep(const std::string& record) {
+    BinaryReader in(record.data(), record.size());
+    UploadStep step;
+    step.end = in.get<std::uint64_t>();
+    step.hashState = in.getString();
+    step.chunks = in.getArray<JournaledChunk>();
+    if (!in.ok() || !in.atEnd()) return std::nullopt;
+    return step;
+}
+
+std::size_t transferThreads() {
+    return std::min<std::size_t>(ChunkStore::kMaxTransferThreads, std::max(1u, std::thread::hardware_concurrency()));
+}
+
+// Runs fn on the pool, or right away on the calling thread without one
+template<typename F>
+auto runOn(ThreadPool* pool, F&& fn) -> std::future<decltype(fn())> {
+    if (pool) return pool->submit(std::forward<F>(fn));
+    std::promise<decltype(fn())> done;
+    done.set_value(fn());
+    return done.get_future();
+}
+
+// Names a transfer's source as it is now, so a journal is only resumed
+// against the same, unchanged file
+std::optional<std::string> sourceIdentity(const std::string& path) {
+    struct stat info;
+    if (::stat(path.c_str(), &info) != 0) return std::nullopt;
+    std::error_code ec;
+    BinaryWriter out;
+    out.putString(fs::absolute(path, ec).string());
+    out.put<std::uint64_t>(static_cast<std::uint64_t>(info.st_dev));
+    out.put<std::uint64_t>(static_cast<std::uint64_t>(info.st_ino));
+    out.put<std::uint64_t>(static_cast<std::uint64_t>(info.st_size));
+    out.put<std::int64_t>(static_cast<std::int64_t>(info.st_mtim.tv_sec));
+    out.put<std::int64_t>(static_cast<std::int64_t>(info.st_mtim.tv_nsec));
+    return out.data();
+}
+
+class Descriptor {
+public:
+    int fd;
+    explicit Descriptor(int value) : fd(value) {}
+    ~Descriptor() { if (fd >= 0) ::close(fd); }
+    Descriptor(const Descriptor&) = delete;
+    Descriptor& operator=(const Descriptor&) = delete;
+};
+
+bool readAt(int fd, char* data, std::size_t size, std::uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        offset += static_cast<std::uint64_t>(n);
+    }
+    return true;
+}
+
+bool writeAt(int fd, const char* data, std::size_t size, std::uint64_t offset) {
+    while (size > 0) {
+        ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+        offset += static_cast<std::uint64_t>(n);
+    }
+    return true;
+}
+
+}
+
+std::vector<std::size_t> ChunkStore::cutPoints(const char* data, std::size_t size) {
+    std::vector<std::size_t> lengths;
+    auto bytes = reinterpret_cast<const unsigned char*>(data);
+    std::size_t start = 0;
+    while (start < size) {
+        std::size_t remaining = size - start;
+        std::size_t length = remaining;
+        if (remaining > kMinChunk) {
+            std::size_t average = std::min(kAverageChunk, remaining);
+            std::size_t limit = std::min(kMaxChunk, remaining);
+            std::uint64_t fingerprint = 0;
+            std::size_t i = kMinChunk;
+            bool cut = false;
+            for (; i < average && !cut; ++i) {
+                fingerprint = (fingerprint << 1) + kGear[bytes[start + i]];
+                cut = (fingerprint & kMaskBeforeAverage) == 0;
+            }
+            for (; i < limit && !cut; ++i) {
+                fingerprint = (fingerprint << 1) + kGear[bytes[start + i]];
+                cut = (fingerprint & kMaskAfterAverage) == 0;
+            }
+            length = i;
+        }
+        lengths.push_back(length);
+        start += length;
+    }
+    return lengths;
+}
+
+// ============================================================================
+// Chunk Store
+// ============================================================================
+
+std::string ChunkStore::chunkPath(const ContentHash& hash) const {
+    std::string name = Sha256::hex(hash);
+    return root + "/" + name.substr(0, 2) + "/" + name;
+}
+
+std::string ChunkStore::fileIndexPath(const ContentHash& hash) const {
+    return root + "/files/" + Sha256::hex(hash);
+}
+
+std::string ChunkStore::sweepMarkerPath() const {
+    return root + "/.sweep";
+}
+
+std::string ChunkStore::journalPath(const std::string& dst) const {
+    return root + "/journals/" + Sha256::hex(Sha256::of(dst.data(), dst.size())) + ".journal";
+}
+
+std::optional<std::string> ChunkStore::store(const std::string& src, const std::string& dst,
+                                             ChunkStoreStats* stats, const TransferCallback& progress) {
+    std::error_code ec;
+    auto sourceSize = fs::file_size(src, ec);
+    if (ec) return "Cannot read " + src;
+    // Empty files cannot be mapped; they become manifests without chunks
+    auto mapping = sourceSize > 0 ? MappedFile::open(src) : nullptr;
+    if (sourceSize > 0 && !mapping) return "Cannot read " + src;
+    const char* data = mapping ? mapping->data() : "";
+    std::size_t size = mapping ? mapping->size() : 0;
+
+    auto lengths = cutPoints(data, size);
+    std::vector<std::size_t> starts(lengths.size());
+    for (std::size_t i = 1; i < lengths.size(); ++i) starts[i] = starts[i - 1] + lengths[i - 1];
+
+    ChunkStoreStats local;
+    ChunkManifest manifest;
+    manifest.size = size;
+    Sha256 whole;
+    ProgressReporter reporter(progress, size, "dedup");
+    std::size_t next = 0;    // First chunk not stored yet
+    std::size_t offset = 0;  // Where it starts
+
+    // Large uploads carry on after the steps an interrupted run journaled,
+    // as far as their chunks are still in the store with the recorded bytes
+    TransferJournal journal(journalPath(dst));
+    std::vector<std::string> records;
+    bool journaled = false;
+    if (size >= kResumableBytes) {
+        auto identity = sourceIdentity(src);
+        fs::create_directories(root + "/journals", ec);
+        journaled = identity && journal.open("store\n" + dst + "\n" + *identity, records);
+    }
+    std::optional<ThreadPool> workers;
+    if (size >= kParallelStoreBytes) workers.emplace(transferThreads());
+    ThreadPool* pool = workers ? &*workers : nullptr;
+    std::size_t sliceCount = pool ? pool->size() : 1;
+    if (!records.empty()) {
+        std::vector<std::optional<UploadStep>> steps;
+        for (const auto& record : records) steps.push_back(decodeStep(record));
+        std::vector<std::future<bool>> checks;
+        for (const auto& step : steps) {
+            // A damaged chunk is removed, or storing the step again would
+            // find it present and keep it
+            checks.push_back(runOn(pool, [this, &step] {
+                if (!step) return false;
+                bool intact = true;
+                for (const auto& chunk : step->chunks) {
+                    std::string path = chunkPath(chunk.hash);
+                    auto bytes = readWholeFile(path);
+                    if (!bytes) {
+                        intact = false;
+                    } else if (bytes->size() != chunk.size || crc32c(bytes->data(), bytes->size()) != chunk.crc) {
+                        std::error_code removeError;
+                        fs::remove(path, removeError);
+                        intact = false;
+                    }
+                }
+                return intact;
+            }));
+        }
+        bool intact = true;
+        std::size_t applied = 0;
+        for (std::size_t i = 0; i < steps.size(); ++i) {
+            intact = checks[i].get() && intact;
+            if (!intact) continue;
+            const auto& step = *steps[i];
+            Sha256 resumed = whole;
+            BinaryReader state(step.hashState.data(), step.hashState.size());
+            intact = resumed.loadState(state) && next + step.chunks.size() <= lengths.size();
+            for (std::size_t c = 0; intact && c < step.chunks.size(); ++c) {
+                intact = step.chunks[c].size == lengths[next + c];
+            }
+            if (!intact) continue;
+            whole = resumed;
+            for (const auto& chunk : step.chunks) manifest.chunks.push_back(ChunkRef{chunk.hash, chunk.size});
+            next += step.chunks.size();
+            offset = next < lengths.size() ? starts[next] : size;
+            intact = step.end == offset;
+            ++applied;
+        }
+        // Steps after the first bad one are redone, so their records go
+        if (applied < records.size()) journal.truncate(applied);
+        local.resumedBytes = offset;
+        reporter.update(offset);
+    }
+
+    // Each step of about kTransferBlock bytes is split among the workers,
+    // which hash and write its chunks while this thread extends the
+    // whole-file hash over the same bytes
+    std::atomic<std::size_t> newChunks{0};
+    std::atomic<std::uint64_t> newBytes{0};
+    while (next < lengths.size()) {
+        std::size_t last = next;
+        std::size_t end = offset;
+        while (last < lengths.size() && end - offset < kTransferBlock) end += lengths[last++];
+
+        UploadStep step;
+        step.chunks.resize(last - next);
+        std::vector<std::future<std::optional<std::string>>> slices;
+        std::size_t count = step.chunks.size();
+        for (std::size_t w = 0; w < sliceCount; ++w) {
+            std::size_t from = count * w / sliceCount;
+            std::size_t to = count * (w + 1) / sliceCount;
+            if (from == to) continue;
+            slices.push_back(runOn(pool, [&, from, to]() -> std::optional<std::string> {
+                for (std::size_t c = from; c < to; ++c) {
+                    const char* bytes = data + starts[next + c];
+                    std::uint32_t length = static_cast<std::uint32_t>(lengths[next + c]);
+                    JournaledChunk& chunk = step.chunks[c];
+                    chunk = JournaledChunk{Sha256::of(bytes, length), length, crc32c(bytes, length)};
+
+                    // A chunk already present is never rewritten; one a crash
+                    // cut short before it reached the disk is
+                    std::error_code exists;
+                    std::string path = chunkPath(chunk.hash);
+                    if (fs::file_size(path, exists) == length) continue;
+                    fs::create_directories(fs::path(path).parent_path(), exists);
+                    // Flushed all at once before the manifest refers to it
+                    if (!replaceFile(path, bytes, length, false)) return "Cannot write chunk " + path;
+                    ++newChunks;
+                    newBytes += length;
+                }
+                return std::nullopt;
+            }));
+        }
+        whole.update(data + offset, end - offset);
+        std::optional<std::string> error;
+        for (auto& slice : slices) {
+            auto result = slice.get();
+            if (result && !error) error = result;
+        }
+        if (error) return *error + (journaled ? " (uploading it again resumes where it stopped)" : "");
+
+        for (const auto& chunk : step.chunks) manifest.chunks.push_back(ChunkRef{chunk.hash, chunk.size});
+        if (journaled) {
+            step.end = end;
+            BinaryWriter state;
+            whole.saveState(state);
+            step.hashState = state.data();
+            journal.append(encodeStep(step));
+        }
+        next = last;
+        offset = end;
+        reporter.update(offset);
+    }
+    local.newChunks = newChunks;
+    local.newBytes = newBytes;
+    manifest.fileHash = whole.finish();
+    mapping.reset();
+    if (size >= kDropSourceBytes) dropCachedPages(src);
+    local.chunks = manifest.chunks.size();
+    local.bytes = size;
+
+    BinaryWriter out;
+    out.putBytes(kManifestMagic, sizeof(kManifestMagic));
+    out.put<std::uint32_t>(kManifestVersion);
+    out.put<std::uint64_t>(manifest.size);
+    out.put(manifest.fileHash);
+    out.putArray(manifest.chunks);
+
+    // The manifest is the commit point: every chunk it names (including
+    // ones an earlier, failed upload left unflushed) goes to disk first, with
+    // one syncfs rather than a flush per chunk
+    if (!manifest.chunks.empty() && !syncChunks()) return "Cannot write chunks to " + root;
+
+    // Found from the hash taken while chunking, so src is read only once;
+    // storing the same contents at dst again is not a duplicate
+    auto duplicate = storedPathOf(manifest.fileHash);
+    if (duplicate && fs::path(*duplicate).lexically_normal() != fs::path(dst).lexically_normal()) {
+        local.duplicateOf = *duplicate;
+    }
+
+    // Chunks of a replaced file may now be unreferenced
+    bool replaced = fs::exists(dst, ec);
+    fs::create_directories(fs::path(dst).parent_path(), ec);
+    if (!replaceFile(dst, out.data().data(), out.size())) return "Cannot write " + dst;
+    if (replaced) markForSweep();
+    fs::create_directories(root + "/files", ec);
+    replaceFile(fileIndexPath(manifest.fileHash), dst.data(), dst.size());
+    if (journaled) journal.discard();
+
+    if (stats) *stats = local;
+    reporter.update(size, true);
+    return std::nullopt;
+}
+
+bool ChunkStore::syncChunks() const {
+    int dir = ::open(root.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir < 0) return false;
+    bool synced = ::syncfs(dir) == 0;
+    ::close(dir);
+    return synced;
+}
+
+std::optional<std::string> ChunkStore::storedPathOf(const ContentHash& hash) const {
+    // The index may name a path that was removed or overwritten since
+    auto stored = readWholeFile(fileIndexPath(hash));
+    if (!stored) return std::nullopt;
+    auto manifest = readManifest(*stored);
+    if (!manifest || manifest->fileHash != hash) return std::nullopt;
+    return stored;
+}
+
+std::optional<std::string> ChunkStore::restore(const std::string& path, const std::string& dst,
+                                               const TransferCallback& progress) const {
+    auto manifest = readManifest(path);
+    auto size = storedSize(path);
+    if (!size) return "Cannot read " + path;
+    if (*size >= kResumableBytes) return restoreBlocks(path, manifest, *size, dst, progress);
+    if (!manifest) {
+        if (!copyFile(path, dst, progress)) return std::string("Copy failed");
+        return std::nullopt;
+    }
+    ProgressReporter reporter(progress, manifest->size, "chunks");
+    std::uint64_t done = 0;
+
+    std::error_code ec;
+    fs::create_directories(fs::path(dst).parent_path(), ec);
+    std::ofstream out(dst, std::ios::binary | std::ios::trunc);
+    if (!out) return "Cannot write " + dst;
+    for (const auto& ref : manifest->chunks) {
+        auto chunk = readWholeFile(chunkPath(ref.hash));
+        if (!chunk || chunk->size() != ref.size || Sha256::of(chunk->data(), chunk->size()) != ref.hash) {
+            out.close();
+            fs::remove(dst, ec);
+            return "Missing or corrupt chunk " + Sha256::hex(ref.hash);
+        }
+        out.write(chunk->data(), static_cast<std::streamsize>(chunk->size()));
+        done += chunk->size();
+        reporter.update(done);
+    }
+    if (!out) return "Cannot write " + dst;
+    reporter.update(done, true);
+    return std::nullopt;
+}
+
+std::optional<std::string> ChunkStore::restoreBlocks(const std::string& path,
+                                                     const std::optional<ChunkManifest>& manifest,
+                                                     std::uint64_t size, const std::string& dst,
+                                                     const TransferCallback& progress) const {
+    auto identity = sourceIdentity(path);
+    if (!identity) return "Cannot read " + path;
+    std::error_code ec;
+    fs::create_directories(fs::path(dst).parent_path(), ec);
+    TransferJournal journal(dst + ".journal");
+    std::vector<std::string> records;
+    BinaryWriter key;
+    key.putString("restore");
+    key.putString(*identity);
+    key.put<std::uint64_t>(kTransferBlock);
+    if (!journal.open(key.data(), records)) return "Cannot write " + dst + ".journal";
+
+    std::string part = dst + ".part";
+    Descriptor out(::open(part.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644));
+    if (out.fd < 0) return "Cannot write " + part;
+    if (records.empty() && (::ftruncate(out.fd, 0) != 0 || ::ftruncate(out.fd, static_cast<off_t>(size)) != 0)) {
+        return "Cannot write " + part;
+    }
+    Descriptor in(manifest ? -1 : ::open(path.c_str(), O_RDONLY | O_CLOEXEC));
+    if (!manifest && in.fd < 0) return "Cannot read " + path;
+
+    // Blocks an earlier run finished; a later record for a block wins
+    std::uint64_t blocks = (size + kTransferBlock - 1) / kTransferBlock;
+    std::vector<std::optional<std::uint32_t>> finished(blocks);
+    for (const auto& record : records) {
+        BinaryReader reader(record.data(), record.size());
+        auto index = reader.get<std::uint64_t>();
+        auto crc = reader.get<std::uint32_t>();
+        if (reader.ok() && reader.atEnd() && index < blocks) finished[index] = crc;
+    }
+
+    std::vector<std::uint64_t> chunkStarts;
+    if (manifest) {
+        chunkStarts.resize(manifest->chunks.size());
+        for (std::size_t i = 1; i < chunkStarts.size(); ++i) {
+            chunkStarts[i] = chunkStarts[i - 1] + manifest->chunks[i - 1].size;
+        }
+    }
+
+    // Each block is read from the source (verifying the chunks it overlaps),
+    // written to the part file and flushed and evicted before its CRC32C is
+    // journaled. A block the journal lists is kept if its bytes still match.
+    ThreadPool pool(transferThreads());
+    std::vector<std::vector<char>> buffers(pool.size(), std::vector<char>(kTransferBlock));
+    std::vector<std::future<std::optional<std::string>>> pending;
+    for (std::uint64_t index = 0; index < blocks; ++index) {
+        pending.push_back(pool.submit([&, index]() -> std::optional<std::string> {
+            std::uint64_t begin = index * kTransferBlock;
+            std::size_t length = static_cast<std::size_t>(std::min<std::uint64_t>(kTransferBlock, size - begin));
+            char* buffer = buffers[ThreadPool::currentWorker()].data();
+            if (finished[index] && readAt(out.fd, buffer, length, begin) && crc32c(buffer, length) == *finished[index]) {
+                return std::nullopt;
+            }
+
+            if (!manifest) {
+                if (!readAt(in.fd, buffer, length, begin)) return "Cannot read " + path;
+                ::posix_fadvise(in.fd, static_cast<off_t>(begin), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+            } else {
+                auto first = std::upper_bound(chunkStarts.begin(), chunkStarts.end(), begin) - chunkStarts.begin() - 1;
+                for (auto c = static_cast<std::size_t>(first); c < chunkStarts.size() && chunkStarts[c] < begin + length; ++c) {
+                    const auto& ref = manifest->chunks[c];
+                    auto chunk = readWholeFile(chunkPath(ref.hash));
+                    if (!chunk || chunk->size() != ref.size || Sha256::of(chunk->data(), chunk->size()) != ref.hash) {
+                        return "Missing or corrupt chunk " + Sha256::hex(ref.hash);
+                    }
+                    std::uint64_t from = std::max(begin, chunkStarts[c]);
+                    std::uint64_t to = std::min(begin + length, chunkStarts[c] + ref.size);
+                    std::memcpy(buffer + (from - begin), chunk->data() + (from - chunkStarts[c]), to - from);
+                }
+            }
+            std::uint32_t crc = crc32c(buffer, length);
+            if (!writeAt(out.fd, buffer, length, begin)) return "Cannot write " + part;
+            ::sync_file_range(out.fd, static_cast<off_t>(begin), static_cast<off_t>(length),
+                              SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER);
+            ::posix_fadvise(out.fd, static_cast<off_t>(begin), static_cast<off_t>(length), POSIX_FADV_DONTNEED);
+            BinaryWriter record;
+            record.put<std::uint64_t>(index);
+            record.put(crc);
+            journal.append(record.data());
+            return std::nullopt;
+        }));
+    }
+
+    ProgressReporter reporter(progress, size, manifest ? "chunks" : "blocks");
+    std::optional<std::string> error;
+    std::uint64_t done = 0;
+    for (std::uint64_t index = 0; index < blocks; ++index) {
+        auto result = pending[index].get();
+        if (result && !error) error = result;
+        done += std::min<std::uint64_t>(kTransferBlock, size - index * kTransferBlock);
+        reporter.update(done);
+    }
+    if (error) return *error + " (downloading it again resumes from " + part + ")";
+
+    if (::fdatasync(out.fd) != 0) return "Cannot write " + part;
+    fs::rename(part, dst, ec);
+    if (ec) return "Cannot write " + dst;
+    journal.discard();
+    reporter.update(size, true);
+    return std::nullopt;
+}
+
+void ChunkStore::markForSweep() const {
+    std::error_code ec;
+    fs::create_directories(root, ec);
+    replaceFile(sweepMarkerPath(), "", 0);
+}
+
+ChunkSweepStats ChunkStore::sweepIfMarked(const std::string& resourcesRoot) const {
+    ChunkSweepStats stats;
+    std::error_code ec;
+    if (!fs::exists(sweepMarkerPath(), ec) || !fs::is_directory(resourcesRoot, ec)) return stats;
+
+    // Mark: every chunk named by a manifest. An unreadable tree aborts the
+    // sweep, since a missed manifest would lose its chunks.
+    std::unordered_set<ContentHash, ContentHashHasher> referenced;
+    for (fs::recursive_directory_iterator it(resourcesRoot, ec), end; it != end; it.increment(ec)) {
+        if (ec) return stats;
+        if (!it->is_regular_file(ec)) continue;
+        auto manifest = readManifest(it->path().string());
+        if (!manifest) continue;
+        ++stats.manifests;
+        for (const auto& ref : manifest->chunks) referenced.insert(ref.hash);
+    }
+    if (ec) return stats;
+
+    // Chunks an interrupted upload stored stay for its resumption, unless it
+    // was abandoned
+    auto staleBefore = fs::file_time_type::clock::now() - kJournalMaxAge;
+    for (fs::directory_iterator it(root + "/journals", ec), end; !ec && it != end; it.increment(ec)) {
+        std::string path = it->path().string();
+        std::error_code timeError;
+        if (it->last_write_time(timeError) < staleBefore && !timeError) {
+            fs::remove(path, timeError);
+            continue;
+        }
+        for (const auto& record : TransferJournal::readRecords(path)) {
+            auto step = decodeStep(record);
+            if (!step) break;
+            for (const auto& chunk : step->chunks) referenced.insert(chunk.hash);
+        }
+    }
+    ec.clear();
+
+    // Sweep: chunk files nobody refers to, and index entries gone stale
+    for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        if (!it->is_regular_file(ec)) continue;
+        const fs::path& path = it->path();
+        auto hash = parseHex(path.filename().string());
+        if (!hash) continue;
+        if (path.parent_path().filename() == "files") {
+            auto stored = readWholeFile(path.string());
+            auto manifest = stored ? readManifest(*stored) : std::nullopt;
+            if (!manifest || manifest->fileHash != *hash) fs::remove(path, ec);
+        } else if (!referenced.count(*hash)) {
+            auto size = it->file_size(ec);
+            if (fs::remove(path, ec)) {
+                ++stats.removedChunks;
+                stats.removedBytes += size;
+            }
+        }
+        ec.clear();
+    }
+    fs::remove(sweepMarkerPath(), ec);
+    return stats;
+}
+
+std::optional<ChunkManifest> ChunkStore::readManifest(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    char magic[sizeof(kManifestMagic)];
+    if (!in.read(magic, sizeof(magic)) || std::memcmp(magic, kManifestMagic, sizeof(magic)) != 0) {
+        return std::nullopt;
+    }
+    std::string body((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    BinaryReader reader(body.data(), body.size());
+
+    ChunkManifest manifest;
+    if (reader.get<std::uint32_t>() != kManifestVersion) return std::nullopt;
+    manifest.size = reader.get<std::uint64_t>();
+    manifest.fileHash = reader.get<ContentHash>();
+    manifest.chunks = reader.getArray<ChunkRef>();
+    if (!reader.ok() || !reader.atEnd()) return std::nullopt;
+
+    std::uint64_t total = 0;
+    for (const auto& ref : manifest.chunks) total += ref.size;
+    if (total != manifest.size) return std::nullopt;
+    return manifest;
+}
+
+std::optional<std::uint64_t> ChunkStore::storedSize(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in) return std::nullopt;
+    char header[kManifestHeaderSize];
+    if (in.read(header, sizeof(header)) && std::memcmp(header, kManifestMagic, sizeof(kManifestMagic)) == 0) {
+        BinaryReader reader(header + sizeof(kManifestMagic), sizeof(header) - sizeof(kManifestMagic));
+        if (reader.get<std::uint32_t>() == kManifestVersion) return reader.get<std::uint64_t>();
+    }
+    std::error_code ec;
+    auto size = fs::file_size(path, ec);
+    if (ec) return std::nullopt;
+    return size;
+}
+
+// ============================================================================
+// Stored File Reader
+// ============================================================================
+
+bool StoredFileReader::open(const std::string& path) {
+    manifest = ChunkStore::readManifest(path);
+    nextChunk = 0;
+    file.close();
+    file.clear();
+    if (manifest) return openNextChunk() || manifest->chunks.empty();
+    file.open(path, std::ios::binary);
+    return static_cast<bool>(file);
+}
+
+bool StoredFileReader::openNextChunk() {
+    file.close();
+    file.clear();
+    if (!manifest || nextChunk >= manifest->chunks.size()) return false;
+    file.open(chunks.chunkPath(manifest->chunks[nextChunk++].hash), std::ios::binary);
+    return static_cast<bool>(file);
+}
+
+std::size_t StoredFileReader::read(char* out, std::size_t size) {
+    std::size_t filled = 0;
+    while (filled < size) {
+        if (file.is_open()) {
+            file.read(out + filled, static_cast<std::streamsize>(size - filled));
+            filled += static_cast<std::size_t>(file.gcount());
+            if (filled == size) break;
+        }
+        if (!openNextChunk()) break;
+    }
+    return filled;
+}
+
+}
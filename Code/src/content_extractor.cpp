@@ -0,0 +1,424 @@
+#include "content_extractor.h"
+#include "chunk_store.h"
+#include "storage.h"
+#include <vector>
+#include <algorithm>
+#include <array>
+#include <cctype>
+#include <cstring>
+#include <cstdlib>
+#include <zlib.h>
+
+namespace uni {
+
+// ============================================================================
+// Term Counting
+// ============================================================================
+
+namespace {
+
+// ASCII bytes outside terms; a chunk is only split at one of these, since
+// UTF-8 continuation bytes and letters may carry on into the next chunk
+bool separatesTerms(char c) {
+    auto byte = static_cast<unsigned char>(c);
+    return byte < 0x80 && !std::isalnum(byte);
+}
+
+}
+
+void StreamingTermCounter::count(std::string_view text) {
+    for (auto term : tokenizer.tokenize(text)) {
+        ++total;
+        key.assign(term.data(), term.size());
+        auto it = counts.find(key);
+        if (it != counts.end()) ++it->second;
+        else if (counts.size() < maxTerms) counts.emplace(key, 1);
+    }
+}
+
+void StreamingTermCounter::feed(std::string_view text) {
+    auto first = std::find_if(text.begin(), text.end(), separatesTerms);
+    if (first == text.end()) {
+        carry.append(text);
+        // Text without ASCII separators (e.g. CJK) is counted in pieces
+        if (carry.size() >= kContentChunkSize) {
+            count(carry);
+            carry.clear();
+        }
+        return;
+    }
+    auto last = std::find_if(text.rbegin(), text.rend(), separatesTerms).base() - 1;
+
+    carry.append(text.begin(), first);
+    count(carry);
+    count(std::string_view(&*first, static_cast<std::size_t>(last - first)));
+    carry.assign(last + 1, text.end());
+}
+
+void StreamingTermCounter::finish() {
+    count(carry);
+    carry.clear();
+}
+
+// ============================================================================
+// Buffered Sink
+// ============================================================================
+// Collects small pieces of text and hands them on in chunk-sized batches.
+class BufferedSink {
+private:
+    const TextSink& sink;
+    std::string buffer;
+    bool wroteAny = false;
+
+public:
+    explicit BufferedSink(const TextSink& s) : sink(s) { buffer.reserve(kContentChunkSize); }
+
+    void put(char c) {
+        buffer.push_back(c);
+        if (buffer.size() >= kContentChunkSize) flush();
+    }
+
+    void put(const char* text) {
+        while (*text) put(*text++);
+    }
+
+    void flush() {
+        if (buffer.empty()) return;
+        sink(buffer);
+        wroteAny = true;
+        buffer.clear();
+    }
+
+    bool producedText() const { return wroteAny; }
+};
+
+// ============================================================================
+// PDF Content Streams
+// ============================================================================
+// Decoded page content is a sequence of operands and operators. Text shows up
+// as literal strings "(...)" used by Tj / TJ / ' / ". Word breaks come from
+// text positioning operators and from large negative kerning inside TJ arrays.
+// Hex strings (CID fonts) cannot be mapped without the font and are skipped,
+// as is inline image data between ID and EI.
+class PdfTextParser {
+private:
+    enum class State { Normal, String, Escape, Octal, Hex, Comment, InlineImage };
+
+    BufferedSink& out;
+    State state = State::Normal;
+    int depth = 0;                 // Parenthesis nesting inside a literal string
+    int octal = 0;
+    int octalDigits = 0;
+    std::string token;             // Current operand or operator
+    bool inArray = false;
+    char window[3] = {0, 0, 0};    // Last bytes of inline image data, to find "EI"
+
+    // Whitespace and PDF delimiters, as a table since every content byte is tested
+    static bool isDelimiter(char c) {
+        static const auto table = [] {
+            std::array<bool, 256> t{};
+            for (unsigned char d : std::string_view(" \t\r\n\f\v()<>[]{}/%", 17)) t[d] = true;
+            t[0] = true;
+            return t;
+        }();
+        return table[static_cast<unsigned char>(c)];
+    }
+
+    // TeX fonts place ligatures at control codes (OT1 at 013-017, T1 at
+    // 033-037); map them back to letters so "efficient" stays one word
+    void emitCode(int code) {
+        switch (code) {
+            case 013: case 033: out.put("ff"); break;
+            case 014: case 034: out.put("fi"); break;
+            case 015: case 035: out.put("fl"); break;
+            case 016: case 036: out.put("ffi"); break;
+            case 017: case 037: out.put("ffl"); break;
+            default:
+                if (code >= 0x20 && code < 0x7F) out.put(static_cast<char>(code));
+                else out.put(' ');
+        }
+    }
+
+    static bool breaksWords(const std::string& op) {
+        if (op.size() == 1) return op[0] == '\'' || op[0] == '"';
+        if (op.size() != 2) return false;
+        if (op[0] == 'T') return op[1] == 'j' || op[1] == 'J' || op[1] == '*' || op[1] == 'd' || op[1] == 'D' || op[1] == 'm';
+        return (op[0] == 'B' || op[0] == 'E') && op[1] == 'T';
+    }
+
+    void endToken() {
+        if (token.empty()) return;
+        if (breaksWords(token)) {
+            out.put(' ');
+        } else if (inArray && token[0] == '-') {
+            // Kerning this far left is a word space
+            if (std::strtod(token.c_str(), nullptr) < -200.0) out.put(' ');
+        } else if (token == "ID") {
+            state = State::InlineImage;
+            window[0] = window[1] = window[2] = 0;
+        }
+        token.clear();
+    }
+
+public:
+    explicit PdfTextParser(BufferedSink& sink) : out(sink) {}
+
+    void reset() {
+        state = State::Normal;
+        token.clear();
+        inArray = false;
+        depth = 0;
+        out.put(' ');
+    }
+
+    void feed(const char* data, std::size_t size) {
+        for (std::size_t i = 0; i < size; ++i) {
+            char c = data[i];
+            switch (state) {
+                case State::Normal:
+                    if (!isDelimiter(c)) {
+                        if (token.size() < 32) token.push_back(c);
+                        break;
+                    }
+                    endToken();
+                    if (state != State::Normal) break;
+                    if (c == '(') { state = State::String; depth = 1; }
+                    else if (c == '<') state = State::Hex;
+                    else if (c == '%') state = State::Comment;
+                    else if (c == '[') inArray = true;
+                    else if (c == ']') inArray = false;
+                    break;
+
+                case State::String:
+                    if (c == '\\') state = State::Escape;
+                    else if (c == '(') { ++depth; out.put(c); }
+                    else if (c == ')') {
+                        if (--depth == 0) state = State::Normal;
+                        else out.put(c);
+                    } else emitCode(static_cast<unsigned char>(c));
+                    break;
+
+                case State::Escape:
+                    if (c >= '0' && c <= '7') {
+                        octal = c - '0';
+                        octalDigits = 1;
+                        state = State::Octal;
+                        break;
+                    }
+                    if (c == 'n' || c == 'r' || c == 't' || c == 'b' || c == 'f') out.put(' ');
+                    else if (c != '\n' && c != '\r') out.put(c);
+                    state = State::String;
+                    break;
+
+                case State::Octal:
+                    if (c >= '0' && c <= '7' && octalDigits < 3) {
+                        octal = octal * 8 + (c - '0');
+                        ++octalDigits;
+                        break;
+                    }
+                    emitCode(octal & 0xFF);
+                    state = State::String;
+                    --i;   // Reprocess c as a plain string byte
+                    break;
+
+                case State::Hex:
+                    // "<<" opens a dictionary, not a hex string
+                    if (c == '<' || c == '>') state = State::Normal;
+                    break;
+
+                case State::Comment:
+                    if (c == '\n' || c == '\r') state = State::Normal;
+                    break;
+
+                case State::InlineImage:
+                    window[0] = window[1];
+                    window[1] = window[2];
+                    window[2] = c;
+                    if (std::isspace(static_cast<unsigned char>(window[0])) && window[1] == 'E' && window[2] == 'I') {
+                        state = State::Normal;
+                    }
+                    break;
+            }
+        }
+    }
+};
+
+// Walks the raw file for "stream ... endstream" sections. A stream's filter
+// and type are read from the dictionary before it; FlateDecode streams are
+// inflated chunk by chunk and unfiltered ones passed through. Fonts, images,
+// cross-reference streams and other filters are skipped.
+class PdfStreamScanner {
+private:
+    enum class Mode { Scan, Raw, Flate, Skip };
+
+    static constexpr std::size_t kDictionaryWindow = 4096;
+    static constexpr char kEndStream[] = "endstream";
+    static constexpr std::size_t kEndStreamLength = sizeof(kEndStream) - 1;
+
+    PdfTextParser parser;
+    Mode mode = Mode::Scan;
+    std::string dictionary;        // Bytes since the last "obj", capped
+    bool sawKeyword = false;       // "stream" seen, waiting for its end of line
+    std::string held;              // Stream bytes that may start "endstream"
+    z_stream inflater{};
+    bool inflating = false;
+    std::vector<char> inflated;
+
+    bool endsWith(const std::string& text, const char* suffix, std::size_t length) const {
+        return text.size() >= length && text.compare(text.size() - length, length, suffix) == 0;
+    }
+
+    void beginStream() {
+        static const char* skipped[] = {"/Length1", "/Length2", "/Length3", "/Image", "/XRef", "/Type1C",
+                                        "/CIDFontType0C", "/OpenType", "/DCTDecode", "/JPXDecode",
+                                        "/JBIG2Decode", "/CCITTFaxDecode", "/ASCII85Decode",
+                                        "/ASCIIHexDecode", "/LZWDecode", "/RunLengthDecode"};
+        mode = dictionary.find("/FlateDecode") != std::string::npos ? Mode::Flate : Mode::Raw;
+        for (const char* marker : skipped) {
+            if (dictionary.find(marker) != std::string::npos) mode = Mode::Skip;
+        }
+        dictionary.clear();
+        held.clear();
+        parser.reset();
+
+        if (mode == Mode::Flate) {
+            inflater = z_stream{};
+            inflating = inflateInit(&inflater) == Z_OK;
+            if (!inflating) mode = Mode::Skip;
+        }
+    }
+
+    void endInflate() {
+        if (inflating) inflateEnd(&inflater);
+        inflating = false;
+        mode = Mode::Skip;   // Wait for "endstream"
+    }
+
+    void feedFlate(const char* data, std::size_t size) {
+        inflater.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+        inflater.avail_in = static_cast<uInt>(size);
+        // A full output buffer may leave more output pending even without input
+        do {
+            inflater.next_out = reinterpret_cast<Bytef*>(inflated.data());
+            inflater.avail_out = static_cast<uInt>(inflated.size());
+            int status = inflate(&inflater, Z_NO_FLUSH);
+            parser.feed(inflated.data(), inflated.size() - inflater.avail_out);
+            if (status == Z_STREAM_END || (status != Z_OK && status != Z_BUF_ERROR)) {
+                endInflate();
+                return;
+            }
+        } while (inflater.avail_in > 0 || inflater.avail_out == 0);
+    }
+
+    // Raw and Skip: finds "endstream" with memmem, passing the bytes before it
+    // through. Up to kEndStreamLength - 1 trailing bytes are held back in case
+    // the marker straddles two chunks. Returns the bytes consumed.
+    std::size_t feedBody(const char* data, std::size_t size) {
+        std::string joined = held + std::string(data, std::min(size, kEndStreamLength - 1));
+        std::size_t split = joined.find(kEndStream);
+        if (split != std::string::npos && split < held.size()) {
+            if (mode == Mode::Raw) parser.feed(held.data(), split);
+            held.clear();
+            mode = Mode::Scan;
+            return split + kEndStreamLength - (joined.size() - std::min(size, kEndStreamLength - 1));
+        }
+
+        if (mode == Mode::Raw) parser.feed(held.data(), held.size());
+        held.clear();
+        const void* found = memmem(data, size, kEndStream, kEndStreamLength);
+        if (found) {
+            std::size_t at = static_cast<const char*>(found) - data;
+            if (mode == Mode::Raw) parser.feed(data, at);
+            mode = Mode::Scan;
+            return at + kEndStreamLength;
+        }
+
+        std::size_t keep = std::min(size, kEndStreamLength - 1);
+        if (mode == Mode::Raw) parser.feed(data, size - keep);
+        held.assign(data + size - keep, keep);
+        return size;
+    }
+
+    void scanByte(char c) {
+        if (sawKeyword) {
+            if (c == '\r') return;
+            sawKeyword = false;
+            if (c == '\n') {
+                beginStream();
+                return;
+            }
+        }
+        dictionary.push_back(c);
+        if (endsWith(dictionary, "obj", 3)) dictionary.assign("obj");
+        if (dictionary.size() > kDictionaryWindow) dictionary.erase(0, dictionary.size() - kDictionaryWindow / 2);
+        if (endsWith(dictionary, "stream", 6) && !endsWith(dictionary, kEndStream, kEndStreamLength)) {
+            sawKeyword = true;
+        }
+    }
+
+public:
+    explicit PdfStreamScanner(BufferedSink& sink) : parser(sink), inflated(kContentChunkSize) {}
+
+    ~PdfStreamScanner() {
+        if (inflating) inflateEnd(&inflater);
+    }
+
+    void feed(const char* data, std::size_t size) {
+        std::size_t i = 0;
+        while (i < size) {
+            if (mode == Mode::Flate) {
+                // Inflate consumes the whole chunk unless the stream ends inside it
+                std::size_t before = size - i;
+                feedFlate(data + i, before);
+                i += before - (inflating ? 0 : inflater.avail_in);
+            } else if (mode == Mode::Scan) {
+                scanByte(data[i++]);
+            } else {
+                i += feedBody(data + i, size - i);
+            }
+        }
+    }
+};
+
+// ============================================================================
+// File Type Detection and Extraction
+// ============================================================================
+
+static bool isPdf(const char* data, std::size_t size) {
+    return size >= 5 && std::memcmp(data, "%PDF-", 5) == 0;
+}
+
+// Text if the first chunk has no NUL bytes (UTF-16 and binary formats do)
+static bool looksLikeText(const char* data, std::size_t size) {
+    return std::memchr(data, '\0', size) == nullptr;
+}
+
+bool extractText(const std::string& path, const TextSink& sink) {
+    // Deduplicated uploads are read back through their chunks
+    StoredFileReader file{ChunkStore(chunksDir())};
+    if (!file.open(path)) return false;
+
+    std::vector<char> chunk(kContentChunkSize);
+    std::size_t size = file.read(chunk.data(), chunk.size());
+    if (size == 0) return false;
+
+    BufferedSink out(sink);
+    if (isPdf(chunk.data(), size)) {
+        PdfStreamScanner scanner(out);
+        while (size > 0) {
+            scanner.feed(chunk.data(), size);
+            size = file.read(chunk.data(), chunk.size());
+        }
+        out.flush();
+        return out.producedText();
+    }
+
+    if (!looksLikeText(chunk.data(), size)) return false;
+    while (size > 0) {
+        sink(std::string_view(chunk.data(), size));
+        size = file.read(chunk.data(), chunk.size());
+    }
+    return true;
+}
+
+}
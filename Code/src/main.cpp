@@ -1,7 +1,24 @@
 #include "enhanced_menu.h"
+#include <string>
+#include <cstdlib>
 
-int main() {
+int main(int argc, char* argv[]) {
     uni::EnhancedMenu menu;
+    
+    // unihub --reindex [threads]: rebuild the resource index in parallel and exit
+    if (argc > 1 && std::string(argv[1]) == "--reindex") {
+        std::size_t threads = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+        menu.reindex(threads);
+        return 0;
+    }
+    
+    // unihub --import-students <file.csv> [threads]: register a batch of students and exit
+    if (argc > 2 && std::string(argv[1]) == "--import-students") {
+        std::size_t threads = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 0;
+        menu.importStudents(argv[2], threads);
+        return 0;
+    }
+    
     menu.run();
     return 0;
-}
\ No newline at end of file
+}
@@ -0,0 +1,206 @@
+#include "resource_catalog.h"
+#include "chunk_store.h"
+#include "storage.h"
+#include <filesystem>
+#include <system_error>
+#include <cerrno>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace uni {
+
+namespace {
+
+// Files are reported once written (not on every write), and moves count as
+// removals and additions
+constexpr std::uint32_t kWatchMask = IN_CREATE | IN_CLOSE_WRITE | IN_ATTRIB | IN_DELETE |
+                                     IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR;
+
+bool isInside(const std::string& path, const std::string& dir) {
+    return path.size() > dir.size() && path.compare(0, dir.size(), dir) == 0 && path[dir.size()] == '/';
+}
+
+}
+
+ResourceCatalog::~ResourceCatalog() {
+    if (inotifyFd >= 0) ::close(inotifyFd);
+}
+
+bool ResourceCatalog::open() {
+    stopWatching();
+    inotifyFd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd < 0) return false;
+    if (!ensureDir(root) || !addTree(root, false) || !folders.count(root)) {
+        stopWatching();
+        return false;
+    }
+    return true;
+}
+
+void ResourceCatalog::stopWatching() {
+    if (inotifyFd >= 0) ::close(inotifyFd);
+    inotifyFd = -1;
+    folders.clear();
+    watchedFolders.clear();
+}
+
+// Watches dir and every folder below it, each before it is read, so nothing
+// created meanwhile is missed. Files found are queued as changes when
+// reportFiles is set (a folder that appeared while watching).
+bool ResourceCatalog::addTree(const std::string& dir, bool reportFiles) {
+    int watch = ::inotify_add_watch(inotifyFd, dir.c_str(), kWatchMask);
+    if (watch < 0) return errno != ENOSPC && errno != ENOMEM;  // Gone again, or out of watches
+    watchedFolders[watch] = dir;
+    Folder& folder = folders[dir];
+    folder.watch = watch;
+
+    std::vector<std::string> subfolders;
+    std::error_code ec;
+    for (fs::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        std::error_code typeError;
+        std::string path = it->path().string();
+        if (it->is_directory(typeError)) {
+            subfolders.push_back(path);
+        } else if (it->is_regular_file(typeError)) {
+            folder.files.emplace(it->path().filename().string(), Entry{});
+            if (reportFiles) changes.insert(path);
+        }
+    }
+    for (const auto& subfolder : subfolders) {
+        if (!addTree(subfolder, reportFiles)) return false;
+    }
+    return true;
+}
+
+// Forgets dir and everything below it, queuing its files as removed
+void ResourceCatalog::dropTree(const std::string& dir) {
+    for (auto it = folders.begin(); it != folders.end();) {
+        if (it->first != dir && !isInside(it->first, dir)) {
+            ++it;
+            continue;
+        }
+        for (const auto& file : it->second.files) changes.insert(it->first + "/" + file.first);
+        // Removing the watch of a deleted folder fails harmlessly
+        ::inotify_rm_watch(inotifyFd, it->second.watch);
+        watchedFolders.erase(it->second.watch);
+        it = folders.erase(it);
+    }
+}
+
+bool ResourceCatalog::handleEvent(int watch, std::uint32_t mask, const std::string& name) {
+    if (mask & IN_Q_OVERFLOW) {
+        rescan();
+        return false;
+    }
+    auto watched = watchedFolders.find(watch);
+    if (watched == watchedFolders.end()) return true;
+    if (mask & IN_IGNORED) {
+        folders.erase(watched->second);
+        watchedFolders.erase(watched);
+        return true;
+    }
+    if (name.empty()) return true;
+
+    std::string dir = watched->second;
+    std::string path = dir + "/" + name;
+    if (mask & IN_ISDIR) {
+        if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+            dropTree(path);
+        } else if ((mask & (IN_CREATE | IN_MOVED_TO)) && !addTree(path, true)) {
+            stopWatching();
+            return false;
+        }
+        return true;
+    }
+
+    auto& files = folders[dir].files;
+    if (mask & (IN_DELETE | IN_MOVED_FROM)) {
+        files.erase(name);
+    } else {
+        files[name].described = false;
+    }
+    changes.insert(path);
+    return true;
+}
+
+// After lost events nothing is known for sure: every file known before or
+// found now is queued, and the watches start over
+void ResourceCatalog::rescan() {
+    for (const auto& [dir, folder] : folders) {
+        for (const auto& file : folder.files) changes.insert(dir + "/" + file.first);
+    }
+    if (open()) {
+        for (const auto& [dir, folder] : folders) {
+            for (const auto& file : folder.files) changes.insert(dir + "/" + file.first);
+        }
+    }
+}
+
+void ResourceCatalog::refresh() {
+    alignas(inotify_event) char buffer[64 * 1024];
+    while (inotifyFd >= 0) {
+        ssize_t length = ::read(inotifyFd, buffer, sizeof(buffer));
+        if (length <= 0) return;  // EAGAIN: nothing pending
+        for (ssize_t offset = 0; offset < length;) {
+            const auto* event = reinterpret_cast<const inotify_event*>(buffer + offset);
+            // The name is NUL-padded to the record length. After a rescan the
+            // watch numbers left in the buffer mean nothing; read afresh.
+            if (!handleEvent(event->wd, event->mask, event->len ? std::string(event->name) : std::string())) break;
+            offset += static_cast<ssize_t>(sizeof(inotify_event) + event->len);
+        }
+    }
+}
+
+std::optional<std::vector<CatalogFile>> ResourceCatalog::list(const std::string& folder) {
+    refresh();
+    if (!watching()) return std::nullopt;
+    auto found = folders.find(folder);
+    if (found == folders.end()) return std::nullopt;
+
+    std::vector<CatalogFile> listing;
+    auto& files = found->second.files;
+    for (auto it = files.begin(); it != files.end();) {
+        std::string path = folder + "/" + it->first;
+        Entry& entry = it->second;
+        if (!entry.described) {
+            struct stat info;
+            if (::stat(path.c_str(), &info) != 0 || !S_ISREG(info.st_mode)) {
+                it = files.erase(it);
+                continue;
+            }
+            entry.sizeBytes = ChunkStore::storedSize(path).value_or(static_cast<std::uint64_t>(info.st_size));
+            auto mtime = std::chrono::seconds(info.st_mtim.tv_sec) + std::chrono::nanoseconds(info.st_mtim.tv_nsec);
+            entry.modified = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(mtime));
+            entry.described = true;
+        }
+        listing.push_back(CatalogFile{path, it->first, entry.sizeBytes, entry.modified});
+        ++it;
+    }
+    return listing;
+}
+
+bool ResourceCatalog::ensureFolder(const std::string& folder) {
+    refresh();
+    if (watching() && folders.count(folder)) return true;
+    return ensureDir(folder);
+}
+
+std::vector<std::string> ResourceCatalog::takeChanges() {
+    refresh();
+    std::vector<std::string> changed(changes.begin(), changes.end());
+    changes.clear();
+    return changed;
+}
+
+ResourceCatalog& resourceCatalog() {
+    static ResourceCatalog catalog(resourcesDir());
+    static bool opened = catalog.open();
+    (void)opened;
+    return catalog;
+}
+
+}
@@ -1,6 +1,15 @@
 #include "resource_index.h"
+#include "storage.h"
+#include "chunk_store.h"
 #include <algorithm>
 #include <sstream>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+#include <cstring>
+#include <sys/stat.h>
+
+namespace fs = std::filesystem;
 
 namespace uni {
 
@@ -8,8 +17,470 @@ namespace uni {
 // Simple Resource Search Implementation
 // ============================================================================
 
-// The BST and SimpleAutocomplete implementations are now in the header files
-// and don't require separate implementation files since they use templates
-// and simple algorithms.
+// The BST and RadixTrie implementations are in the header files since they
+// use templates and simple algorithms. This file holds index persistence and
+// tombstone compaction.
+
+// ============================================================================
+// Resource Tree Helpers
+// ============================================================================
+
+static std::int64_t mtimeNanos(const fs::path& path) {
+    std::error_code ec;
+    auto t = fs::last_write_time(path, ec);
+    if (ec) return -1;
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+
+TreeFingerprint TreeFingerprint::scan(const std::string& root) {
+    TreeFingerprint fingerprint;
+    std::error_code ec;
+    if (!fs::is_directory(root, ec)) return fingerprint;
+    
+    fingerprint.directories.emplace_back(root, mtimeNanos(root));
+    for (fs::recursive_directory_iterator it(root, ec), end; !ec && it != end; it.increment(ec)) {
+        // is_directory() uses the cached entry type, so files are never stat'ed
+        if (it->is_directory(ec)) {
+            fingerprint.directories.emplace_back(it->path().string(), mtimeNanos(it->path()));
+        }
+    }
+    return fingerprint;
+}
+
+bool TreeFingerprint::stillMatches() const {
+    for (const auto& [path, mtime] : directories) {
+        if (mtimeNanos(path) != mtime) return false;
+    }
+    return true;
+}
+
+std::optional<ResourceMetadata> describeStoredResource(const std::string& root, const fs::path& file) {
+    fs::path relative = file.lexically_relative(root);
+    std::vector<std::string> parts;
+    for (const auto& part : relative) parts.push_back(part.string());
+    if (parts.size() != 7 || parts[0] == "..") return std::nullopt;
+    
+    ResourceMetadata metadata;
+    metadata.filename = file.string();
+    metadata.filePath = metadata.filename;
+    metadata.displayName = parts[6];
+    metadata.subject = parts[4];
+    metadata.resourceType = parts[5];
+    
+    // One stat() for both size and mtime; bulk indexing calls this per file
+    struct stat info;
+    if (::stat(file.c_str(), &info) != 0) return std::nullopt;
+    metadata.sizeBytes = static_cast<std::size_t>(info.st_size);
+    // Deduplicated uploads are manifests; report the size of the file they hold
+    if (auto logical = ChunkStore::storedSize(metadata.filename)) metadata.sizeBytes = *logical;
+    auto mtime = std::chrono::seconds(info.st_mtim.tv_sec) + std::chrono::nanoseconds(info.st_mtim.tv_nsec);
+    metadata.uploadTime = std::chrono::system_clock::time_point(
+        std::chrono::duration_cast<std::chrono::system_clock::duration>(mtime));
+    return metadata;
+}
+
+// ============================================================================
+// Snapshot Format
+// ============================================================================
+// header   magic "UNIHUBIX", version, field count, document count, term count,
+//          last write-ahead log LSN reflected
+// tree     recorded directory mtimes (TreeFingerprint)
+// store    ResourceStore columns (tombstoned rows flagged in a live column)
+// lengths  per-document field lengths (raw array)
+// minhash  per-document MinHash signatures (raw array)
+// graph    resource graph edges with their weights (raw array)
+// terms    term, max field frequencies, posting count, byte/skip ranges
+// skips    all skip entries, 8-byte aligned (read in place)
+// bytes    all encoded postings (read in place)
+// trailer  magic again, so truncated files are rejected
+
+static constexpr char kSnapshotMagic[8] = {'U', 'N', 'I', 'H', 'U', 'B', 'I', 'X'};
+
+struct SnapshotEdge {
+    DocId from;
+    DocId to;
+    float weight;
+};
+
+struct SnapshotTerm {
+    std::string term;
+    FieldFrequencies maxFrequencies;
+    std::uint32_t count;
+    std::uint64_t byteOffset;
+    std::uint64_t byteSize;
+    std::uint64_t skipOffset;
+    std::uint64_t skipCount;
+};
+
+bool ResourceIndex::saveSnapshot(const std::string& path, const TreeFingerprint& tree) const {
+    BinaryWriter out;
+    out.putBytes(kSnapshotMagic, sizeof(kSnapshotMagic));
+    out.put<std::uint32_t>(kSnapshotVersion);
+    out.put<std::uint32_t>(static_cast<std::uint32_t>(kFieldCount));
+    out.put<std::uint64_t>(store.size());
+    out.put<std::uint64_t>(invertedIndex.size());
+    out.put<std::uint64_t>(appliedLsn);
+    
+    out.put<std::uint64_t>(tree.directories.size());
+    for (const auto& [dir, mtime] : tree.directories) {
+        out.putString(dir);
+        out.put<std::int64_t>(mtime);
+    }
+    
+    store.serialize(out);
+    out.putArray(fieldLengths);
+    out.putArray(signatures);
+    std::vector<SnapshotEdge> edges;
+    for (const auto& edge : resourceGraph.getEdges()) {
+        edges.push_back(SnapshotEdge{edge.from, edge.to, static_cast<float>(edge.weight)});
+    }
+    out.putArray(edges);
+    
+    std::uint64_t byteTotal = 0;
+    std::uint64_t skipTotal = 0;
+    for (const auto& [term, entry] : invertedIndex) {
+        out.putString(term);
+        out.put(entry.maxFrequencies);
+        out.put<std::uint32_t>(static_cast<std::uint32_t>(entry.postings.size()));
+        out.put<std::uint64_t>(byteTotal);
+        out.put<std::uint64_t>(entry.postings.byteSize());
+        out.put<std::uint64_t>(skipTotal);
+        out.put<std::uint64_t>(entry.postings.skipCount());
+        byteTotal += entry.postings.byteSize();
+        skipTotal += entry.postings.skipCount();
+    }
+    
+    out.put<std::uint64_t>(skipTotal);
+    out.align(8);
+    for (const auto& [term, entry] : invertedIndex) {
+        out.putBytes(entry.postings.skipData(), entry.postings.skipCount() * sizeof(CompressedPostingList::Skip));
+    }
+    out.put<std::uint64_t>(byteTotal);
+    for (const auto& [term, entry] : invertedIndex) {
+        out.putBytes(entry.postings.byteData(), entry.postings.byteSize());
+    }
+    out.putBytes(kSnapshotMagic, sizeof(kSnapshotMagic));
+    
+    // The snapshot is on disk before the caller empties the write-ahead log
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    return replaceFile(path, out.data().data(), out.size());
+}
+
+bool ResourceIndex::loadSnapshot(const std::string& path, bool ignoreTree) {
+    auto mapping = MappedFile::open(path);
+    if (!mapping) return false;
+    BinaryReader in(mapping->data(), mapping->size());
+    
+    const char* magic = in.take(sizeof(kSnapshotMagic));
+    if (!magic || std::memcmp(magic, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) return false;
+    if (in.get<std::uint32_t>() != kSnapshotVersion) return false;
+    if (in.get<std::uint32_t>() != kFieldCount) return false;
+    auto docCount = in.get<std::uint64_t>();
+    auto termCount = in.get<std::uint64_t>();
+    auto snapshotLsn = in.get<std::uint64_t>();
+    
+    TreeFingerprint tree;
+    auto dirCount = in.get<std::uint64_t>();
+    for (std::uint64_t i = 0; i < dirCount && in.ok(); ++i) {
+        std::string dir = in.getString();
+        tree.directories.emplace_back(std::move(dir), in.get<std::int64_t>());
+    }
+    if (!in.ok() || (!ignoreTree && !tree.stillMatches())) return false;
+    
+    ResourceStore loadedStore;
+    if (!loadedStore.deserialize(in) || loadedStore.size() != docCount) return false;
+    auto loadedLengths = in.getArray<FieldLengths>();
+    if (!in.ok() || loadedLengths.size() != docCount) return false;
+    auto loadedSignatures = in.getArray<MinHashSignature>();
+    if (!in.ok() || loadedSignatures.size() != docCount) return false;
+    auto edges = in.getArray<SnapshotEdge>();
+    for (const auto& edge : edges) {
+        if (edge.from >= docCount || edge.to >= docCount) return false;
+    }
+    
+    std::vector<SnapshotTerm> terms;
+    terms.reserve(termCount);
+    for (std::uint64_t i = 0; i < termCount && in.ok(); ++i) {
+        SnapshotTerm t;
+        t.term = in.getString();
+        t.maxFrequencies = in.get<FieldFrequencies>();
+        t.count = in.get<std::uint32_t>();
+        t.byteOffset = in.get<std::uint64_t>();
+        t.byteSize = in.get<std::uint64_t>();
+        t.skipOffset = in.get<std::uint64_t>();
+        t.skipCount = in.get<std::uint64_t>();
+        terms.push_back(std::move(t));
+    }
+    
+    auto skipTotal = in.get<std::uint64_t>();
+    in.align(8);
+    if (skipTotal > in.remaining() / sizeof(CompressedPostingList::Skip)) return false;
+    const char* skipSection = in.take(skipTotal * sizeof(CompressedPostingList::Skip));
+    auto byteTotal = in.get<std::uint64_t>();
+    const char* byteSection = in.take(byteTotal);
+    const char* trailer = in.take(sizeof(kSnapshotMagic));
+    if (!in.ok() || !in.atEnd() || std::memcmp(trailer, kSnapshotMagic, sizeof(kSnapshotMagic)) != 0) {
+        return false;
+    }
+    
+    std::unordered_map<std::string, TermPostings> loadedIndex;
+    loadedIndex.reserve(terms.size());
+    std::shared_ptr<const void> owner = mapping;
+    for (auto& t : terms) {
+        if (t.byteSize > byteTotal || t.byteOffset > byteTotal - t.byteSize || t.skipCount > skipTotal ||
+            t.skipOffset > skipTotal - t.skipCount) {
+            return false;
+        }
+        TermPostings entry;
+        entry.maxFrequencies = t.maxFrequencies;
+        entry.postings = CompressedPostingList::view(
+            reinterpret_cast<const std::uint8_t*>(byteSection) + t.byteOffset, t.byteSize,
+            reinterpret_cast<const CompressedPostingList::Skip*>(skipSection) + t.skipOffset, t.skipCount,
+            t.count, owner);
+        // A damaged snapshot is rebuilt rather than read out of bounds later
+        if (!entry.postings.valid(docCount)) return false;
+        loadedIndex.emplace(std::move(t.term), std::move(entry));
+    }
+    
+    store = std::move(loadedStore);
+    fieldLengths = std::move(loadedLengths);
+    signatures = std::move(loadedSignatures);
+    invertedIndex = std::move(loadedIndex);
+    appliedLsn = snapshotLsn;
+    rebuildDerivedIndexes();
+    for (const auto& edge : edges) {
+        resourceGraph.addEdge(edge.from, edge.to, edge.weight);
+    }
+    return true;
+}
+
+void ResourceIndex::rebuildDerivedIndexes() {
+    collectionStats = CollectionStats();
+    std::vector<BPlusTree::Entry> ranges[std::size(kRangeColumns)];
+    for (DocId id = 0; id < store.size(); ++id) {
+        if (!store.isLive(id)) continue;
+        ResourceMetadata resource = store.get(id);
+        collectionStats.add(fieldLengths[id]);
+        resourceBST.insert(id);
+        resourceNameAutocomplete.insert(resource.displayName, resource.downloadCount);
+        ++displayNameCounts[resource.displayName];
+        popularResources.set(id, resource.downloadCount);
+        resourceGraph.addNode(id);
+        if (hasTerms(signatures[id])) similarity.insert(id, signatures[id]);
+        facets.add(id, facetsFromPath(resource.filename));
+        for (const auto& tag : resource.tags) {
+            insertPosting(tagIndex[tag], id);
+        }
+        insertPosting(uploaderIndex[resource.uploader], id);
+        for (std::size_t c = 0; c < std::size(kRangeColumns); ++c) {
+            ranges[c].push_back(BPlusTree::Entry{rangeKey(kRangeColumns[c], id), id});
+        }
+    }
+    for (const auto& [term, entry] : invertedIndex) {
+        vocabulary.add(term);
+    }
+    // Bulk-loaded, so the leaves are packed
+    for (std::size_t c = 0; c < std::size(kRangeColumns); ++c) {
+        rangeOrder(kRangeColumns[c]).assign(std::move(ranges[c]));
+    }
+}
+
+void ResourceIndex::replay(const std::vector<ResourceEvent>& events) {
+    for (const auto& event : events) {
+        if (event.lsn <= appliedLsn) continue;
+        switch (event.type) {
+            case ResourceEventType::Upsert:
+                addResource(event.resource);
+                break;
+            case ResourceEventType::Remove:
+                removeResource(event.resource.filename);
+                break;
+            case ResourceEventType::Download:
+                incrementDownloadCount(event.resource.filename);
+                break;
+            case ResourceEventType::Relate:
+                addResourceRelationship(event.resource.filename, event.other);
+                break;
+        }
+        appliedLsn = event.lsn;
+    }
+}
+
+bool ResourceIndex::openPersistent(const std::string& snapshotPath, const std::string& root,
+                                   BulkIndexStats* rebuilt, const std::vector<ResourceEvent>& logged) {
+    if (loadSnapshot(snapshotPath)) {
+        replay(logged);
+        // Removals from the last session may have left enough tombstones
+        maybeCompact();
+        return true;
+    }
+    
+    // Stale or unreadable
+    BulkIndexStats stats = rebuildPersistent(snapshotPath, root, 0, logged);
+    if (rebuilt) *rebuilt = stats;
+    return false;
+}
+
+BulkIndexStats ResourceIndex::rebuildPersistent(const std::string& snapshotPath, const std::string& root,
+                                                std::size_t threads, const std::vector<ResourceEvent>& logged) {
+    // Counts, ratings and uploaders logged since the snapshot are carried
+    // over like the snapshot's own
+    ResourceIndex previous;
+    bool havePrevious = previous.loadSnapshot(snapshotPath, true);
+    previous.replay(logged);
+    havePrevious = havePrevious || previous.size() > 0;
+    
+    // The walk records directory mtimes, so the tree is not listed a second time
+    TreeFingerprint tree;
+    BulkIndexStats stats = rebuildFromTree(root, havePrevious ? &previous : nullptr, &tree, threads);
+    appliedLsn = std::max(appliedLsn, previous.appliedLsn);
+    saveSnapshot(snapshotPath, tree);
+    return stats;
+}
+
+// ============================================================================
+// Range Queries
+// ============================================================================
+
+ResourceIndex::RangePage ResourceIndex::rangePage(RangeColumn column, BPlusTree::Key low, BPlusTree::Key high,
+                                                  std::size_t limit, bool descending, const RangeCursor* after) {
+    pollCompaction();
+    RangePage page;
+    if (limit == 0 || low > high) return page;
+    
+    // Start at the near end of the range, or at the cursor's resource. Ids
+    // change on compaction, so the cursor names the resource; if it is gone,
+    // the scan restarts at its key (others sharing the key may show again).
+    BPlusTree::Key startKey = descending ? high : low;
+    DocId startId = descending ? BPlusTree::kMaxId : 0;
+    std::optional<DocId> skip;
+    if (after && after->key >= low && after->key <= high) {
+        startKey = after->key;
+        auto id = store.find(after->filename);
+        if (id && rangeKey(column, *id) == after->key) {
+            startId = *id;
+            skip = *id;
+        }
+    }
+    
+    std::vector<DocId> ids;
+    BPlusTree::Entry last{};
+    bool more = false;
+    auto visit = [&](const BPlusTree::Entry& entry) {
+        if (descending ? entry.key < low : entry.key > high) return false;
+        if (skip && entry.id == *skip && entry.key == startKey) return true;
+        if (ids.size() == limit) {
+            more = true;
+            return false;
+        }
+        ids.push_back(entry.id);
+        last = entry;
+        return true;
+    };
+    const BPlusTree& order = rangeOrder(column);
+    if (descending) {
+        order.scanDown(startKey, startId, visit);
+    } else {
+        order.scanUp(startKey, startId, visit);
+    }
+    
+    // The trees hold live ids only
+    page.resources = materialize(ids);
+    if (more) page.next = RangeCursor{last.key, store.filename(last.id)};
+    return page;
+}
+
+// ============================================================================
+// Tombstones and Compaction
+// ============================================================================
+
+void ResourceIndex::tombstone(DocId id) {
+    const std::string& name = store.displayName(id);
+    auto uses = displayNameCounts.find(name);
+    bool lastUse = uses == displayNameCounts.end() || --uses->second == 0;
+    resourceNameAutocomplete.lower(name, store.downloadCount(id), lastUse);
+    if (lastUse && uses != displayNameCounts.end()) displayNameCounts.erase(uses);
+    
+    popularResources.erase(id);
+    facets.remove(id, facetsFromPath(store.filename(id)));
+    for (auto column : kRangeColumns) rangeOrder(column).erase(rangeKey(column, id), id);
+    collectionStats.remove(fieldLengths[id]);
+    store.remove(id);
+}
+
+void ResourceIndex::maybeCompact() {
+    if (compaction.valid() || store.deadSize() == 0) return;
+    if (store.deadSize() <= kMaxDeadRatio * store.size()) return;
+    
+    // Graph edges are copied here, since the graph is not safe to share
+    std::vector<Graph<DocId>::Edge> edges;
+    for (const auto& edge : resourceGraph.getEdges()) {
+        if (store.isLive(edge.from) && store.isLive(edge.to)) edges.push_back(edge);
+    }
+    compaction = std::async(std::launch::async, [this, edges = std::move(edges)]() mutable {
+        return compactLive(std::move(edges));
+    });
+}
+
+// Runs on the compaction task: reads the store, field lengths and postings only
+ResourceIndex::CompactedIndex ResourceIndex::compactLive(std::vector<Graph<DocId>::Edge> edges) const {
+    CompactedIndex result;
+    std::vector<DocId> remap;
+    result.store = store.compacted(remap);
+    
+    result.fieldLengths.reserve(result.store.size());
+    result.signatures.reserve(result.store.size());
+    for (DocId id = 0; id < remap.size(); ++id) {
+        if (remap[id] == ResourceStore::kNoDoc) continue;
+        result.fieldLengths.push_back(fieldLengths[id]);
+        result.signatures.push_back(signatures[id]);
+    }
+    
+    // The remap keeps id order, so every rewritten list is built by appends.
+    // Terms left without live postings are dropped.
+    for (const auto& [term, entry] : invertedIndex) {
+        TermPostings live;
+        for (auto cursor = entry.postings.cursor(); !cursor.atEnd(); cursor.next()) {
+            DocId id = remap[cursor.docId()];
+            if (id != ResourceStore::kNoDoc) live.add(id, unpackFrequencies(cursor.payload()));
+        }
+        if (!live.postings.empty()) result.invertedIndex.emplace(term, std::move(live));
+    }
+    
+    for (auto& edge : edges) {
+        edge.from = remap[edge.from];
+        edge.to = remap[edge.to];
+    }
+    result.edges = std::move(edges);
+    return result;
+}
+
+void ResourceIndex::installCompaction(CompactedIndex compacted) {
+    store = std::move(compacted.store);
+    fieldLengths = std::move(compacted.fieldLengths);
+    signatures = std::move(compacted.signatures);
+    invertedIndex = std::move(compacted.invertedIndex);
+    
+    // Fresh containers, so memory held for dead entries is released
+    resourceBST.clear();
+    resourceNameAutocomplete = RadixTrie();
+    displayNameCounts = {};
+    popularResources = RankedCounter<DocId>();
+    resourceGraph = Graph<DocId>();
+    similarity = SimilarityIndex();
+    facets = FacetIndex();
+    uploadTimeOrder = BPlusTree();
+    sizeOrder = BPlusTree();
+    ratingOrder = BPlusTree();
+    tagIndex = {};
+    uploaderIndex = {};
+    vocabulary = FuzzyVocabulary();
+    rebuildDerivedIndexes();
+    
+    for (const auto& edge : compacted.edges) {
+        resourceGraph.addEdge(edge.from, edge.to, edge.weight);
+    }
+}
 
-}
\ No newline at end of file
+}
@@ -0,0 +1,293 @@
+#include "resource_log.h"
+#include "binary_io.h"
+#include "transfer_journal.h"
+#include <filesystem>
+#include <system_error>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace uni {
+
+// ============================================================================
+// Resource Events
+// ============================================================================
+
+ResourceEvent ResourceEvent::upsert(const ResourceMetadata& resource) {
+    ResourceEvent event;
+    event.type = ResourceEventType::Upsert;
+    event.resource = resource;
+    return event;
+}
+
+ResourceEvent ResourceEvent::remove(const std::string& filename) {
+    ResourceEvent event;
+    event.type = ResourceEventType::Remove;
+    event.resource.filename = filename;
+    return event;
+}
+
+ResourceEvent ResourceEvent::download(const std::string& filename) {
+    ResourceEvent event;
+    event.type = ResourceEventType::Download;
+    event.resource.filename = filename;
+    return event;
+}
+
+ResourceEvent ResourceEvent::relate(const std::string& first, const std::string& second) {
+    ResourceEvent event;
+    event.type = ResourceEventType::Relate;
+    event.resource.filename = first;
+    event.other = second;
+    return event;
+}
+
+namespace {
+
+constexpr char kLogMagic[8] = {'U', 'N', 'I', 'H', 'U', 'B', 'W', 'L'};
+constexpr std::uint32_t kLogVersion = 1;
+constexpr std::size_t kLogHeaderSize = sizeof(kLogMagic) + sizeof(std::uint32_t);
+constexpr std::size_t kRecordHeaderSize = 2 * sizeof(std::uint32_t);
+
+std::string encodeEvent(const ResourceEvent& event) {
+    BinaryWriter out;
+    out.put<std::uint64_t>(event.lsn);
+    out.put(event.type);
+    const auto& resource = event.resource;
+    out.putString(resource.filename);
+    if (event.type == ResourceEventType::Relate) out.putString(event.other);
+    if (event.type != ResourceEventType::Upsert) return out.data();
+
+    out.putString(resource.displayName);
+    out.putString(resource.filePath);
+    out.putString(resource.resourceType);
+    out.putString(resource.subject);
+    out.putString(resource.uploader);
+    out.put<std::uint64_t>(resource.sizeBytes);
+    out.put<std::int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        resource.uploadTime.time_since_epoch()).count());
+    out.put<std::int32_t>(resource.downloadCount);
+    out.put<double>(resource.rating);
+    out.putStrings(resource.tags);
+    return out.data();
+}
+
+bool decodeEvent(const char* data, std::size_t size, ResourceEvent& event) {
+    BinaryReader in(data, size);
+    event.lsn = in.get<std::uint64_t>();
+    event.type = in.get<ResourceEventType>();
+    auto& resource = event.resource;
+    resource.filename = in.getString();
+    switch (event.type) {
+        case ResourceEventType::Upsert:
+            resource.displayName = in.getString();
+            resource.filePath = in.getString();
+            resource.resourceType = in.getString();
+            resource.subject = in.getString();
+            resource.uploader = in.getString();
+            resource.sizeBytes = static_cast<std::size_t>(in.get<std::uint64_t>());
+            resource.uploadTime = std::chrono::system_clock::time_point(
+                std::chrono::duration_cast<std::chrono::system_clock::duration>(
+                    std::chrono::nanoseconds(in.get<std::int64_t>())));
+            resource.downloadCount = in.get<std::int32_t>();
+            resource.rating = in.get<double>();
+            resource.tags = in.getStrings();
+            break;
+        case ResourceEventType::Relate:
+            event.other = in.getString();
+            break;
+        case ResourceEventType::Remove:
+        case ResourceEventType::Download:
+            break;
+        default:
+            return false;
+    }
+    return in.ok() && in.atEnd();
+}
+
+std::string frame(const std::string& payload) {
+    BinaryWriter out;
+    out.put<std::uint32_t>(static_cast<std::uint32_t>(payload.size()));
+    out.put<std::uint32_t>(crc32c(payload.data(), payload.size()));
+    out.putBytes(payload.data(), payload.size());
+    return out.data();
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+}
+
+ResourceLog::~ResourceLog() {
+    if (committer.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        queued.notify_all();
+        committer.join();
+    }
+    if (fd >= 0) ::close(fd);
+}
+
+bool ResourceLog::open(std::vector<ResourceEvent>& events) {
+    events.clear();
+    std::error_code ec;
+    fs::create_directories(fs::path(path).parent_path(), ec);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    std::string content;
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = ::pread(fd, buffer, sizeof(buffer), static_cast<off_t>(content.size()))) > 0) {
+        content.append(buffer, static_cast<std::size_t>(n));
+    }
+
+    // Intact records up to the first torn one; a foreign file starts over
+    std::size_t end = 0;
+    if (content.size() >= kLogHeaderSize && std::memcmp(content.data(), kLogMagic, sizeof(kLogMagic)) == 0) {
+        BinaryReader header(content.data() + sizeof(kLogMagic), sizeof(std::uint32_t));
+        if (header.get<std::uint32_t>() == kLogVersion) end = kLogHeaderSize;
+    }
+    if (end > 0) {
+        BinaryReader in(content.data() + end, content.size() - end);
+        while (in.remaining() >= kRecordHeaderSize) {
+            auto length = in.get<std::uint32_t>();
+            auto crc = in.get<std::uint32_t>();
+            const char* payload = in.take(length);
+            ResourceEvent event;
+            if (!payload || crc32c(payload, length) != crc || !decodeEvent(payload, length, event)) break;
+            nextLsn = std::max(nextLsn, event.lsn + 1);
+            events.push_back(std::move(event));
+            end += kRecordHeaderSize + length;
+        }
+    }
+    if (::ftruncate(fd, static_cast<off_t>(end)) != 0) return false;
+    if (end == 0) {
+        BinaryWriter header;
+        header.putBytes(kLogMagic, sizeof(kLogMagic));
+        header.put<std::uint32_t>(kLogVersion);
+        if (!writeAll(fd, header.data().data(), header.size()) || ::fdatasync(fd) != 0) return false;
+        end = header.size();
+    }
+    logBytes = end;
+    writtenBytes = end;
+    durableLsn = nextLsn - 1;
+    committer = std::thread(&ResourceLog::commitLoop, this);
+    return true;
+}
+
+void ResourceLog::continueAfter(std::uint64_t lsn) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (lsn < nextLsn) return;
+    nextLsn = lsn + 1;
+    durableLsn = std::max(durableLsn, lsn);
+}
+
+std::uint64_t ResourceLog::append(ResourceEvent event) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0) return 0;
+    event.lsn = nextLsn++;
+    std::string record = frame(encodeEvent(event));
+    logBytes += record.size();
+    pending += record;
+    queued.notify_one();
+    return event.lsn;
+}
+
+void ResourceLog::commitLoop() {
+    std::unique_lock<std::mutex> lock(mutex);
+    while (true) {
+        queued.wait(lock, [this] { return stopping || !pending.empty(); });
+        if (pending.empty()) return;
+        if (failed) {
+            // Retry the failed batch (still at the front of pending) after a
+            // pause; a reset() that dropped it ends the wait early
+            queued.wait_for(lock, kRetryDelay, [this] { return stopping || !failed; });
+            if (stopping && failed) return;
+            if (pending.empty()) continue;
+        } else if (!stopping && !syncRequested) {
+            // Let the rest of a burst join this commit
+            queued.wait_for(lock, kCommitDelay, [this] { return stopping || syncRequested; });
+        }
+
+        std::string batch;
+        batch.swap(pending);
+        std::uint64_t upTo = nextLsn - 1;
+        syncRequested = false;
+        writing = true;
+        lock.unlock();
+        // Part of a failed batch may be in the file; open() would stop at it
+        // and drop every later record, so it is cut off before the retry
+        if (torn) torn = ::ftruncate(fd, static_cast<off_t>(writtenBytes)) != 0;
+        bool written = !torn && writeAll(fd, batch.data(), batch.size()) && ::fdatasync(fd) == 0;
+        if (written) {
+            writtenBytes += batch.size();
+        } else if (!torn) {
+            torn = ::ftruncate(fd, static_cast<off_t>(writtenBytes)) != 0;
+        }
+        lock.lock();
+        writing = false;
+        if (written) {
+            durableLsn = std::max(durableLsn, upTo);
+            failed = false;
+        } else {
+            // Events appended meanwhile stay behind the batch, in LSN order
+            pending.insert(0, batch);
+            failed = true;
+        }
+        committed.notify_all();
+    }
+}
+
+bool ResourceLog::sync() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (fd < 0) return false;
+    std::uint64_t target = nextLsn - 1;
+    if (durableLsn >= target) return !failed;
+    syncRequested = true;
+    queued.notify_one();
+    committed.wait(lock, [this, target] { return durableLsn >= target || failed; });
+    return !failed;
+}
+
+bool ResourceLog::reset() {
+    std::unique_lock<std::mutex> lock(mutex);
+    if (fd < 0) return false;
+    // Queued records are covered by the snapshot too. A batch being written
+    // is let finish, so the truncation cannot cut a record in half.
+    committed.wait(lock, [this] { return !writing; });
+    pending.clear();
+    durableLsn = nextLsn - 1;
+    failed = false;
+    queued.notify_all();
+    if (::ftruncate(fd, static_cast<off_t>(kLogHeaderSize)) != 0) return false;
+    torn = false;
+    logBytes = kLogHeaderSize;
+    writtenBytes = kLogHeaderSize;
+    committed.notify_all();
+    return true;
+}
+
+bool ResourceLog::failing() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return failed;
+}
+
+std::uint64_t ResourceLog::size() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return logBytes;
+}
+
+}
@@ -3,15 +3,20 @@
 
     This source file implements resource management functions for the UniHub-CLI application.
     It provides functionality to list files in resource folders, upload files to resource
-    directories, and download files from resource storage. These operations interact with
-    the file system to facilitate sharing and accessing academic resources.
+    directories, download files from resource storage, and delete stored files. These
+    operations interact with the file system to facilitate sharing and accessing academic
+    resources. File contents go through the deduplicating chunk store, and listings come
+    from the inotify-maintained resource catalog when it is available.
 */
 
 #include "resources.h"      // Include resource management interface
 #include "storage.h"        // Include file and directory utility functions
+#include "chunk_store.h"    // Include the deduplicating chunk store
+#include "resource_catalog.h" // Include the in-memory catalog of the resource tree
 #include <filesystem>       // Include filesystem operations
 #include <fstream>          // Include file stream operations
 #include <iostream>         // Include input/output stream operations
+#include <system_error>     // Include error_code for non-throwing removal
 
 using namespace std; // Allows usage of standard library types without std:: prefix
 
@@ -22,10 +27,14 @@ namespace uni { // Begin namespace uni
 // Lists all resource files in the specified folder
 vector<ResourceItem> listResources(const string& folder) {
     vector<ResourceItem> items; // Vector to store resource items
+    if (auto files = resourceCatalog().list(folder)) { // Answered from memory while the tree is watched
+        for (auto& file : *files) items.push_back(ResourceItem{file.path, file.name, static_cast<size_t>(file.sizeBytes)}); // Add resource item
+        return items; // Return list of resources
+    }
     try {
         for (auto& p : fs::directory_iterator(folder)) { // Iterate over files in folder
             if (!p.is_regular_file()) continue; // Skip non-regular files
-            auto sz = fs::file_size(p.path()); // Get file size
+            auto sz = ChunkStore::storedSize(p.path().string()).value_or(0); // Logical size (manifests name their file's size)
             items.push_back(ResourceItem{p.path().string(), p.path().filename().string(), sz}); // Add resource item
         }
     } catch (...) {} // Ignore exceptions (e.g., folder not found)
@@ -33,11 +42,15 @@ vector<ResourceItem> listResources(const string& folder) {
 }
 
 // Uploads a local file to the specified resource folder
-pair<bool,string> uploadResource(const string& localPath, const string& folder) {
+pair<bool,string> uploadResource(const string& localPath, const string& folder, const TransferCallback& progress,
+                                 string* duplicateOf) {
     try {
-        ensureDir(folder); // Ensure destination folder exists
+        resourceCatalog().ensureFolder(folder); // Ensure destination folder exists (known folders skip the filesystem)
         string dst = folder + "/" + fs::path(localPath).filename().string(); // Build destination path
-        if (!copyFile(localPath, dst)) return {false, "Copy failed"}; // Copy file, check for failure
+        ChunkStoreStats stats; // Also names an earlier copy of the same contents
+        auto error = ChunkStore(chunksDir()).store(localPath, dst, &stats, progress); // Write new chunks and the manifest
+        if (error) return {false, *error}; // Return the store's error message
+        if (duplicateOf) *duplicateOf = stats.duplicateOf; // Found from the hash taken while storing
         return {true, dst}; // Return success and destination path
     } catch (...) {
         return {false, "Upload failed"}; // Return failure on exception
@@ -45,13 +58,22 @@ pair<bool,string> uploadResource(const string& localPath, const string& folder)
 }
 
 // Downloads a file from resource storage to a local destination
-pair<bool,string> downloadResource(const string& storedPath, const string& localDest) {
+pair<bool,string> downloadResource(const string& storedPath, const string& localDest, const TransferCallback& progress) {
     try {
-        if (!copyFile(storedPath, localDest)) return {false, "Copy failed"}; // Copy file, check for failure
+        auto error = ChunkStore(chunksDir()).restore(storedPath, localDest, progress); // Reassemble (and verify) the chunks
+        if (error) return {false, *error}; // Return the store's error message
         return {true, localDest}; // Return success and destination path
     } catch (...) {
         return {false, "Download failed"}; // Return failure on exception
     }
 }
 
+// Deletes a file from resource storage
+pair<bool,string> deleteResource(const string& storedPath) {
+    error_code ec; // Error code instead of exceptions
+    if (!fs::remove(storedPath, ec)) return {false, ec ? ec.message() : "File not found"}; // Nothing removed
+    ChunkStore(chunksDir()).markForSweep(); // Its chunks may now be unreferenced
+    return {true, storedPath}; // Return success and deleted path
+}
+
 } // End namespace uni
@@ -3,7 +3,8 @@
 
     This source file implements file and directory utility functions for the UniHub-CLI application.
     It provides operations for managing data and resource directories, reading and writing text files,
-    listing files in directories, and copying files. These functions abstract the underlying file system
+    listing files in directories, and copying files (reflink, copy_file_range, sendfile or an aligned
+    buffered fallback, with drop-behind page cache eviction). These functions abstract the underlying file system
     interactions required for persistent storage and resource management.
 */
 
@@ -13,6 +14,18 @@
 #include <iostream>          // Include input/output stream operations
 #include <optional>          // Include optional type for return values
 #include <vector>            // Include vector type for dynamic arrays
+#include <chrono>            // Include steady_clock for transfer timing
+#include <algorithm>         // Include min() for step sizes
+#include <atomic>            // Include atomic counter for temporary file names
+#include <cerrno>            // Include errno for system call failures
+#include <cstdlib>           // Include aligned_alloc()/free()
+#include <fcntl.h>           // Include open() for file mapping
+#include <sys/mman.h>        // Include mmap()/munmap()
+#include <sys/stat.h>        // Include fstat() for file sizes
+#include <sys/ioctl.h>       // Include ioctl() for reflinks
+#include <sys/sendfile.h>    // Include sendfile()
+#include <linux/fs.h>        // Include FICLONE
+#include <unistd.h>          // Include close(), read(), write(), copy_file_range()
 
 using namespace std; // Allows usage of standard library types without std:: prefix
 
@@ -28,6 +41,14 @@ string resourcesDir() {
     return dataDir() + string("/resources"); // Returns the resources directory path
 }
 
+string indexDir() {
+    return dataDir() + string("/index"); // Returns the persistent index directory path
+}
+
+string chunksDir() {
+    return dataDir() + string("/chunks"); // Returns the chunk store directory path
+}
+
 bool ensureDir(const string& path) {
     try {
         fs::create_directories(path); // Creates the directory and any parent directories if needed
@@ -43,12 +64,37 @@ optional<string> readTextFile(const string& path) {
 }
 
 optional<string> writeTextFile(const string& path, const string& content) {
-    ofstream out(path); // Open file for writing
-    if (!out) return optional<string>("Failed to write: " + path); // Return error message if file can't be opened
-    out << content; // Write content to file
+    if (!replaceFile(path, content.data(), content.size())) return optional<string>("Failed to write: " + path); // Return error message if the file can't be replaced
     return nullopt; // Return nullopt on success
 }
 
+bool replaceFile(const string& path, const char* data, size_t size, bool durable) {
+    static atomic<uint64_t> replacements{0}; // Makes temporary names unique within the process
+    fs::path parent = fs::path(path).parent_path(); // Directory holding the file
+    string tmp = path + ".tmp" + to_string(::getpid()) + "." + to_string(++replacements); // Temporary file beside the target
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); // Create the temporary file
+    if (fd < 0) return false; // Fail if it can't be created
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size); // Write the next piece
+        if (n <= 0) break; // Stop on error
+        data += n; // Advance past the written bytes
+        size -= static_cast<size_t>(n); // Count them off
+    }
+    bool written = size == 0 && (!durable || ::fdatasync(fd) == 0); // The data must be on disk before the rename
+    ::close(fd); // Close the temporary file
+    if (!written || ::rename(tmp.c_str(), path.c_str()) != 0) { // Move it over the target
+        ::unlink(tmp.c_str()); // Leave nothing behind on failure
+        return false;
+    }
+    if (!durable) return true; // The caller flushes later
+    int dir = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC); // Open the directory
+    if (dir >= 0) {
+        ::fsync(dir); // Make the rename itself durable
+        ::close(dir); // Close the directory
+    }
+    return true; // Success
+}
+
 vector<string> listFiles(const string& path) {
     vector<string> result; // Vector to store filenames
     try {
@@ -59,12 +105,192 @@ vector<string> listFiles(const string& path) {
     return result; // Return list of filenames
 }
 
-bool copyFile(const string& src, const string& dst) {
-    try {
-        ensureDir(fs::path(dst).parent_path().string()); // Ensure destination directory exists
-        fs::copy_file(src, dst, fs::copy_options::overwrite_existing); // Copy file, overwrite if exists
+namespace { // Helpers for copyFile
+
+const uint64_t kTransferStep = 8ull << 20;     // Bytes per copy step (progress and eviction granularity)
+const uint64_t kDropBehindBytes = 64ull << 20; // Files this large are evicted from the page cache behind the copy
+const size_t kBufferSize = 1 << 20;            // Buffer size for the buffered fallback
+const size_t kBufferAlignment = 4096;          // Page-aligned buffer, as the kernel copies whole pages
+
+// Closes a file descriptor when it goes out of scope
+struct FileDescriptor {
+    int fd; // Descriptor, or -1
+    explicit FileDescriptor(int f) : fd(f) {}
+    ~FileDescriptor() { if (fd >= 0) ::close(fd); } // Close on scope exit
+    FileDescriptor(const FileDescriptor&) = delete;
+    FileDescriptor& operator=(const FileDescriptor&) = delete;
+};
+
+// Follows a running copy: reports progress and, for large files, starts writeback of each new step
+// and evicts the step before it from the page cache on both sides
+class TransferTracker {
+public:
+    TransferTracker(int in, int out, uint64_t total, const TransferCallback& progress)
+        : in(in), out(out), total(total), dropBehind(total >= kDropBehindBytes), progress(progress),
+          started(chrono::steady_clock::now()) {}
+
+    void setMethod(const char* name) { method = name; } // Names the copy method in progress reports
+
+    void advance(uint64_t done) {
+        if (dropBehind && done > written) {
+            sync_file_range(out, written, done - written, SYNC_FILE_RANGE_WRITE); // Start writeback of the new step
+            if (written > evicted) evict(written); // The previous step has had a step's time to reach the disk
+            written = done; // Remember where the next step starts
+        }
+        report(done); // Tell the caller
+    }
+
+    void finish(uint64_t done) {
+        if (dropBehind) {
+            evict(done); // Waits for the tail's writeback, then drops it
+            posix_fadvise(in, 0, 0, POSIX_FADV_DONTNEED); // Drop anything left of the source
+        }
+        report(done); // Final report
+    }
+
+private:
+    void evict(uint64_t end) {
+        sync_file_range(out, evicted, end - evicted,
+                        SYNC_FILE_RANGE_WAIT_BEFORE | SYNC_FILE_RANGE_WRITE | SYNC_FILE_RANGE_WAIT_AFTER); // Pages must be clean
+        posix_fadvise(out, evicted, end - evicted, POSIX_FADV_DONTNEED); // Evict the written range
+        posix_fadvise(in, evicted, end - evicted, POSIX_FADV_DONTNEED); // Evict the read range
+        evicted = end; // Everything before end is out of the cache
+    }
+
+    void report(uint64_t done) {
+        if (!progress) return; // Nobody is listening
+        chrono::duration<double> elapsed = chrono::steady_clock::now() - started; // Time so far
+        progress(TransferProgress{done, total, elapsed.count(), method}); // Report
+    }
+
+    int in, out;                        // Source and destination descriptors
+    uint64_t total;                     // Source size
+    bool dropBehind;                    // Whether to evict pages behind the copy
+    const TransferCallback& progress;   // Progress callback (may be empty)
+    chrono::steady_clock::time_point started; // Start of the transfer
+    const char* method = "";            // Current copy method
+    uint64_t written = 0;               // End of the range whose writeback was started
+    uint64_t evicted = 0;               // End of the range evicted from the page cache
+};
+
+// Errors meaning "this copy method is not available here", so the next one is tried
+bool unsupported(int error) {
+    return error == EXDEV || error == EINVAL || error == ENOSYS || error == EOPNOTSUPP || error == ENOTSUP || error == EBADF;
+}
+
+// Copies with copy_file_range (in-kernel, server-side on network filesystems). Returns the bytes
+// copied, or -1 if the method is unsupported before anything was copied
+int64_t copyWithRange(int in, int out, uint64_t total, TransferTracker& tracker) {
+    uint64_t done = 0; // Bytes copied so far
+    while (done < total) {
+        ssize_t n = copy_file_range(in, nullptr, out, nullptr, min(kTransferStep, total - done), 0); // Copy one step
+        if (n < 0 && errno == EINTR) continue; // Interrupted, retry
+        if (n < 0) return done == 0 && unsupported(errno) ? -1 : static_cast<int64_t>(done); // Fall back or stop
+        if (n == 0) break; // Source ended early
+        done += static_cast<uint64_t>(n); // Count copied bytes
+        tracker.advance(done); // Report and evict
+    }
+    return static_cast<int64_t>(done); // Bytes copied
+}
+
+// Copies with sendfile (in-kernel, one pass through the page cache). Same contract as copyWithRange
+int64_t copyWithSendfile(int in, int out, uint64_t total, TransferTracker& tracker) {
+    uint64_t done = 0; // Bytes copied so far
+    while (done < total) {
+        ssize_t n = sendfile(out, in, nullptr, min(kTransferStep, total - done)); // Copy one step
+        if (n < 0 && errno == EINTR) continue; // Interrupted, retry
+        if (n < 0) return done == 0 && unsupported(errno) ? -1 : static_cast<int64_t>(done); // Fall back or stop
+        if (n == 0) break; // Source ended early
+        done += static_cast<uint64_t>(n); // Count copied bytes
+        tracker.advance(done); // Report and evict
+    }
+    return static_cast<int64_t>(done); // Bytes copied
+}
+
+// Copies through a page-aligned user-space buffer (works everywhere). Returns the bytes copied, or -1 on error
+int64_t copyBuffered(int in, int out, TransferTracker& tracker) {
+    void* buffer = aligned_alloc(kBufferAlignment, kBufferSize); // Page-aligned buffer
+    if (!buffer) return -1; // Out of memory
+    posix_fadvise(in, 0, 0, POSIX_FADV_SEQUENTIAL); // Read ahead aggressively
+    uint64_t done = 0; // Bytes copied so far
+    uint64_t reported = 0; // Bytes copied at the last report
+    bool failed = false; // Whether a read or write failed
+    while (!failed) {
+        ssize_t n = ::read(in, buffer, kBufferSize); // Read the next block
+        if (n < 0 && errno == EINTR) continue; // Interrupted, retry
+        if (n <= 0) { failed = n < 0; break; } // End of file or error
+        for (ssize_t off = 0; off < n && !failed;) {
+            ssize_t w = ::write(out, static_cast<char*>(buffer) + off, static_cast<size_t>(n - off)); // Write what was read
+            if (w < 0 && errno == EINTR) continue; // Interrupted, retry
+            if (w < 0) failed = true; // Write error (e.g. disk full)
+            else off += w; // Count written bytes
+        }
+        done += static_cast<uint64_t>(n); // Count copied bytes
+        if (done - reported >= kTransferStep) { tracker.advance(done); reported = done; } // Report once per step
+    }
+    free(buffer); // Release the buffer
+    return failed ? -1 : static_cast<int64_t>(done); // Bytes copied, or failure
+}
+
+} // End of copyFile helpers
+
+bool copyFile(const string& src, const string& dst, const TransferCallback& progress) {
+    FileDescriptor in(::open(src.c_str(), O_RDONLY | O_CLOEXEC)); // Open the source
+    if (in.fd < 0) return false; // Source missing or unreadable
+    struct stat srcInfo{};
+    if (fstat(in.fd, &srcInfo) != 0 || !S_ISREG(srcInfo.st_mode)) return false; // Only regular files are copied
+    struct stat dstInfo{};
+    if (::stat(dst.c_str(), &dstInfo) == 0 && dstInfo.st_dev == srcInfo.st_dev && dstInfo.st_ino == srcInfo.st_ino) {
+        return false; // Same file: truncating dst would destroy src
+    }
+
+    ensureDir(fs::path(dst).parent_path().string()); // Ensure destination directory exists
+    FileDescriptor out(::open(dst.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)); // Create or overwrite dst
+    if (out.fd < 0) return false; // Destination not writable
+
+    uint64_t total = static_cast<uint64_t>(srcInfo.st_size); // Bytes to copy
+    TransferTracker tracker(in.fd, out.fd, total, progress); // Progress and cache eviction
+
+    // Reflink: the copy shares the source's extents (Btrfs, XFS, bcachefs), so no data moves
+    if (total > 0 && ioctl(out.fd, FICLONE, in.fd) == 0) {
+        tracker.setMethod("reflink"); // Report the method
+        tracker.finish(total); // Done in one step
         return true; // Return true on success
-    } catch (...) { return false; } // Return false on exception
+    }
+
+    tracker.setMethod("copy_file_range"); // Try the in-kernel copy first
+    int64_t copied = copyWithRange(in.fd, out.fd, total, tracker); // Copy without user-space buffers
+    if (copied < 0) {
+        tracker.setMethod("sendfile"); // Older kernels and some filesystem pairs
+        copied = copyWithSendfile(in.fd, out.fd, total, tracker); // Copy through the page cache only
+    }
+    if (copied < 0) {
+        tracker.setMethod("buffered"); // Last resort
+        copied = copyBuffered(in.fd, out.fd, tracker); // Copy through an aligned buffer
+    }
+    if (copied < 0 || static_cast<uint64_t>(copied) != total) return false; // Failed or short copy
+    tracker.finish(total); // Final report and eviction
+    return true; // Return true on success
+}
+
+void dropCachedPages(const string& path) {
+    FileDescriptor file(::open(path.c_str(), O_RDONLY | O_CLOEXEC)); // Open the file
+    if (file.fd >= 0) posix_fadvise(file.fd, 0, 0, POSIX_FADV_DONTNEED); // Evict its clean pages
+}
+
+shared_ptr<const MappedFile> MappedFile::open(const string& path) {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC); // Open file read-only
+    if (fd < 0) return nullptr; // Return nullptr if file can't be opened
+    struct stat st{};
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) { ::close(fd); return nullptr; } // Empty or unreadable files can't be mapped
+    void* addr = mmap(nullptr, static_cast<size_t>(st.st_size), PROT_READ, MAP_PRIVATE, fd, 0); // Map the whole file
+    ::close(fd); // The mapping stays valid after the descriptor is closed
+    if (addr == MAP_FAILED) return nullptr; // Return nullptr if mapping failed
+    return shared_ptr<const MappedFile>(new MappedFile(static_cast<const char*>(addr), static_cast<size_t>(st.st_size)));
+}
+
+MappedFile::~MappedFile() {
+    munmap(const_cast<char*>(base), length); // Release the mapping
 }
 
 } // End namespace uni
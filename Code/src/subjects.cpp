@@ -9,6 +9,7 @@
 
 #include "subjects.h"     // Include subject/resource type interface
 #include "storage.h"      // Include storage utility functions
+#include "resource_catalog.h" // Include the resource catalog (cached folder checks)
 #include <map>            // Include map container for subject pools
 #include <vector>         // Include vector container for lists
 #include <string>         // Include string type
@@ -92,7 +93,7 @@ vector<Subject> getSubjects(int year, int semester, const string& branch, char s
 // Builds and returns the directory path for storing resources of a specific subject and type
 string resourcesBase(int year, int semester, const string& branch, char section, const string& subjectName, const string& type) {
     string base = resourcesDir() + "/" + to_string(year) + "/" + to_string(semester) + "/" + branch + "/" + section + "/" + subjectName + "/" + type; // Build directory path
-    ensureDir(base); // Ensure directory exists
+    resourceCatalog().ensureFolder(base); // Ensure directory exists (skips the filesystem for known folders)
     return base; // Return directory path
 }
 
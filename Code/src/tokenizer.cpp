@@ -0,0 +1,254 @@
+#include "tokenizer.h"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace uni {
+
+namespace {
+
+// ASCII bytes that belong inside a term
+constexpr std::array<bool, 128> kAsciiTermByte = [] {
+    std::array<bool, 128> table{};
+    for (int c = '0'; c <= '9'; ++c) table[c] = true;
+    for (int c = 'a'; c <= 'z'; ++c) table[c] = true;
+    for (int c = 'A'; c <= 'Z'; ++c) table[c] = true;
+    return table;
+}();
+
+constexpr char32_t kInvalid = 0xFFFFFFFF;
+
+// Decodes one UTF-8 sequence at data (first byte >= 0x80), rejecting overlong
+// forms, surrogates and truncated input. length receives the bytes consumed.
+char32_t decodeUtf8(const unsigned char* data, std::size_t size, std::size_t& length) {
+    length = 1;
+    unsigned char lead = data[0];
+    std::size_t extra;
+    char32_t cp;
+    if (lead >= 0xC2 && lead <= 0xDF) { extra = 1; cp = lead & 0x1F; }
+    else if (lead >= 0xE0 && lead <= 0xEF) { extra = 2; cp = lead & 0x0F; }
+    else if (lead >= 0xF0 && lead <= 0xF4) { extra = 3; cp = lead & 0x07; }
+    else return kInvalid;
+
+    if (size < extra + 1) return kInvalid;
+    for (std::size_t i = 1; i <= extra; ++i) {
+        if ((data[i] & 0xC0) != 0x80) return kInvalid;
+        cp = (cp << 6) | (data[i] & 0x3F);
+    }
+    if ((extra == 2 && cp < 0x800) || (extra == 3 && (cp < 0x10000 || cp > 0x10FFFF))) return kInvalid;
+    if (cp >= 0xD800 && cp <= 0xDFFF) return kInvalid;
+    length = extra + 1;
+    return cp;
+}
+
+void appendUtf8(std::string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+        out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+        out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+        out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+        out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+}
+
+bool inRange(char32_t cp, char32_t first, char32_t last) { return cp >= first && cp <= last; }
+
+}
+
+// ============================================================================
+// Unicode Classification
+// ============================================================================
+
+char32_t foldCase(char32_t cp) {
+    if (cp < 0x80) return (cp >= 'A' && cp <= 'Z') ? cp + 0x20 : cp;
+    if (cp >= 0x590 && cp < 0x1E00) return cp;   // Hebrew to Mongolian, all Indic scripts: no case
+
+    // Latin-1 Supplement and Latin Extended-A
+    if (inRange(cp, 0xC0, 0xDE) && cp != 0xD7) return cp + 0x20;
+    if (cp == 0xB5) return 0x3BC;   // Micro sign folds to Greek mu
+    if (cp < 0x100) return cp;
+    if (cp == 0x130 || cp == 0x131) return cp;   // Dotted/dotless i only fold in Turkic locales
+    if (inRange(cp, 0x100, 0x137) || inRange(cp, 0x14A, 0x177)) return cp | 1;
+    if (inRange(cp, 0x139, 0x148) || inRange(cp, 0x179, 0x17E)) return (cp & 1) ? cp + 1 : cp;
+    if (cp == 0x178) return 0xFF;
+    if (cp < 0x370) return cp;
+
+    // Greek (final sigma folds to sigma)
+    if (inRange(cp, 0x391, 0x3AB) && cp != 0x3A2) return cp + 0x20;
+    if (cp == 0x386) return 0x3AC;
+    if (inRange(cp, 0x388, 0x38A)) return cp + 0x25;
+    if (cp == 0x38C) return 0x3CC;
+    if (cp == 0x38E || cp == 0x38F) return cp + 0x3F;
+    if (cp == 0x3C2) return 0x3C3;
+    if (cp < 0x400) return cp;
+
+    // Cyrillic
+    if (inRange(cp, 0x400, 0x40F)) return cp + 0x50;
+    if (inRange(cp, 0x410, 0x42F)) return cp + 0x20;
+    if (inRange(cp, 0x460, 0x481) || inRange(cp, 0x48A, 0x4BF) || inRange(cp, 0x4D0, 0x52F)) return cp | 1;
+    if (cp == 0x4C0) return 0x4CF;
+    if (inRange(cp, 0x4C1, 0x4CE)) return (cp & 1) ? cp + 1 : cp;
+
+    // Armenian
+    if (inRange(cp, 0x531, 0x556)) return cp + 0x30;
+    if (cp < 0x1E00) return cp;
+
+    // Latin Extended Additional (capital sharp s folds to sharp s)
+    if (inRange(cp, 0x1E00, 0x1E95) || inRange(cp, 0x1EA0, 0x1EFF)) return cp | 1;
+    if (cp == 0x1E9E) return 0xDF;
+
+    // Letterlike symbols and fullwidth Latin
+    if (cp == 0x212A) return 'k';
+    if (cp == 0x212B) return 0xE5;
+    if (inRange(cp, 0xFF21, 0xFF3A)) return cp + 0x20;
+    return cp;
+}
+
+bool isTermCodePoint(char32_t cp) {
+    if (cp < 0x80) return kAsciiTermByte[cp];
+
+    // Latin-1 punctuation and symbols, keeping ordinal indicators, micro sign
+    // and superscript digits
+    if (cp <= 0xBF) {
+        return cp == 0xAA || cp == 0xB2 || cp == 0xB3 || cp == 0xB5 || cp == 0xB9 || cp == 0xBA;
+    }
+    if (cp < 0x2000) {
+        // Greek through Latin Extended Additional, including the Indic scripts
+        return cp != 0xD7 && cp != 0xF7 && cp != 0x964 && cp != 0x965;   // Devanagari danda
+    }
+    if (inRange(cp, 0x2000, 0x206F)) return false;                  // General punctuation
+    if (inRange(cp, 0x20A0, 0x20CF)) return false;                  // Currency symbols
+    if (inRange(cp, 0x2190, 0x2BFF)) return false;                  // Arrows, math, box drawing, shapes
+    if (inRange(cp, 0x2E00, 0x2E7F)) return false;                  // Supplemental punctuation
+    if (inRange(cp, 0x3000, 0x303F)) return false;                  // CJK punctuation
+    if (inRange(cp, 0xE000, 0xF8FF)) return false;                  // Private use
+    if (inRange(cp, 0xFE30, 0xFE4F) || cp == 0xFEFF) return false;  // CJK compatibility forms, BOM
+    if (inRange(cp, 0xFF01, 0xFF0F) || inRange(cp, 0xFF1A, 0xFF20) ||
+        inRange(cp, 0xFF3B, 0xFF40) || inRange(cp, 0xFF5B, 0xFF65)) return false;   // Fullwidth punctuation
+    if (inRange(cp, 0x1F000, 0x1FAFF)) return false;                // Emoji and pictographs
+    return true;
+}
+
+// ============================================================================
+// Tokenizer
+// ============================================================================
+
+// Consumes whole 16-byte blocks of pure ASCII; returns the bytes consumed
+// (zero when the next block holds a non-ASCII byte or is incomplete)
+std::size_t Tokenizer::scanAsciiBlocks(const char* data, std::size_t size) {
+    std::size_t consumed = 0;
+#if defined(__SSE2__)
+    const __m128i upperLow = _mm_set1_epi8('A' - 1);
+    const __m128i upperHigh = _mm_set1_epi8('Z' + 1);
+    const __m128i lowerLow = _mm_set1_epi8('a' - 1);
+    const __m128i lowerHigh = _mm_set1_epi8('z' + 1);
+    const __m128i digitLow = _mm_set1_epi8('0' - 1);
+    const __m128i digitHigh = _mm_set1_epi8('9' + 1);
+    const __m128i caseBit = _mm_set1_epi8(0x20);
+
+    while (consumed + 16 <= size) {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + consumed));
+        if (_mm_movemask_epi8(block) != 0) break;
+
+        // Every byte is below 0x80 here, so signed compares give the ranges
+        auto within = [&](__m128i low, __m128i high) {
+            return _mm_and_si128(_mm_cmpgt_epi8(block, low), _mm_cmplt_epi8(block, high));
+        };
+        __m128i upper = within(upperLow, upperHigh);
+        __m128i word = _mm_or_si128(_mm_or_si128(upper, within(lowerLow, lowerHigh)), within(digitLow, digitHigh));
+        __m128i lowered = _mm_or_si128(block, _mm_and_si128(upper, caseBit));
+
+        std::size_t base = buffer.size();
+        buffer.resize(base + 16);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(&buffer[base]), lowered);
+
+        // Token starts are word bytes after a separator, ends separators after a word byte
+        std::uint32_t mask = static_cast<std::uint32_t>(_mm_movemask_epi8(word));
+        std::uint32_t previous = ((mask << 1) | (inToken ? 1u : 0u)) & 0xFFFF;
+        std::uint32_t edges = (mask ^ previous) & 0xFFFF;
+        while (edges != 0) {
+            unsigned bit = static_cast<unsigned>(__builtin_ctz(edges));
+            if (mask & (1u << bit)) open(base + bit);
+            else close(base + bit);
+            edges &= edges - 1;
+        }
+        consumed += 16;
+    }
+#else
+    (void)data;
+    (void)size;
+#endif
+    return consumed;
+}
+
+// Consumes one byte or UTF-8 sequence; returns the bytes consumed
+std::size_t Tokenizer::scanCodePoint(const char* data, std::size_t size) {
+    auto byte = static_cast<unsigned char>(data[0]);
+    if (byte < 0x80) {
+        if (kAsciiTermByte[byte]) {
+            if (!inToken) open(buffer.size());
+            buffer.push_back(static_cast<char>(byte >= 'A' && byte <= 'Z' ? byte + 0x20 : byte));
+        } else if (inToken) {
+            close(buffer.size());
+        }
+        return 1;
+    }
+
+    std::size_t length;
+    char32_t cp = decodeUtf8(reinterpret_cast<const unsigned char*>(data), size, length);
+    if (cp == 0x200C || cp == 0x200D) return length;   // Joiners shape Indic words without splitting them
+    if (cp == kInvalid || !isTermCodePoint(cp)) {
+        if (inToken) close(buffer.size());
+        return length;
+    }
+    if (!inToken) open(buffer.size());
+    char32_t folded = foldCase(cp);
+    if (folded == cp) buffer.append(data, length);
+    else appendUtf8(buffer, folded);
+    return length;
+}
+
+const std::vector<std::string_view>& Tokenizer::tokenize(std::string_view text) {
+    buffer.clear();
+    spans.clear();
+    tokens.clear();
+    inToken = false;
+    buffer.reserve(text.size() + 16);
+
+    const char* data = text.data();
+    std::size_t size = text.size();
+    std::size_t pos = 0;
+    while (pos < size) {
+        pos += scanAsciiBlocks(data + pos, size - pos);
+        // Decode up to the end of the block that left the fast path
+        std::size_t blockEnd = std::min(size, pos + 16);
+        while (pos < blockEnd) pos += scanCodePoint(data + pos, size - pos);
+    }
+    if (inToken) close(buffer.size());
+
+    // Views are built last: the buffer may reallocate while folding grows it
+    tokens.reserve(spans.size());
+    for (const auto& [offset, length] : spans) {
+        tokens.emplace_back(buffer.data() + offset, length);
+    }
+    return tokens;
+}
+
+std::vector<std::string> Tokenizer::terms(std::string_view text) {
+    const auto& views = tokenize(text);
+    return std::vector<std::string>(views.begin(), views.end());
+}
+
+}
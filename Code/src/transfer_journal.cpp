@@ -0,0 +1,210 @@
+#include "transfer_journal.h"
+#include "binary_io.h"
+#include <array>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <nmmintrin.h>
+#endif
+
+namespace uni {
+
+// ============================================================================
+// CRC32C
+// ============================================================================
+
+namespace {
+
+constexpr std::uint32_t kCastagnoli = 0x82f63b78;  // Reflected polynomial
+
+// table[k][b]: CRC of byte b followed by k zero bytes
+constexpr std::array<std::array<std::uint32_t, 256>, 8> makeCrcTables() {
+    std::array<std::array<std::uint32_t, 256>, 8> table{};
+    for (std::uint32_t b = 0; b < 256; ++b) {
+        std::uint32_t crc = b;
+        for (int bit = 0; bit < 8; ++bit) crc = (crc >> 1) ^ (kCastagnoli & (0u - (crc & 1)));
+        table[0][b] = crc;
+    }
+    for (std::size_t k = 1; k < 8; ++k) {
+        for (std::size_t b = 0; b < 256; ++b) {
+            table[k][b] = (table[k - 1][b] >> 8) ^ table[0][table[k - 1][b] & 0xff];
+        }
+    }
+    return table;
+}
+
+constexpr auto kCrcTables = makeCrcTables();
+
+std::uint32_t crc32cSoftware(const std::uint8_t* bytes, std::size_t size, std::uint32_t crc) {
+    for (; size >= 8; bytes += 8, size -= 8) {
+        std::uint32_t low, high;
+        std::memcpy(&low, bytes, 4);
+        std::memcpy(&high, bytes + 4, 4);
+        low ^= crc;
+        crc = kCrcTables[7][low & 0xff] ^ kCrcTables[6][(low >> 8) & 0xff] ^
+              kCrcTables[5][(low >> 16) & 0xff] ^ kCrcTables[4][low >> 24] ^
+              kCrcTables[3][high & 0xff] ^ kCrcTables[2][(high >> 8) & 0xff] ^
+              kCrcTables[1][(high >> 16) & 0xff] ^ kCrcTables[0][high >> 24];
+    }
+    while (size--) crc = (crc >> 8) ^ kCrcTables[0][(crc ^ *bytes++) & 0xff];
+    return crc;
+}
+
+#if defined(__x86_64__) && defined(__GNUC__)
+__attribute__((target("sse4.2")))
+std::uint32_t crc32cHardware(const std::uint8_t* bytes, std::size_t size, std::uint32_t crc) {
+    std::uint64_t wide = crc;
+    for (; size >= 8; bytes += 8, size -= 8) {
+        std::uint64_t word;
+        std::memcpy(&word, bytes, sizeof(word));
+        wide = _mm_crc32_u64(wide, word);
+    }
+    crc = static_cast<std::uint32_t>(wide);
+    while (size--) crc = _mm_crc32_u8(crc, *bytes++);
+    return crc;
+}
+
+const bool kHasCrcInstruction = __builtin_cpu_supports("sse4.2");
+#endif
+
+}
+
+std::uint32_t crc32c(const void* data, std::size_t size, std::uint32_t crc) {
+    auto bytes = static_cast<const std::uint8_t*>(data);
+    crc = ~crc;
+#if defined(__x86_64__) && defined(__GNUC__)
+    if (kHasCrcInstruction) return ~crc32cHardware(bytes, size, crc);
+#endif
+    return ~crc32cSoftware(bytes, size, crc);
+}
+
+// ============================================================================
+// Transfer Journal
+// ============================================================================
+
+namespace {
+
+// Layout: magic "UNIHUBTJ", version, key, CRC32C of the key, then records of
+// (payload length, CRC32C of the payload, payload)
+constexpr char kJournalMagic[8] = {'U', 'N', 'I', 'H', 'U', 'B', 'T', 'J'};
+constexpr std::uint32_t kJournalVersion = 1;
+constexpr std::size_t kRecordHeaderSize = 2 * sizeof(std::uint32_t);
+
+std::string journalHeader(const std::string& key) {
+    BinaryWriter out;
+    out.putBytes(kJournalMagic, sizeof(kJournalMagic));
+    out.put<std::uint32_t>(kJournalVersion);
+    out.putString(key);
+    out.put<std::uint32_t>(crc32c(key.data(), key.size()));
+    return out.data();
+}
+
+bool writeAll(int fd, const char* data, std::size_t size) {
+    while (size > 0) {
+        ssize_t n = ::write(fd, data, size);
+        if (n <= 0) return false;
+        data += n;
+        size -= static_cast<std::size_t>(n);
+    }
+    return true;
+}
+
+std::string readAll(int fd) {
+    std::string content;
+    char buffer[1 << 16];
+    ssize_t n;
+    while ((n = ::read(fd, buffer, sizeof(buffer))) > 0) content.append(buffer, static_cast<std::size_t>(n));
+    return content;
+}
+
+// Collects the records from offset start up to the first torn one, with the
+// offset after each
+void readRecordsFrom(const std::string& content, std::size_t start, std::vector<std::string>& records,
+                     std::vector<std::uint64_t>& ends) {
+    BinaryReader reader(content.data() + start, content.size() - start);
+    std::uint64_t end = start;
+    while (reader.remaining() >= kRecordHeaderSize) {
+        auto length = reader.get<std::uint32_t>();
+        auto crc = reader.get<std::uint32_t>();
+        const char* payload = reader.take(length);
+        if (!payload || crc32c(payload, length) != crc) break;
+        records.emplace_back(payload, length);
+        end += kRecordHeaderSize + length;
+        ends.push_back(end);
+    }
+}
+
+bool truncateTo(int fd, std::uint64_t size) {
+    return ::ftruncate(fd, static_cast<off_t>(size)) == 0 &&
+           ::lseek(fd, static_cast<off_t>(size), SEEK_SET) == static_cast<off_t>(size);
+}
+
+}
+
+TransferJournal::~TransferJournal() {
+    if (fd >= 0) ::close(fd);
+}
+
+bool TransferJournal::open(const std::string& key, std::vector<std::string>& records) {
+    records.clear();
+    recordEnds.clear();
+    if (fd >= 0) ::close(fd);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    // Keep the records of an earlier run of the same transfer, up to the
+    // first torn one, and cut the file there so appends follow them
+    std::string header = journalHeader(key);
+    std::string content = readAll(fd);
+    if (content.compare(0, header.size(), header) != 0) {
+        return truncateTo(fd, 0) && writeAll(fd, header.data(), header.size());
+    }
+    recordEnds.push_back(header.size());
+    readRecordsFrom(content, header.size(), records, recordEnds);
+    return truncateTo(fd, recordEnds.back());
+}
+
+bool TransferJournal::truncate(std::size_t keep) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd < 0 || keep >= recordEnds.size()) return false;
+    recordEnds.resize(keep + 1);
+    return truncateTo(fd, recordEnds.back());
+}
+
+bool TransferJournal::append(const std::string& record) {
+    BinaryWriter out;
+    out.put<std::uint32_t>(static_cast<std::uint32_t>(record.size()));
+    out.put<std::uint32_t>(crc32c(record.data(), record.size()));
+    out.putBytes(record.data(), record.size());
+    std::lock_guard<std::mutex> lock(mutex);
+    return fd >= 0 && writeAll(fd, out.data().data(), out.size());
+}
+
+void TransferJournal::discard() {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (fd >= 0) ::close(fd);
+    fd = -1;
+    ::unlink(path.c_str());
+}
+
+std::vector<std::string> TransferJournal::readRecords(const std::string& path) {
+    std::vector<std::string> records;
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return records;
+    std::string content = readAll(fd);
+    ::close(fd);
+
+    BinaryReader reader(content.data(), content.size());
+    const char* magic = reader.take(sizeof(kJournalMagic));
+    if (!magic || std::memcmp(magic, kJournalMagic, sizeof(kJournalMagic)) != 0) return records;
+    if (reader.get<std::uint32_t>() != kJournalVersion) return records;
+    std::string key = reader.getString();
+    if (reader.get<std::uint32_t>() != crc32c(key.data(), key.size()) || !reader.ok()) return records;
+    std::vector<std::uint64_t> ends;
+    readRecordsFrom(content, content.size() - reader.remaining(), records, ends);
+    return records;
+}
+
+}
@@ -0,0 +1,659 @@
+#include "users_db.h"
+#include "transfer_journal.h"
+#include <filesystem>
+#include <system_error>
+#include <algorithm>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+namespace uni {
+
+namespace {
+
+constexpr char kDbMagic[8] = {'U', 'N', 'I', 'H', 'U', 'B', 'D', 'B'};
+constexpr std::uint32_t kDbVersion = 1;
+constexpr std::uint32_t kBucketMagic = 0x544b4255;   // "UBKT"
+constexpr std::uint32_t kMaxGlobalDepth = 24;
+constexpr std::size_t kEntriesPerPage = UsersDb::kPageSize / sizeof(std::uint32_t);
+constexpr std::size_t kMapGranularity = 1 << 20;
+
+struct FileHeader {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t globalDepth;
+    std::uint32_t directoryPage;
+    std::uint32_t crc;           // CRC32C of the fields above
+};
+
+struct BucketHeader {
+    std::uint32_t crc;           // CRC32C of the rest of the page
+    std::uint32_t magic;
+    std::uint32_t pattern;       // Low depth bits of the hash of every record here
+    std::uint16_t count;
+    std::uint8_t depth;
+    std::uint8_t reserved;
+};
+
+struct StoredUser {
+    std::uint64_t emailHash;
+    std::uint64_t passwordHash;
+    std::int32_t year;
+    std::int32_t semester;
+    char email[UsersDb::kMaxEmail];
+    char firstName[UsersDb::kMaxName];
+    char lastName[UsersDb::kMaxName];
+    char branch[UsersDb::kMaxBranch];
+    char salt[UsersDb::kMaxSalt];
+    char section;
+    char reserved[7];
+};
+
+static_assert(sizeof(StoredUser) == UsersDb::kRecordSize, "records have a fixed layout");
+static_assert(sizeof(BucketHeader) + UsersDb::kRecordsPerPage * UsersDb::kRecordSize <= UsersDb::kPageSize,
+              "a bucket fits a page");
+
+// FNV-1a and a final mix, so bucket numbers stay the same across builds
+std::uint64_t hashEmail(const std::string& email) {
+    std::uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : email) {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    h ^= h >> 30;
+    h *= 0xbf58476d1ce4e5b9ULL;
+    h ^= h >> 27;
+    h *= 0x94d049bb133111ebULL;
+    return h ^ (h >> 31);
+}
+
+std::uint64_t lowBits(std::uint64_t value, std::uint32_t bits) {
+    return value & ((std::uint64_t(1) << bits) - 1);
+}
+
+char* recordAt(char* page, std::size_t slot) { return page + sizeof(BucketHeader) + slot * UsersDb::kRecordSize; }
+const char* recordAt(const char* page, std::size_t slot) {
+    return page + sizeof(BucketHeader) + slot * UsersDb::kRecordSize;
+}
+
+std::uint64_t recordHash(const char* record) {
+    std::uint64_t hash;
+    std::memcpy(&hash, record, sizeof(hash));
+    return hash;
+}
+
+void putField(char* field, std::size_t size, const std::string& value) {
+    std::memset(field, 0, size);
+    std::memcpy(field, value.data(), std::min(size, value.size()));
+}
+
+std::string getField(const char* field, std::size_t size) { return std::string(field, strnlen(field, size)); }
+
+std::optional<std::string> checkFits(const Profile& profile) {
+    if (profile.email.empty()) return std::string("Email is empty");
+    if (profile.email.size() > UsersDb::kMaxEmail) {
+        return "Email is longer than " + std::to_string(UsersDb::kMaxEmail) + " characters";
+    }
+    if (profile.firstName.size() > UsersDb::kMaxName || profile.lastName.size() > UsersDb::kMaxName) {
+        return "Names are limited to " + std::to_string(UsersDb::kMaxName) + " characters";
+    }
+    if (profile.branch.size() > UsersDb::kMaxBranch) {
+        return "Branch is longer than " + std::to_string(UsersDb::kMaxBranch) + " characters";
+    }
+    return std::nullopt;
+}
+
+void putProfile(StoredUser& stored, const Profile& profile) {
+    putField(stored.email, sizeof(stored.email), profile.email);
+    putField(stored.firstName, sizeof(stored.firstName), profile.firstName);
+    putField(stored.lastName, sizeof(stored.lastName), profile.lastName);
+    putField(stored.branch, sizeof(stored.branch), profile.branch);
+    stored.year = profile.year;
+    stored.semester = profile.semester;
+    stored.section = profile.section;
+}
+
+UserRecord decode(const char* record) {
+    StoredUser stored;
+    std::memcpy(&stored, record, sizeof(stored));
+    UserRecord user;
+    user.profile.email = getField(stored.email, sizeof(stored.email));
+    user.profile.firstName = getField(stored.firstName, sizeof(stored.firstName));
+    user.profile.lastName = getField(stored.lastName, sizeof(stored.lastName));
+    user.profile.branch = getField(stored.branch, sizeof(stored.branch));
+    user.profile.year = stored.year;
+    user.profile.semester = stored.semester;
+    user.profile.section = stored.section;
+    user.salt = getField(stored.salt, sizeof(stored.salt));
+    user.passwordHash = static_cast<std::size_t>(stored.passwordHash);
+    return user;
+}
+
+BucketHeader bucketHeader(const char* page) {
+    BucketHeader header;
+    std::memcpy(&header, page, sizeof(header));
+    return header;
+}
+
+bool bucketValid(const char* page) {
+    BucketHeader header = bucketHeader(page);
+    return header.magic == kBucketMagic && header.count <= UsersDb::kRecordsPerPage &&
+           header.depth <= kMaxGlobalDepth && header.pattern == lowBits(header.pattern, header.depth) &&
+           header.crc == crc32c(page + sizeof(header.crc), UsersDb::kPageSize - sizeof(header.crc));
+}
+
+// Stores the header and the page checksum
+void sealBucket(char* page, std::uint32_t pattern, std::uint32_t depth, std::size_t count) {
+    BucketHeader header{};
+    header.magic = kBucketMagic;
+    header.pattern = pattern;
+    header.count = static_cast<std::uint16_t>(count);
+    header.depth = static_cast<std::uint8_t>(depth);
+    std::memcpy(page, &header, sizeof(header));
+    header.crc = crc32c(page + sizeof(header.crc), UsersDb::kPageSize - sizeof(header.crc));
+    std::memcpy(page, &header.crc, sizeof(header.crc));
+}
+
+std::uint32_t directoryPages(std::size_t entries) {
+    return static_cast<std::uint32_t>((entries + kEntriesPerPage - 1) / kEntriesPerPage);
+}
+
+void syncDirectoryOf(const std::string& path) {
+    fs::path parent = fs::path(path).parent_path();
+    int dir = ::open(parent.empty() ? "." : parent.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir < 0) return;
+    ::fsync(dir);
+    ::close(dir);
+}
+
+}
+
+UsersDb::~UsersDb() { closeFile(); }
+
+// Also forgets everything read from the file, so open() starts afresh and
+// an interrupted batch cannot be committed
+void UsersDb::closeFile() {
+    if (mapped) ::munmap(const_cast<char*>(mapped), mappedBytes);
+    if (fd >= 0) ::close(fd);
+    mapped = nullptr;
+    mappedBytes = 0;
+    fd = -1;
+    pageCount = 0;
+    directory.clear();
+    localDepth.clear();
+    freePages.clear();
+    batching = false;
+    reachable.clear();
+    replaced.clear();
+}
+
+bool UsersDb::open() {
+    closeFile();
+    std::error_code ec;
+    fs::path parent = fs::path(path).parent_path();
+    if (!parent.empty()) fs::create_directories(parent, ec);
+    fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return false;
+
+    struct stat info{};
+    bool ready = ::fstat(fd, &info) == 0;
+    if (ready && info.st_size == 0) {
+        ready = initialize();
+    } else if (ready) {
+        // A page appended when the process died may be cut short; nothing refers to it
+        pageCount = static_cast<std::uint32_t>(info.st_size / kPageSize);
+        if (info.st_size % kPageSize != 0) ready = ::ftruncate(fd, off_t(pageCount) * kPageSize) == 0;
+    }
+    if (!ready || !mapPages(pageCount) || !loadDirectory()) {
+        closeFile();
+        return false;
+    }
+    collectFreePages();
+    return true;
+}
+
+void UsersDb::collectFreePages() {
+    std::vector<bool> used(pageCount, false);
+    used[0] = true;
+    for (std::uint32_t k = 0; k < directorySpan; ++k) used[directoryPage + k] = true;
+    for (std::uint32_t bucket : directory) used[bucket] = true;
+    // Pages a batch or split appended but never committed
+    std::uint32_t end = pageCount;
+    while (!used[end - 1]) --end;
+    if (end < pageCount && ::ftruncate(fd, off_t(end) * kPageSize) == 0) pageCount = end;
+    freePages.clear();
+    for (std::uint32_t number = pageCount; number-- > 1;) {
+        if (!used[number]) freePages.push_back(number);
+    }
+}
+
+// A free page, or the page after the end of the file
+std::uint32_t UsersDb::allocatePage() {
+    if (freePages.empty()) return pageCount;
+    std::uint32_t number = freePages.back();
+    freePages.pop_back();
+    return number;
+}
+
+bool UsersDb::initialize() {
+    // Header, a one-entry directory and an empty bucket of depth 0
+    pageCount = 0;
+    globalDepth = 0;
+    directoryPage = 1;
+    directorySpan = 1;
+    directory.assign(1, 2);
+    localDepth.clear();
+
+    char bucket[kPageSize] = {};
+    sealBucket(bucket, 0, 0, 0);
+    FileHeader header{};
+    std::memcpy(header.magic, kDbMagic, sizeof(kDbMagic));
+    header.version = kDbVersion;
+    header.directoryPage = directoryPage;
+    header.crc = crc32c(&header, offsetof(FileHeader, crc));
+    char first[kPageSize] = {};
+    std::memcpy(first, &header, sizeof(header));
+    char entries[kPageSize] = {};
+    std::memcpy(entries, directory.data(), sizeof(std::uint32_t));
+
+    bool written = writePage(0, first) && writePage(1, entries) && writePage(2, bucket) && ::fdatasync(fd) == 0;
+    if (written) syncDirectoryOf(path);
+    return written;
+}
+
+bool UsersDb::mapPages(std::uint32_t pages) {
+    std::size_t needed = std::size_t(pages) * kPageSize;
+    if (needed <= mappedBytes) return true;
+    // Mapped ahead of the file, so most appends need no new mapping
+    std::size_t bytes = std::max(needed, mappedBytes * 2);
+    bytes = (bytes + kMapGranularity - 1) / kMapGranularity * kMapGranularity;
+    void* address = ::mmap(nullptr, bytes, PROT_READ, MAP_SHARED, fd, 0);
+    if (address == MAP_FAILED) return false;
+    if (mapped) ::munmap(const_cast<char*>(mapped), mappedBytes);
+    mapped = static_cast<const char*>(address);
+    mappedBytes = bytes;
+    return true;
+}
+
+bool UsersDb::loadDirectory() {
+    if (pageCount < 3) return false;
+    FileHeader header;
+    std::memcpy(&header, page(0), sizeof(header));
+    if (std::memcmp(header.magic, kDbMagic, sizeof(kDbMagic)) != 0 || header.version != kDbVersion ||
+        header.crc != crc32c(&header, offsetof(FileHeader, crc)) || header.globalDepth > kMaxGlobalDepth) {
+        return false;
+    }
+    std::size_t entries = std::size_t(1) << header.globalDepth;
+    if (header.directoryPage == 0 || header.directoryPage + directoryPages(entries) > pageCount) return false;
+    globalDepth = header.globalDepth;
+    directoryPage = header.directoryPage;
+    directorySpan = directoryPages(entries);
+    directory.resize(entries);
+    std::memcpy(directory.data(), page(directoryPage), entries * sizeof(std::uint32_t));
+    return directoryConsistent() || rebuildDirectory();
+}
+
+// Every bucket the directory names must be reached by exactly the 2^(global -
+// local) entries sharing its low local-depth bits. Also derives local depths.
+bool UsersDb::directoryConsistent() {
+    localDepth.assign(pageCount, 0);
+    std::vector<std::uint32_t> refs(pageCount, 0);
+    std::vector<std::uint32_t> firstEntry(pageCount, UINT32_MAX);
+    for (std::uint32_t i = 0; i < directory.size(); ++i) {
+        std::uint32_t bucket = directory[i];
+        if (bucket == 0 || bucket >= pageCount) return false;
+        if (refs[bucket]++ == 0) firstEntry[bucket] = i;
+    }
+    for (std::uint32_t i = 0; i < directory.size(); ++i) {
+        std::uint32_t bucket = directory[i];
+        std::uint32_t count = refs[bucket];
+        if ((count & (count - 1)) != 0) return false;
+        std::uint32_t depth = globalDepth - static_cast<std::uint32_t>(__builtin_ctz(count));
+        if (lowBits(i, depth) != lowBits(firstEntry[bucket], depth)) return false;
+        localDepth[bucket] = static_cast<std::uint8_t>(depth);
+    }
+    return true;
+}
+
+// Rebuilds a half-written directory from the buckets it names (a bucket it
+// does not name belongs to a split that never reached the directory).
+// Shallower buckets go first, so a split's new bucket overrides the one it
+// came from, and among equals the later page, written by the later split.
+bool UsersDb::rebuildDirectory() {
+    struct Bucket {
+        std::uint32_t depth;
+        std::uint32_t number;
+        std::uint32_t pattern;
+    };
+    std::vector<Bucket> buckets;
+    std::vector<bool> named(pageCount, false);
+    for (std::uint32_t number : directory) {
+        if (number == 0 || number >= pageCount || named[number]) continue;
+        named[number] = true;
+        if (!bucketValid(page(number))) continue;
+        BucketHeader header = bucketHeader(page(number));
+        buckets.push_back({header.depth, number, header.pattern});
+    }
+    if (buckets.empty()) return false;
+    std::sort(buckets.begin(), buckets.end(), [](const Bucket& a, const Bucket& b) {
+        return a.depth != b.depth ? a.depth < b.depth : a.number < b.number;
+    });
+
+    globalDepth = buckets.back().depth;
+    directory.assign(std::size_t(1) << globalDepth, 0);
+    for (const auto& bucket : buckets) {
+        for (std::size_t i = bucket.pattern; i < directory.size(); i += std::size_t(1) << bucket.depth) {
+            directory[i] = bucket.number;
+        }
+    }
+    if (std::count(directory.begin(), directory.end(), 0u) != 0) return false;
+    return appendDirectory() && directoryConsistent();
+}
+
+// Writes the directory as a new copy at the end of the file, then points the
+// header at it and frees the old copy
+bool UsersDb::appendDirectory() {
+    std::uint32_t first = pageCount;
+    std::uint32_t span = directoryPages(directory.size());
+    char buffer[kPageSize];
+    for (std::uint32_t k = 0; k < span; ++k) {
+        std::memset(buffer, 0, sizeof(buffer));
+        std::size_t begin = k * kEntriesPerPage;
+        std::size_t count = std::min(kEntriesPerPage, directory.size() - begin);
+        std::memcpy(buffer, directory.data() + begin, count * sizeof(std::uint32_t));
+        if (!writePage(first + k, buffer)) return false;
+    }
+    if (!barrier()) return false;
+
+    FileHeader header{};
+    std::memcpy(header.magic, kDbMagic, sizeof(kDbMagic));
+    header.version = kDbVersion;
+    header.globalDepth = globalDepth;
+    header.directoryPage = first;
+    header.crc = crc32c(&header, offsetof(FileHeader, crc));
+    std::memset(buffer, 0, sizeof(buffer));
+    std::memcpy(buffer, &header, sizeof(header));
+    if (!writePage(0, buffer) || !barrier()) return false;
+    for (std::uint32_t k = 0; k < directorySpan; ++k) freePages.push_back(directoryPage + k);
+    directoryPage = first;
+    directorySpan = span;
+    return true;
+}
+
+// Rewrites, in place, the directory pages holding entries of the pattern
+bool UsersDb::writeDirectoryPages(std::uint32_t pattern, std::uint32_t depth) {
+    char buffer[kPageSize];
+    std::size_t written = SIZE_MAX;
+    for (std::size_t i = pattern; i < directory.size(); i += std::size_t(1) << depth) {
+        std::size_t k = i / kEntriesPerPage;
+        if (k == written) continue;
+        written = k;
+        std::memset(buffer, 0, sizeof(buffer));
+        std::size_t begin = k * kEntriesPerPage;
+        std::size_t count = std::min(kEntriesPerPage, directory.size() - begin);
+        std::memcpy(buffer, directory.data() + begin, count * sizeof(std::uint32_t));
+        if (!writePage(directoryPage + static_cast<std::uint32_t>(k), buffer)) return false;
+    }
+    return barrier();
+}
+
+bool UsersDb::writePage(std::uint32_t number, const char* data) {
+    std::size_t done = 0;
+    while (done < kPageSize) {
+        ssize_t n = ::pwrite(fd, data + done, kPageSize - done, off_t(number) * kPageSize + done);
+        if (n <= 0) return false;
+        done += static_cast<std::size_t>(n);
+    }
+    if (number >= pageCount) {
+        pageCount = number + 1;
+        localDepth.resize(pageCount, 0);
+        return mapPages(pageCount);
+    }
+    return true;
+}
+
+// Where a bucket of the given pattern and depth may be written: itself, or
+// in a batch, if the directory on disk reaches it, a free page the directory
+// is pointed at instead
+std::uint32_t UsersDb::writableBucket(std::uint32_t bucket, std::uint32_t pattern, std::uint32_t depth) {
+    if (!batching || bucket >= reachable.size() || !reachable[bucket]) return bucket;
+    std::uint32_t copy = allocatePage();
+    for (std::size_t i = pattern; i < directory.size(); i += std::size_t(1) << depth) directory[i] = copy;
+    if (copy >= localDepth.size()) localDepth.resize(std::size_t(copy) + 1, 0);
+    localDepth[copy] = static_cast<std::uint8_t>(depth);
+    replaced.push_back(bucket);
+    return copy;
+}
+
+bool UsersDb::barrier() { return batching || !syncEachWrite || ::fdatasync(fd) == 0; }
+
+bool UsersDb::sync() { return fd >= 0 && ::fdatasync(fd) == 0; }
+
+void UsersDb::beginBatch() {
+    batching = true;
+    reachable.assign(pageCount, false);
+    for (std::uint32_t bucket : directory) reachable[bucket] = true;
+    replaced.clear();
+}
+
+bool UsersDb::commitBatch() {
+    if (!batching) return false;
+    batching = false;
+    if (fd < 0) return false;
+    // New pages first, then the directory naming them, then the header
+    bool eachWrite = syncEachWrite;
+    syncEachWrite = true;
+    bool committed = ::fdatasync(fd) == 0 && appendDirectory();
+    syncEachWrite = eachWrite;
+    if (!committed) {
+        closeFile();
+        return false;
+    }
+    freePages.insert(freePages.end(), replaced.begin(), replaced.end());
+    reachable.clear();
+    replaced.clear();
+    return true;
+}
+
+std::optional<UsersDb::Location> UsersDb::locate(const std::string& email, std::uint64_t hash) const {
+    std::uint32_t bucket = bucketOf(hash);
+    const char* data = page(bucket);
+    if (!bucketValid(data)) return std::nullopt;
+    std::size_t count = bucketHeader(data).count;
+    for (std::size_t slot = 0; slot < count; ++slot) {
+        const char* record = recordAt(data, slot);
+        if (recordHash(record) != hash) continue;
+        const char* stored = record + offsetof(StoredUser, email);
+        if (strnlen(stored, kMaxEmail) == email.size() && std::memcmp(stored, email.data(), email.size()) == 0) {
+            return Location{bucket, static_cast<std::uint32_t>(slot)};
+        }
+    }
+    return std::nullopt;
+}
+
+std::optional<UserRecord> UsersDb::find(const std::string& email) const {
+    if (fd < 0) return std::nullopt;
+    auto location = locate(email, hashEmail(email));
+    if (!location) return std::nullopt;
+    return decode(recordAt(page(location->page), location->slot));
+}
+
+std::optional<std::string> UsersDb::insert(const UserRecord& record) {
+    if (fd < 0) return std::string("Users database is not open");
+    if (auto error = checkFits(record.profile)) return error;
+    if (record.salt.size() > kMaxSalt) return std::string("Salt is too long");
+    std::uint64_t hash = hashEmail(record.profile.email);
+    if (locate(record.profile.email, hash)) return std::string("User already exists");
+
+    StoredUser stored{};
+    putProfile(stored, record.profile);
+    putField(stored.salt, sizeof(stored.salt), record.salt);
+    stored.emailHash = hash;
+    stored.passwordHash = record.passwordHash;
+
+    char buffer[kPageSize];
+    while (true) {
+        std::uint32_t bucket = bucketOf(hash);
+        std::memcpy(buffer, page(bucket), kPageSize);
+        if (!bucketValid(buffer)) return "Users database page " + std::to_string(bucket) + " is damaged";
+        std::size_t count = bucketHeader(buffer).count;
+        if (count == kRecordsPerPage) {
+            // Drop copies left behind by an earlier split of this bucket
+            std::size_t kept = 0;
+            for (std::size_t slot = 0; slot < count; ++slot) {
+                if (bucketOf(recordHash(recordAt(buffer, slot))) != bucket) continue;
+                if (kept != slot) std::memcpy(recordAt(buffer, kept), recordAt(buffer, slot), kRecordSize);
+                ++kept;
+            }
+            std::memset(recordAt(buffer, kept), 0, (count - kept) * kRecordSize);
+            count = kept;
+        }
+        if (count < kRecordsPerPage) {
+            std::memcpy(recordAt(buffer, count), &stored, kRecordSize);
+            std::uint32_t depth = localDepth[bucket];
+            auto pattern = static_cast<std::uint32_t>(lowBits(hash, depth));
+            sealBucket(buffer, pattern, depth, count + 1);
+            if (!writePage(writableBucket(bucket, pattern, depth), buffer) || !barrier()) {
+                closeFile();
+                return "Failed to write: " + path;
+            }
+            return std::nullopt;
+        }
+        if (!splitBucket(bucket, hash)) {
+            // Memory and file may disagree now; the owner reopens, which reads the file again
+            closeFile();
+            return "Failed to write: " + path;
+        }
+    }
+}
+
+// Splits a full bucket on its next hash bit. Returns false on a write error
+// or when the directory cannot grow further.
+bool UsersDb::splitBucket(std::uint32_t bucket, std::uint64_t hash) {
+    std::uint32_t depth = localDepth[bucket];
+    bool grown = depth == globalDepth;
+    if (grown) {
+        if (globalDepth == kMaxGlobalDepth) return false;
+        std::size_t size = directory.size();
+        directory.resize(size * 2);
+        std::copy(directory.begin(), directory.begin() + size, directory.begin() + size);
+        ++globalDepth;
+    }
+
+    std::uint32_t pattern = static_cast<std::uint32_t>(lowBits(hash, depth));
+    std::uint32_t splitPattern = pattern | (std::uint32_t(1) << depth);
+    char kept[kPageSize] = {};
+    char moved[kPageSize] = {};
+    const char* data = page(bucket);
+    std::size_t keptCount = 0;
+    std::size_t movedCount = 0;
+    for (std::size_t slot = 0; slot < bucketHeader(data).count; ++slot) {
+        const char* record = recordAt(data, slot);
+        std::uint64_t recordBits = recordHash(record);
+        if (bucketOf(recordBits) != bucket) continue;
+        if (recordBits & (std::uint64_t(1) << depth)) {
+            std::memcpy(recordAt(moved, movedCount++), record, kRecordSize);
+        } else {
+            std::memcpy(recordAt(kept, keptCount++), record, kRecordSize);
+        }
+    }
+
+    // The new bucket, the directory, then the old bucket (see the class comment)
+    std::uint32_t fresh = allocatePage();
+    sealBucket(moved, splitPattern, depth + 1, movedCount);
+    if (!writePage(fresh, moved) || !barrier()) return false;
+    for (std::size_t i = splitPattern; i < directory.size(); i += std::size_t(1) << (depth + 1)) {
+        directory[i] = fresh;
+    }
+    localDepth[bucket] = static_cast<std::uint8_t>(depth + 1);
+    localDepth[fresh] = static_cast<std::uint8_t>(depth + 1);
+    // A batch writes its directory when it commits
+    if (!batching && (grown ? !appendDirectory() : !writeDirectoryPages(splitPattern, depth + 1))) return false;
+    sealBucket(kept, pattern, depth + 1, keptCount);
+    return writePage(writableBucket(bucket, pattern, depth + 1), kept) && barrier();
+}
+
+std::optional<std::string> UsersDb::updateProfile(const Profile& profile) {
+    if (fd < 0) return std::string("Users database is not open");
+    if (auto error = checkFits(profile)) return error;
+    std::uint64_t hash = hashEmail(profile.email);
+    auto location = locate(profile.email, hash);
+    if (!location) return std::string("User not found");
+
+    char buffer[kPageSize];
+    std::memcpy(buffer, page(location->page), kPageSize);
+    StoredUser stored;
+    std::memcpy(&stored, recordAt(buffer, location->slot), kRecordSize);
+    putProfile(stored, profile);
+    std::memcpy(recordAt(buffer, location->slot), &stored, kRecordSize);
+    BucketHeader header = bucketHeader(buffer);
+    std::uint32_t depth = localDepth[location->page];
+    auto pattern = static_cast<std::uint32_t>(lowBits(hash, depth));
+    sealBucket(buffer, pattern, depth, header.count);
+    if (!writePage(writableBucket(location->page, pattern, depth), buffer) || !barrier()) {
+        closeFile();
+        return "Failed to write: " + path;
+    }
+    return std::nullopt;
+}
+
+std::vector<UserRecord> UsersDb::loadAll() const {
+    std::vector<UserRecord> users;
+    if (fd < 0) return users;
+    std::vector<bool> seen(pageCount, false);
+    for (std::uint32_t bucket : directory) {
+        if (seen[bucket]) continue;
+        seen[bucket] = true;
+        const char* data = page(bucket);
+        if (!bucketValid(data)) continue;
+        for (std::size_t slot = 0; slot < bucketHeader(data).count; ++slot) {
+            const char* record = recordAt(data, slot);
+            if (bucketOf(recordHash(record)) == bucket) users.push_back(decode(record));
+        }
+    }
+    return users;
+}
+
+bool UsersDb::create(const std::string& path, const std::vector<UserRecord>& records,
+                     std::vector<std::string>* skipped) {
+    std::string staging = path + ".tmp";
+    ::unlink(staging.c_str());
+    {
+        UsersDb db(staging);
+        if (!db.open()) return false;
+        db.setSyncEachWrite(false);
+        std::vector<std::string> rejected;
+        for (const auto& record : records) {
+            // Records that cannot be stored are left out; any other failure is a write error
+            auto reason = checkFits(record.profile);
+            if (!reason && record.salt.size() > kMaxSalt) reason = "Salt is too long";
+            if (!reason && db.find(record.profile.email)) reason = "User already exists";
+            if (reason) {
+                rejected.push_back(record.profile.email + ": " + *reason);
+                continue;
+            }
+            if (db.insert(record)) {
+                db.closeFile();
+                ::unlink(staging.c_str());
+                return false;
+            }
+        }
+        if (!db.sync()) {
+            ::unlink(staging.c_str());
+            return false;
+        }
+        if (skipped) *skipped = std::move(rejected);
+    }
+    if (::rename(staging.c_str(), path.c_str()) != 0) {
+        ::unlink(staging.c_str());
+        return false;
+    }
+    syncDirectoryOf(path);
+    return true;
+}
+
+}